@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+// Compares the time taken by the vmmap readers with the string based readers
+// they replaced, on a generated vmmap export with sub-blocks.
+//    make bench && ./vmmapReaderBench [numEntries] [repetitions]
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h> // for getpid, unlink
+#include "vmmap.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+void readVmmapCsvFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& progress);
+void readVmmapTextFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& progress);
+
+//------------------ string based readers, as they were before string_view -------------------
+static bool legacyTokenizeVmmapLine(const string& line, vector<string>& tokens)
+   {
+   size_t lastPos = 0;
+   while (lastPos < line.size())
+      {
+      size_t startOfToken = line.find_first_of('"', lastPos);
+      if (startOfToken == string::npos)
+         return false;
+      startOfToken++;
+      size_t endOfToken = line.find_first_of('"', startOfToken);
+      if (endOfToken == string::npos)
+         return false;
+      tokens.push_back(line.substr(startOfToken, endOfToken - startOfToken));
+      lastPos = endOfToken + 2;
+      }
+   return true;
+   }
+
+static bool legacyTokenizeVmmapTextLine(const string& line, vector<string>& tokens, const vector<size_t>& fieldPositions)
+   {
+   for (size_t fieldNo = 0; fieldNo < fieldPositions.size() - 1; fieldNo++)
+      {
+      size_t startPosInLine = fieldPositions.at(fieldNo);
+      size_t endPosInLine = fieldPositions.at(fieldNo + 1);
+      if (startPosInLine > line.size())
+         {
+         tokens.push_back("");
+         continue;
+         }
+      string token = line.substr(startPosInLine, endPosInLine - startPosInLine);
+      size_t startToken = token.find_first_not_of(" \t\n\r");
+      if (startToken != string::npos)
+         {
+         size_t endToken = token.find_last_not_of(" \t\n\r");
+         tokens.push_back(token.substr(startToken, endToken - startToken + 1));
+         }
+      else
+         {
+         tokens.push_back("");
+         }
+      }
+   return true;
+   }
+
+static void legacyFillEntry(const vector<string>& tokens, VmmapEntry& entry)
+   {
+   unsigned long long start = hex2ull(tokens[0]);
+   entry.clear();
+   entry.setStart(start);
+   entry._type = tokens[1];
+   entry.setEnd(start + (a2ull(tokens[2]) << 10));
+   entry._committed = a2ull(tokens[3]);
+   entry._rss = a2ull(tokens[5]);
+   entry._privateWS = a2ull(tokens[6]);
+   entry._shareableWS = a2ull(tokens[7]);
+   entry._sharedWS = a2ull(tokens[8]);
+   entry._lockedWS = a2ull(tokens[9]);
+   entry._numBlocks = a2ull(tokens[10]);
+   entry._protection = tokens[11];
+   entry._details = tokens[12];
+   }
+
+static void legacyReadVmmapCsvFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& /*progress*/)
+   {
+   ifstream myfile(vmmapFilename);
+   string line;
+   while (myfile.good())
+      {
+      getline(myfile, line);
+      if (line.find("\"Address\",\"Type\",\"Size\"") != string::npos)
+         break;
+      }
+   VmmapEntry entry;
+   while (myfile.good())
+      {
+      getline(myfile, line);
+      if (line.find_first_not_of(" \t\n\r") == string::npos)
+         continue;
+      vector<string> tokens;
+      if (!legacyTokenizeVmmapLine(line, tokens) || tokens.size() != 13)
+         exit(-1);
+      if (tokens[0].at(0) == ' ')
+         continue;
+      legacyFillEntry(tokens, entry);
+      vmmaps.push_back(entry);
+      }
+   }
+
+static void legacyReadVmmapTextFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& /*progress*/)
+   {
+   static const char * const headings[] = { "Address", "Type", "Size", "Committed", "Private", "Total WS", "Private WS",
+                                            "Shareable WS", "Shared WS", "Locked WS", "Blocks", "Protection", "Details" };
+   ifstream myfile(vmmapFilename);
+   string line;
+   vector<size_t> fieldPositions;
+   while (myfile.good())
+      {
+      getline(myfile, line);
+      if (line.find("Address") == string::npos)
+         continue;
+      for (auto heading : headings)
+         fieldPositions.push_back(line.find(heading));
+      fieldPositions.push_back(string::npos);
+      break;
+      }
+   VmmapEntry entry;
+   while (myfile.good())
+      {
+      getline(myfile, line);
+      if (line.find_first_not_of(" \t\n\r") != 0)
+         continue;
+      vector<string> tokens;
+      if (!legacyTokenizeVmmapTextLine(line, tokens, fieldPositions) || tokens.size() != 13)
+         exit(-1);
+      legacyFillEntry(tokens, entry);
+      vmmaps.push_back(entry);
+      }
+   }
+
+//-------------------------------------------------------------------------------------------
+static const char * const types[] = { "Heap (Private Data)", "Private Data", "Image", "Thread Stack", "Mapped File", "Shareable" };
+static const char * const details[] = { "Heap ID: 1 [LOW FRAGMENTATION]", "", "C:\\Program Files\\Java\\jdk\\bin\\j9vm29.dll", "Thread ID: 2508",
+                                        "C:\\javasharedresources\\C290M11F1A64P_sharedcc_user_G41", "" };
+
+// Thousands separators like vmmap; empty for 0
+static string kb(unsigned long long value)
+   {
+   if (value == 0)
+      return "";
+   string digits = to_string(value);
+   for (int pos = (int)digits.size() - 3; pos > 0; pos -= 3)
+      digits.insert(pos, ",");
+   return digits;
+   }
+
+static void generateVmmapFiles(const string& csvFilename, const string& textFilename, size_t numEntries)
+   {
+   ofstream csv(csvFilename);
+   ofstream text(textFilename);
+   csv << "Process: java.exe\nPID: 1234\n\n";
+   csv << "\"Address\",\"Type\",\"Size\",\"Committed\",\"Private\",\"Total WS\",\"Private WS\",\"Shareable WS\",\"Shared WS\",\"Locked WS\",\"Blocks\",\"Protection\",\"Details\",\n";
+   text << "Process: java.exe\nPID: 1234\n\n";
+   const int widths[] = { 20, 22, 12, 12, 12, 12, 12, 14, 12, 12, 8, 20, 0 };
+   const char * const headings[] = { "Address", "Type", "Size", "Committed", "Private", "Total WS", "Private WS",
+                                     "Shareable WS", "Shared WS", "Locked WS", "Blocks", "Protection", "Details" };
+   for (int i = 0; i < 13; i++)
+      text << left << setw(widths[i]) << headings[i];
+   text << "\n";
+   unsigned long long address = 0x10000000;
+   for (size_t i = 0; i < numEntries; i++)
+      {
+      size_t kind = i % 6;
+      unsigned long long sizeKB = 64 + (i * 37) % 16384;
+      unsigned long long wsKB = sizeKB / (1 + i % 4);
+      stringstream hexAddress;
+      hexAddress << hex << uppercase << setw(16) << setfill('0') << address;
+      string fields[13] = { hexAddress.str(), types[kind], kb(sizeKB), kb(sizeKB), kb(wsKB), kb(wsKB), kb(wsKB / 2),
+                            kb(wsKB - wsKB / 2), kb(wsKB / 4), "", "2", "Read/Write", details[kind] };
+      for (auto& field : fields)
+         csv << "\"" << field << "\",";
+      csv << "\n";
+      // Every main entry is followed by a sub-block, which the readers skip
+      csv << "\"  " << fields[0] << "\",\"" << fields[1] << "\",\"" << fields[2] << "\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"Reserved\",\"\",\n";
+      for (int f = 0; f < 13; f++)
+         text << left << setw(widths[f]) << fields[f];
+      text << "\n  " << fields[0] << "\n";
+      address += sizeKB << 10;
+      }
+   }
+
+template <typename READER>
+static double bestTimeMs(READER reader, const string& filename, int repetitions, vector<VmmapEntry>& vmmaps)
+   {
+   double best = 0;
+   ostream noProgress(nullptr); // drop the progress messages of the readers
+   for (int i = 0; i < repetitions; i++)
+      {
+      vmmaps.clear();
+      auto start = chrono::steady_clock::now();
+      reader(filename.c_str(), vmmaps, noProgress);
+      double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+      if (i == 0 || elapsed < best)
+         best = elapsed;
+      }
+   return best;
+   }
+
+static bool sameEntries(const vector<VmmapEntry>& a, const vector<VmmapEntry>& b)
+   {
+   if (a.size() != b.size())
+      return false;
+   for (size_t i = 0; i < a.size(); i++)
+      if (a[i].getStart() != b[i].getStart() || a[i].getEnd() != b[i].getEnd() || a[i]._rss != b[i]._rss ||
+          a[i]._committed != b[i]._committed || a[i]._privateWS != b[i]._privateWS || a[i]._sharedWS != b[i]._sharedWS ||
+          a[i]._type != b[i]._type || a[i]._details != b[i]._details || a[i]._protection != b[i]._protection)
+         return false;
+   return true;
+   }
+
+int main(int argc, char* argv[])
+   {
+   size_t numEntries = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+   int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+   string csvFilename = "/tmp/vmmapReaderBench." + to_string(getpid()) + ".csv";
+   string textFilename = "/tmp/vmmapReaderBench." + to_string(getpid()) + ".txt";
+   generateVmmapFiles(csvFilename, textFilename, numEntries);
+
+   struct { const char *name; const string& filename; void (*legacy)(const char*, vector<VmmapEntry>&, ostream&); void (*current)(const char*, vector<VmmapEntry>&, ostream&); }
+      formats[] = { { "csv", csvFilename, legacyReadVmmapCsvFile, readVmmapCsvFile },
+                    { "text", textFilename, legacyReadVmmapTextFile, readVmmapTextFile } };
+   int status = 0;
+   cout << numEntries << " entries, best of " << repetitions << " runs\n";
+   for (auto& format : formats)
+      {
+      vector<VmmapEntry> legacyMaps, maps;
+      double legacyMs = bestTimeMs(format.legacy, format.filename, repetitions, legacyMaps);
+      double currentMs = bestTimeMs(format.current, format.filename, repetitions, maps);
+      bool same = sameEntries(legacyMaps, maps);
+      cout << setw(5) << format.name << ": string readers " << fixed << setprecision(1) << setw(8) << legacyMs << " ms; string_view readers "
+           << setw(8) << currentMs << " ms; speedup " << setprecision(2) << legacyMs / currentMs << "x"
+           << (same ? "" : "  ERROR: the readers produced different entries") << endl;
+      if (!same)
+         status = 1;
+      }
+   unlink(csvFilename.c_str());
+   unlink(textFilename.c_str());
+   return status;
+   }
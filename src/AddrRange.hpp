@@ -25,6 +25,7 @@
 #include <iomanip>
 #include <functional> // for binary predicates. Want to sort entries by size
 #include <algorithm>
+#include "BufferedWriter.hpp"
 
 class AddrRange
    {
@@ -81,15 +82,20 @@ class AddrRange
       bool operator >(const AddrRange& other) const { return this->getStart() > other.getStart(); }
       virtual bool operator == (const AddrRange& other) const { return this->getStart() == other.getStart() && this->getEnd() == other.getEnd(); }
       friend std::ostream& operator<<(std::ostream& os, const AddrRange& ar);
-      enum { SIMPLE_RANGE = 0, CALLSITE_RANGE, J9SEGMENT_RANGE, THREADSTACK_RANGE };
+      enum { SIMPLE_RANGE = 0, CALLSITE_RANGE, J9SEGMENT_RANGE, THREADSTACK_RANGE, JITMETHOD_RANGE };
       virtual int rangeType() const { return SIMPLE_RANGE; }
+      // Text of the range, as printed by operator<<
+      virtual void format(BufferedWriter& out) const
+         {
+         out.write("Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16).write(" Size=").dec(sizeKB(), 6);
+         }
 
    protected:
-      virtual void print(std::ostream& os) const
+      void print(std::ostream& os) const
          {
-         os << std::hex << "Start=" << std::setfill('0') << std::setw(16) << getStart() <<
-            " End=" << std::setfill('0') << std::setw(16) << getEnd() << std::dec <<
-            " Size=" << std::setfill(' ') << std::setw(6) << sizeKB();
+         BufferedWriter out;
+         format(out);
+         os << out.view();
          }
    }; //  AddrRange
 
@@ -0,0 +1,536 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _ATTRIBUTION_HPP__
+#define _ATTRIBUTION_HPP__
+#include <vector>
+#include <list>
+#include <iostream>
+#include <type_traits> // for is_same_v<>
+#include <string>
+#include <utility> // for std::pair
+#include <unordered_map>
+#include <algorithm> // for sort
+#include "AddrRange.hpp"
+#include "smap.hpp"
+#include "Javacore.hpp"
+#include "CallSites.hpp"
+#include "PageMapSupport.hpp"
+#include "Util.hpp"
+
+// T can be either a J9Segment or a CallSite
+// The ranges sorted by start address are swept against the maps sorted by start address,
+// so a map is only compared with the ranges that are live at its address. The ranges
+// of each map are still processed in their original order, so the reports do not change
+template <typename MAPENTRY, typename T>
+void annotateMapWithSegments(std::vector<MAPENTRY>&maps, const std::vector<T>& segments, std::ostream& progress = std::cout)
+   {
+   // Annotate maps with j9segments
+   progress << "Annotate maps with segments ...";
+   std::vector<size_t> segOrder(segments.size());
+   for (size_t i = 0; i < segOrder.size(); i++)
+      segOrder[i] = i;
+   std::stable_sort(segOrder.begin(), segOrder.end(), [&segments](size_t s1, size_t s2) { return segments[s1].getStart() < segments[s2].getStart(); });
+   std::vector<size_t> mapOrder(maps.size());
+   for (size_t i = 0; i < mapOrder.size(); i++)
+      mapOrder[i] = i;
+   std::stable_sort(mapOrder.begin(), mapOrder.end(), [&maps](size_t m1, size_t m2) { return maps[m1].getAddrRange().getStart() < maps[m2].getAddrRange().getStart(); });
+
+   std::vector<size_t> live; // ranges that start before the current map and may reach into it
+   std::vector<size_t> hits;
+   size_t nextSeg = 0;
+   for (size_t mapIndex : mapOrder)
+      {
+      MAPENTRY *map = &maps[mapIndex];
+      const AddrRange& mapRange = map->getAddrRange();
+      // The next maps start at or after this one, so ranges that end before it are done
+      live.erase(std::remove_if(live.begin(), live.end(), [&](size_t s) { return segments[s].getEnd() <= mapRange.getStart(); }), live.end());
+      for (; nextSeg < segOrder.size() && segments[segOrder[nextSeg]].getStart() < mapRange.getEnd(); nextSeg++)
+         if (segments[segOrder[nextSeg]].getEnd() > mapRange.getStart())
+            live.push_back(segOrder[nextSeg]);
+      hits.clear();
+      for (size_t s : live)
+         if (!segments[s].disjoint(mapRange))
+            hits.push_back(s);
+      std::sort(hits.begin(), hits.end());
+      for (size_t s : hits)
+         {
+         const T *seg = &segments[s];
+         if (map->getAddrRange().includes(*seg))
+            {
+            map->addCoveringRange(*seg);
+            // For segments, lets identify the maps that are covered by Java heap segments or CODECACHES
+            if constexpr (std::is_same_v<T, J9Segment>)
+               {
+               if (seg->getSegmentType() == J9Segment::JAVAHEAP)
+                  map->setPurpose(MemoryEntry::JAVAHEAP);
+               if (seg->getSegmentType() == J9Segment::CODECACHE)
+                  map->setPurpose(MemoryEntry::CODECACHE);
+               }
+            }
+         else
+            {
+            progress << "Overlapping range SEG:" << *seg << " and SMAP:" << *map << std::endl;
+            map->addOverlappingRange(*seg);
+            //map->setPurpose(MemoryEntry::GENERIC);
+            }
+         }
+      }
+   progress << "Done\n";
+   }
+
+// Count the RSS of segments, call-sites or thread stacks from the pagemap, for the current
+// state of the process. Only the segment types that readJavacore measures are counted; the
+// others are in maps of their own. If 'changed' is given (sorted, disjoint address intervals
+// whose pages may have changed), the ranges that do not overlap it keep their RSS
+template <typename CONTAINER>
+void computeRangesRss(CONTAINER& ranges, PageMapReader& pageMapReader,
+                      const std::vector<std::pair<unsigned long long, unsigned long long>> *changed = nullptr)
+   {
+   typedef typename CONTAINER::value_type T;
+   for (auto& range : ranges)
+      {
+      if (changed)
+         {
+         // Last interval that starts before the end of the range
+         auto interval = std::lower_bound(changed->begin(), changed->end(), std::make_pair(range.getEnd(), 0ULL));
+         if (interval == changed->begin() || (--interval)->second <= range.getStart())
+            continue;
+         }
+      if constexpr (std::is_same_v<T, J9Segment>)
+         {
+         J9Segment::SegmentType segmentType = range.getSegmentType();
+         if (segmentType != J9Segment::CLASS && segmentType != J9Segment::DATACACHE && segmentType != J9Segment::INTERNAL)
+            continue;
+         }
+      if (range.getStart() < range.getEnd())
+         range.setRSS(pageMapReader.computeRssForAddrRange(range.getStart(), range.getEnd()));
+      }
+   }
+
+// The ThreadStacks created for stack guards are kept in 'stackGuards' if given; otherwise they
+// live until the end of the program, which is fine when the maps are annotated only once
+template <typename MAPENTRY>
+void annotateMapWithThreadStacks(std::vector<MAPENTRY>&maps, std::vector<ThreadStack>& stacks, std::list<ThreadStack> *stackGuards = nullptr,
+                                 std::ostream& progress = std::cout)
+   {
+   // Annotate maps with threadStacks
+   progress << "Annotate maps with threads stacks ...";
+   for (auto map = maps.begin(); map != maps.end(); ++map)
+      {
+      for (auto stackRegion = stacks.begin(); stackRegion != stacks.end(); ++stackRegion)
+         {
+         if (stackRegion->disjoint(map->getAddrRange()))
+            continue;
+         // A stackRegion usually spans two smaps: one for the stack guard
+         // which is protected to R/W and one for the stack itself
+         // We want to cover the entire stack guard with part of the thread stack and
+         // cover entirely or partially the next smap with the remaining of the thread
+         // stack
+         if (map->getAddrRange().includes(*stackRegion))
+            {
+            map->addCoveringRange(*stackRegion);
+            map->setPurpose(MemoryEntry::STACK);
+            break; // go to next smap
+            }
+         else
+            {
+            // This could be our stack guard
+            // Typically the start of the smap is the same as the start of the thread stack
+            if (stackRegion->includes(map->getAddrRange()))
+               {
+               if (stackRegion->getStart() == map->getAddrRange().getStart())
+                  {
+                  // Create a new threadStack just for the size of this smap
+                  // This is not technically a memory leak because we need it till the end of the program
+                  ThreadStack guard(map->getAddrRange().getStart(), map->getAddrRange().getEnd(), stackRegion->getThreadName(), 0 /*rss*/);
+                  ThreadStack *threadStack;
+                  if (stackGuards)
+                     {
+                     stackGuards->push_back(guard);
+                     threadStack = &stackGuards->back();
+                     }
+                  else
+                     {
+                     threadStack = new ThreadStack(guard);
+                     }
+                  map->addCoveringRange(*threadStack);
+                  map->setPurpose(MemoryEntry::STACK);
+                  // Substract the size of the stack guard from the ThreadStack
+                  // This adjusted ThreadStack will be attributed to the next map
+                  stackRegion->setStart(map->getAddrRange().getEnd());
+                  }
+               }
+            else
+               {
+               progress << "Unexpected situation with ThreadStack " << *stackRegion << " and smap " << *map;
+               map->addOverlappingRange(*stackRegion);
+               }
+            }
+         }
+      }
+   progress << "Done\n";
+   }
+
+
+// The category of a map with a sole purpose, charged entirely to it; UNKNOWN for the maps
+// that are split between the ranges covering them
+template <typename MAPENTRY>
+AddrRange::RangeCategories getSoleCategory(const MAPENTRY &crtMap)
+   {
+   switch (crtMap.getPurpose())
+      {
+      case MemoryEntry::DLL:       return AddrRange::DLL;
+      case MemoryEntry::SCC:       return AddrRange::SCC;
+      case MemoryEntry::STACK:     return AddrRange::STACK;
+      case MemoryEntry::JAVAHEAP:  return AddrRange::JAVAHEAP;
+      case MemoryEntry::CODECACHE: return AddrRange::CODECACHE;
+      default:                     return AddrRange::UNKNOWN;
+      }
+   }
+
+// Visit the pieces into which one map is charged to the categories of memory that use it:
+//    visit(category, range, virtualBytes, rssBytes)
+// This is the only place with the attribution rules; the category totals and all the
+// per-range reports are sums of these pieces.
+// 'range' is the covering or overlapping range that is charged, or nullptr when the piece
+// is the whole map or the part of it that is not covered by any range.
+//  - Maps with a sole purpose are charged entirely to that category.
+//  - With the pagemap each covering range knows its own RSS; the rest of the map is NOTCOVERED.
+//  - Otherwise a map covered by ranges of one category is charged entirely to it, and a map
+//    covered by several categories is split by virtual size, the rest being UNKNOWN.
+//    The RSS of a category is split between its ranges by their virtual size.
+//  - A map that is not covered but overlaps one range of a known category belongs to it
+//    (e.g. the GC expanded a heap segment between the smaps and the javacore).
+template <typename MAPENTRY, typename VISITOR>
+void forEachMapAttribution(const MAPENTRY &crtMap, bool usePageMap, VISITOR&& visit)
+   {
+   const unsigned long long mapRss = crtMap.getResidentSizeKB() << 10; // convert to bytes
+   const std::list<const AddrRange*>& coveringRanges = crtMap._coveringRanges;
+   const std::list<const AddrRange*>& overlapRanges = crtMap._overlappingRanges;
+
+   AddrRange::RangeCategories soleCategory = getSoleCategory(crtMap);
+   if (soleCategory != AddrRange::UNKNOWN)
+      {
+      visit(soleCategory, coveringRanges.size() == 1 ? coveringRanges.front() : nullptr, crtMap.size(), mapRss);
+      return;
+      }
+
+   unsigned long long totalCoveredSize = 0;
+   unsigned long long sz[AddrRange::NUM_CATEGORIES] = {0}; // virtual size covered by each category
+   unsigned numRanges[AddrRange::NUM_CATEGORIES] = {0};
+   for (auto seg : coveringRanges)
+      {
+      sz[seg->getRangeCategory()] += seg->size();
+      numRanges[seg->getRangeCategory()]++;
+      totalCoveredSize += seg->size();
+      }
+   if (usePageMap && totalCoveredSize > 0)
+      {
+      // Each range knows its own RSS; what is left of the map is not covered by any range
+      unsigned long long rangesRss = 0;
+      for (auto seg : coveringRanges)
+         {
+         visit(seg->getRangeCategory(), seg, seg->size(), seg->getRSS());
+         rangesRss += seg->getRSS();
+         }
+      unsigned long long uncoveredSize = crtMap.size() - std::min(totalCoveredSize, crtMap.size());
+      unsigned long long uncoveredRss = mapRss - std::min(rangesRss, mapRss);
+      if (uncoveredSize != 0 || uncoveredRss != 0)
+         visit(AddrRange::NOTCOVERED, nullptr, uncoveredSize, uncoveredRss);
+      }
+   else if (totalCoveredSize > 0)
+      {
+      int numDifferentCategories = 0;
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         if (sz[i] > 0)
+            numDifferentCategories++;
+      // If the map is covered by ranges of the same category, the entire RSS is charged
+      // to that category; otherwise it is allocated in proportion to the virtual size
+      unsigned long long categoryRss[AddrRange::NUM_CATEGORIES] = {0};
+      unsigned long long rssAccountedFor = 0;
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         {
+         if (sz[i] != 0)
+            {
+            categoryRss[i] = numDifferentCategories == 1 ? mapRss : mapRss * sz[i] / crtMap.size();
+            rssAccountedFor += categoryRss[i];
+            }
+         }
+      // Split the RSS of each category between its ranges; the last range gets the rounding error
+      unsigned long long rssCharged[AddrRange::NUM_CATEGORIES] = {0};
+      unsigned rangesSeen[AddrRange::NUM_CATEGORIES] = {0};
+      for (auto seg : coveringRanges)
+         {
+         AddrRange::RangeCategories category = seg->getRangeCategory();
+         unsigned long long rss = ++rangesSeen[category] == numRanges[category] ?
+            categoryRss[category] - rssCharged[category] :
+            (unsigned long long)((long double)categoryRss[category] * seg->size() / sz[category]);
+         rssCharged[category] += rss;
+         visit(category, seg, seg->size(), rss);
+         }
+      if (numDifferentCategories > 1)
+         visit(AddrRange::UNKNOWN, nullptr, crtMap.size() - totalCoveredSize, mapRss - rssAccountedFor);
+      }
+   else if (overlapRanges.size() != 0)
+      {
+      // An overlapping range could happen if smaps are gathered first and then by the time
+      // we collect the javacore the GC expands which makes the GC segment in the javacore
+      // be larger than the smap. If a single range of a known category overlaps the map,
+      // the entire map is of that category; with several ranges it cannot be determined
+      AddrRange::RangeCategories smapCategory = overlapRanges.size() == 1 ? overlapRanges.front()->getRangeCategory() : AddrRange::UNKNOWN;
+      visit(smapCategory, overlapRanges.size() == 1 ? overlapRanges.front() : nullptr, crtMap.size(), mapRss);
+      }
+   else // This map is not covered by anything and it does not overlap anything
+      {
+      visit(AddrRange::NOTCOVERED, nullptr, crtMap.size(), mapRss);
+      }
+   }
+
+// Charge the virtual size and RSS of one map to the categories of memory that use it
+// (see forEachMapAttribution). Returns true for the maps with a sole purpose. The maps
+// that cannot be attributed cleanly are reported on 'warnings'
+template <typename MAPENTRY>
+bool accumulateMapIntoCategories(const MAPENTRY &crtMap, bool usePageMap,
+                                 unsigned long long virtualSize[], // output
+                                 unsigned long long rssSize[], // output
+                                 std::ostream& warnings = std::cerr)
+   {
+   bool hasSolePurpose = getSoleCategory(crtMap) != AddrRange::UNKNOWN;
+   bool covered = crtMap._coveringRanges.size() != 0;
+   bool overlapped = crtMap._overlappingRanges.size() != 0;
+   if (!hasSolePurpose && covered && overlapped)
+      warnings << "Warning: smap starting at addr " << crtMap.getAddrRange().getStart() << " has both covering and overlapping ranges\n";
+   forEachMapAttribution(crtMap, usePageMap,
+      [&](AddrRange::RangeCategories category, const AddrRange *, unsigned long long virtualBytes, unsigned long long rssBytes)
+         {
+         virtualSize[category] += virtualBytes;
+         rssSize[category] += rssBytes;
+         if (!hasSolePurpose && !covered && overlapped && category == AddrRange::UNKNOWN)
+            warnings << "smap with different/unknown segments that are not totaly included in this smap\n";
+         });
+   return hasSolePurpose;
+   }
+
+// Compute the virtual size and RSS (in bytes) of each category for a set of annotated maps
+template <typename MAPENTRY>
+void computeCategoryTotals(const std::vector<MAPENTRY> &maps, bool usePageMap,
+                           unsigned long long virtualSize[], // output
+                           unsigned long long rssSize[], // output
+                           std::ostream& warnings = std::cerr)
+   {
+   for (auto crtMap = maps.cbegin(); crtMap != maps.cend(); ++crtMap)
+      accumulateMapIntoCategories(*crtMap, usePageMap, virtualSize, rssSize, warnings);
+   }
+
+// Everything printSpaceKBTakenByVmComponents reports, independent of the output format
+template <typename MAPENTRY>
+struct FootprintSummary
+   {
+   unsigned long long _totalVirtSize = 0; // bytes
+   unsigned long long _totalRssSize = 0; // bytes
+   unsigned long long _virtualSize[AddrRange::NUM_CATEGORIES] = {0}; // one entry for each category
+   unsigned long long _rssSize[AddrRange::NUM_CATEGORIES] = {0}; // one entry for each category
+   std::vector<std::pair<std::string, unsigned long long>> _dllRss; // RSS (bytes) of each DLL, largest first
+   TopK<const MAPENTRY*, PointeeLess<MemoryEntryRssLessThan>> _topDlls; // points into the analyzed maps
+   TopK<const MAPENTRY*, PointeeLess<MemoryEntryRssLessThan>> _topNotCovered;
+   explicit FootprintSummary(size_t topK = 10) : _topDlls(topK), _topNotCovered(topK) {}
+   };
+
+template <typename MAPENTRY>
+void computeFootprintSummary(const std::vector<MAPENTRY> &smaps, bool usePageMap, FootprintSummary<MAPENTRY>& summary)
+   {
+   std::unordered_map<std::string, unsigned long long> dllCollection; // maps dll name to size (RSS)
+
+   // Iterate through all smaps/vmmaps
+   for (auto crtMap = smaps.cbegin(); crtMap != smaps.cend(); ++crtMap)
+      {
+      summary._totalVirtSize += crtMap->size();
+      summary._totalRssSize += crtMap->getResidentSizeKB() << 10; // convert to bytes
+
+      // Check if shared library; these require some extra processing
+      if (crtMap->getPurpose() == MemoryEntry::DLL)
+         {
+         summary._topDlls.processElement(&*crtMap);
+
+         // Note that in Linux a DLL may have 3 or even 4 smaps. e.g.
+         // Size = 11968 rss = 11136 Prot = r-xp / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
+         // Size = 960   rss = 256   Prot = r--p / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
+         // Size = 448   rss = 448   Prot = rw-p / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
+         // We want to sum-up all contributions for the same DLL. Thus let's create a hashtable
+         // that accumulates the sums (key is the name of the DLL, value is the total RSS)
+         // Then we need to sort by the total RSS
+         //
+         auto& dllTotalRSSSize = dllCollection[crtMap->getDetailsString()]; // If key does not exist, it will be inserted
+         dllTotalRSSSize += crtMap->getResidentSizeKB() << 10;
+         }
+      // Charge the map to categories; maps with a sole purpose cannot be "not covered"
+      if (accumulateMapIntoCategories(*crtMap, usePageMap, summary._virtualSize, summary._rssSize))
+         continue;
+
+      if (crtMap->getCoveringRanges().size() == 0 &&
+          crtMap->getOverlappingRanges().size() == 0 &&
+          crtMap->getResidentSizeKB() != 0)
+         summary._topNotCovered.processElement(&*crtMap);
+      } // end for (iterate through smaps)
+
+   // Process the hashtable with DLLs
+   //
+   using PairStringULL = std::pair < std::string, unsigned long long >;
+   // Ideally, above I would use something like  decltype(dllCollection)::value_type
+   // which is of type <const string, unsigned long long>
+   // However, the sort algorithm used below uses operator = and the const in front of the
+   // string creates problems when moving elements
+
+   // Take all elements from the hashtable and put them into a vector
+   std::vector<PairStringULL>& vectorWithDlls = summary._dllRss;
+   vectorWithDlls.assign(dllCollection.cbegin(), dllCollection.cend());
+
+
+   // Sort the vector using a custom comparator (lambda) that knows how to
+   // compare pairs (want to sort based on value of the map entry)
+   //
+   std::sort(vectorWithDlls.begin(), vectorWithDlls.end(),
+        [](const PairStringULL& p1, const PairStringULL& p2)
+           { return p1.second > p2.second; } // compare using the second element of the pair
+       );
+   }
+
+// Name of the pool a thread belongs to. Digits are replaced by '#' so that
+// "JIT Compilation Thread-3" and "JIT Compilation Thread-4" end up in the same pool.
+// The quotes around the thread names in the javacore are dropped
+inline std::string threadPoolName(const std::string& threadName)
+   {
+   std::string pool;
+   pool.reserve(threadName.size());
+   for (size_t i = 0; i < threadName.size(); i++)
+      {
+      if (threadName[i] == '"')
+         continue;
+      if (threadName[i] >= '0' && threadName[i] <= '9')
+         {
+         if (pool.empty() || pool.back() != '#')
+            pool.push_back('#');
+         }
+      else
+         {
+         pool.push_back(threadName[i]);
+         }
+      }
+   return pool;
+   }
+
+// The attribution hierarchy of one piece visited by forEachMapAttribution, from the root:
+//    category -> DLL, segment type, call-site file or thread pool -> call-site file:line
+// Maps that are not attributed to any range are named after their details (file name) if any,
+// under the custom category given by the classification rules
+template <typename MAPENTRY>
+void buildAttributionFrames(const MAPENTRY &crtMap, AddrRange::RangeCategories category, const AddrRange *range,
+                            std::vector<std::string>& frames) // output
+   {
+   frames.clear();
+   frames.push_back(AddrRange::RangeCategoryNames[category]);
+   if (category == AddrRange::DLL || category == AddrRange::SCC)
+      {
+      frames.push_back(crtMap.getDetailsString());
+      return;
+      }
+   if (range == nullptr)
+      {
+      if (category == AddrRange::UNKNOWN || category == AddrRange::NOTCOVERED)
+         {
+         if (!crtMap.getCustomCategory().empty())
+            frames.push_back(crtMap.getCustomCategory());
+         frames.push_back(crtMap.getDetailsString().empty() ? std::string("[anonymous]") : crtMap.getDetailsString());
+         }
+      return;
+      }
+   switch (range->rangeType())
+      {
+      case AddrRange::J9SEGMENT_RANGE:
+         frames.push_back(static_cast<const J9Segment*>(range)->getTypeName());
+         break;
+      case AddrRange::CALLSITE_RANGE:
+         {
+         const CallSite *callSite = static_cast<const CallSite*>(range);
+         frames.push_back(callSite->getFilename());
+         frames.push_back(callSite->getFilename() + ":" + std::to_string(callSite->getLineNo()));
+         break;
+         }
+      case AddrRange::THREADSTACK_RANGE:
+         frames.push_back(threadPoolName(static_cast<const ThreadStack*>(range)->getThreadName()));
+         break;
+      default:
+         break;
+      }
+   }
+
+// Append a frame to a folded stack; ';' separates frames, so it cannot appear inside one
+inline void appendFoldedFrame(std::string& stack, const std::string& frame)
+   {
+   if (!stack.empty())
+      stack.push_back(';');
+   for (char c : frame)
+      stack.push_back(c == ';' || c == '\n' ? '_' : c);
+   }
+
+// Memory charged to one attribution stack, e.g. "CallSites;segment.c;segment.c:99"
+struct AttributionRecord
+   {
+   std::string _stack; // frames of buildAttributionFrames separated by ';'
+   unsigned long long _virtualBytes = 0;
+   unsigned long long _rssBytes = 0;
+   bool operator <(const AttributionRecord& other) const { return _stack < other._stack; }
+   };
+
+// Aggregate the pieces of all maps by attribution stack in a single pass; records are sorted by stack
+template <typename MAPENTRY>
+void collectAttributionRecords(const std::vector<MAPENTRY>& maps, bool usePageMap,
+                               std::vector<AttributionRecord>& records) // output
+   {
+   std::unordered_map<std::string, size_t> recordIndex; // stack -> index in records
+   std::vector<std::string> frames;
+   std::string stack;
+   records.clear();
+   for (const auto& crtMap : maps)
+      {
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            buildAttributionFrames(crtMap, category, range, frames);
+            stack.clear();
+            for (const auto& frame : frames)
+               appendFoldedFrame(stack, frame);
+            auto inserted = recordIndex.emplace(stack, records.size());
+            if (inserted.second)
+               {
+               records.emplace_back();
+               records.back()._stack = stack;
+               }
+            AttributionRecord& record = records[inserted.first->second];
+            record._virtualBytes += virtualBytes;
+            record._rssBytes += rssBytes;
+            });
+      }
+   std::sort(records.begin(), records.end());
+   }
+
+#endif // _ATTRIBUTION_HPP__
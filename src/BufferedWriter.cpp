@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <unistd.h> // for write
+#include <cerrno>
+#include "BufferedWriter.hpp"
+
+BufferedWriter::BufferedWriter(int fd, size_t capacity) : _fd(fd), _capacity(capacity)
+   {
+   if (_fd >= 0)
+      _buffer.reserve(_capacity);
+   }
+
+BufferedWriter& BufferedWriter::writeDigits(const char *digits, int numDigits, int width, char fill)
+   {
+   int padding = width > numDigits ? width - numDigits : 0;
+   makeRoom(padding + numDigits);
+   _buffer.append(padding, fill);
+   _buffer.append(digits, numDigits);
+   return *this;
+   }
+
+BufferedWriter& BufferedWriter::hex(unsigned long long value, int width, char fill)
+   {
+   static const char hexDigits[] = "0123456789abcdef";
+   char digits[16];
+   int pos = sizeof(digits);
+   do {
+      digits[--pos] = hexDigits[value & 0xf];
+      value >>= 4;
+      } while (value);
+   return writeDigits(digits + pos, sizeof(digits) - pos, width, fill);
+   }
+
+BufferedWriter& BufferedWriter::dec(unsigned long long value, int width, char fill)
+   {
+   char digits[20];
+   int pos = sizeof(digits);
+   do {
+      digits[--pos] = '0' + value % 10;
+      value /= 10;
+      } while (value);
+   return writeDigits(digits + pos, sizeof(digits) - pos, width, fill);
+   }
+
+BufferedWriter& BufferedWriter::padLeft(std::string_view text, int width, char fill)
+   {
+   int padding = width > (int)text.size() ? width - (int)text.size() : 0;
+   makeRoom(padding + text.size());
+   _buffer.append(padding, fill);
+   _buffer.append(text);
+   return *this;
+   }
+
+bool BufferedWriter::flush()
+   {
+   if (_fd < 0)
+      return true;
+   const char *data = _buffer.data();
+   size_t remaining = _buffer.size();
+   while (remaining > 0)
+      {
+      ssize_t written = ::write(_fd, data, remaining);
+      if (written < 0)
+         {
+         if (errno == EINTR)
+            continue;
+         _buffer.clear();
+         return false;
+         }
+      data += written;
+      remaining -= written;
+      }
+   _buffer.clear();
+   return true;
+   }
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _BUFFEREDWRITER_HPP__
+#define _BUFFEREDWRITER_HPP__
+#include <string>
+#include <string_view>
+
+// Formats text into a large buffer that is written to a file descriptor only when full,
+// for outputs that have one line per map or range (millions of lines with many call-sites).
+// Numbers are formatted by hand; hex() and dec() produce the same text as
+// "<< hex << setfill(fill) << setw(width)" and "<< dec << setfill(fill) << setw(width)".
+// With fd < 0 nothing is written out and the text is available through view()
+class BufferedWriter
+   {
+   public:
+      static const size_t DEFAULT_CAPACITY = 1 << 20;
+      explicit BufferedWriter(int fd = -1, size_t capacity = DEFAULT_CAPACITY);
+      ~BufferedWriter() { flush(); }
+      BufferedWriter(const BufferedWriter&) = delete;
+      BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+      BufferedWriter& put(char c) { makeRoom(1); _buffer.push_back(c); return *this; }
+      BufferedWriter& write(std::string_view text) { makeRoom(text.size()); _buffer.append(text); return *this; }
+      BufferedWriter& hex(unsigned long long value, int width = 0, char fill = '0');
+      BufferedWriter& dec(unsigned long long value, int width = 0, char fill = ' ');
+      BufferedWriter& padLeft(std::string_view text, int width, char fill = ' '); // right aligned, like setw
+      bool flush(); // false if the data could not be written
+      std::string_view view() const { return _buffer; }
+   private:
+      void makeRoom(size_t numBytes)
+         {
+         if (_fd >= 0 && _buffer.size() + numBytes > _capacity)
+            flush();
+         }
+      BufferedWriter& writeDigits(const char *digits, int numDigits, int width, char fill);
+      int _fd;
+      size_t _capacity;
+      std::string _buffer;
+   };
+
+#endif // _BUFFEREDWRITER_HPP__
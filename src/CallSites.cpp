@@ -25,6 +25,7 @@
 #include <fstream>
 #include <iomanip>
 #include <regex>
+#include <stdexcept> // runtime_error
 #include "CallSites.hpp"
 #include "Util.hpp"
 #include "PageMapSupport.hpp"
@@ -37,17 +38,14 @@ using namespace std;
  !j9x 0x004FA8E0,0x000001E8	LargeObjectAllocateStats.cpp:45
  !j9x 0x004FAB00,0x000000A4	TLHAllocationInterface.cpp:53
 */
-void readCallSitesFile(const char *filename, vector<CallSite>& callSites, PageMapReader *pageMapReader)
+void readCallSitesFile(const char *filename, vector<CallSite>& callSites, PageMapReader *pageMapReader, ostream& progress)
    {
-   cout << "\nReading callSites file: " << string(filename) << endl;
+   progress << "\nReading callSites file: " << string(filename) << endl;
    // Open the file
    ifstream myfile(filename);
    // check if successfull
    if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << filename << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot open " + string(filename));
    string line;
    unsigned long long totalSize = 0;
    while (myfile.good())
@@ -62,8 +60,8 @@ void readCallSitesFile(const char *filename, vector<CallSite>& callSites, PageMa
          continue;
 
       std::cmatch result;       //!j9x 0xstart,0xsize	               filename:lineNo
-      std::regex  pattern1("\\s*\\!j9x 0x([0-9A-F]+),0x([0-9A-F]+)\\s+(\\S+):(\\d+)");
-      std::regex  pattern2("\\s*\\!j9x 0x([0-9A-F]+),0x([0-9A-F]+)\\s+(\\S+)");
+      static const std::regex pattern1("\\s*\\!j9x 0x([0-9A-F]+),0x([0-9A-F]+)\\s+(\\S+):(\\d+)");
+      static const std::regex pattern2("\\s*\\!j9x 0x([0-9A-F]+),0x([0-9A-F]+)\\s+(\\S+)");
       bool match1, match2;
       if ((match1 = std::regex_search(line.c_str(), result, pattern1)) ||
           (match2 = std::regex_search(line.c_str(), result, pattern2)))
@@ -79,18 +77,16 @@ void readCallSitesFile(const char *filename, vector<CallSite>& callSites, PageMa
          }
       else // try another pattern
          {
-         cerr << "No match for:" << line << endl;
-         exit(-1);
+         throw runtime_error("No match for:" + line);
          }
       }
    myfile.close();
-   cout << "Total size of call sites: " << (totalSize >> 10) << " KB"<< endl;
+   progress << "Total size of call sites: " << (totalSize >> 10) << " KB"<< endl;
    }
 
 
-void CallSite::print(std::ostream& os) const
+void CallSite::format(BufferedWriter& out) const
    {
-   os << hex << "Start=" << setfill('0') << setw(16) << getStart() <<
-      " End=" << setfill('0') << setw(16) << getEnd() << dec <<
-      " Size=" << setfill(' ') << std::dec << setw(5) << sizeKB()  << " KB @" << _filename << ":" << _lineNo;
+   out.write("Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16)
+      .write(" Size=").dec(sizeKB(), 5).write(" KB @").write(_filename).put(':').dec(_lineNo);
    }
@@ -21,6 +21,9 @@
  *******************************************************************************/
 #ifndef _CALLSITE_HPP__
 #define _CALLSITE_HPP__
+#include <iostream>
+#include <vector>
+#include <string>
 #include "AddrRange.hpp"
 class PageMapReader;
 
@@ -31,6 +34,8 @@ class CallSite : public AddrRange
    public:
       CallSite(unsigned long long startAddr, unsigned long long endAddr, const std::string& filename, int lineNo, unsigned long long rss) :
          AddrRange(startAddr, endAddr, rss), _filename(filename), _lineNo(lineNo) {}
+      const std::string& getFilename() const { return _filename; }
+      unsigned getLineNo() const { return _lineNo; }
       virtual void clear()
          {
          AddrRange::clear();
@@ -39,11 +44,12 @@ class CallSite : public AddrRange
          }
       virtual int rangeType() const override { return CALLSITE_RANGE; }
       virtual RangeCategories getRangeCategory() const override { return CALLSITE; }
-   protected:
-      virtual void print(std::ostream& os) const;
+      virtual void format(BufferedWriter& out) const override;
    }; //  AddrRange
 
-void readCallSitesFile(const char *filename, std::vector<CallSite>& callSites, PageMapReader *pageMapReader);
+// Throws std::runtime_error if the file cannot be read or parsed. The progress messages go
+// to 'progress', so that a reader running on its own thread can buffer them
+void readCallSitesFile(const char *filename, std::vector<CallSite>& callSites, PageMapReader *pageMapReader, std::ostream& progress = std::cout);
 
 
 #endif // _CALLSITE_HPP__
\ No newline at end of file
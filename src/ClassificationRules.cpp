@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <algorithm> // for merge, find
+#include <cstdlib> // for exit
+#include "ClassificationRules.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+/*
+The default rules. Shared libraries have .so in their name, but the name does not necessarily
+end with .so (e.g. /usr/lib/libXext.so.6.4.0). The shared class cache is a mapped file in
+javasharedresources, or a file named after classCache or with the .scc extension
+*/
+static const char * const defaultRules[][2] = {
+   { "^[stack",             "STACK" },
+   { ".so$",                "DLL" },
+   { ".so.",                "DLL" },
+   { "javasharedresources", "SCC" },
+   { "classCache",          "SCC" },
+   { ".scc",                "SCC" },
+};
+
+MapClassifier::MapClassifier()
+   {
+   for (auto rule : defaultRules)
+      addRule(rule[0], rule[1], _rules);
+   compile();
+   }
+
+void MapClassifier::addRule(const string& pattern, const string& classification, vector<ClassificationRule>& rules) const
+   {
+   ClassificationRule rule;
+   rule._pattern = pattern;
+   if (!rule._pattern.empty() && rule._pattern.front() == '^')
+      {
+      rule._anchoredAtStart = true;
+      rule._pattern.erase(0, 1);
+      }
+   if (!rule._pattern.empty() && rule._pattern.back() == '$')
+      {
+      rule._anchoredAtEnd = true;
+      rule._pattern.pop_back();
+      }
+   if (rule._pattern.empty())
+      {
+      cerr << "Classification rule with an empty pattern: " << pattern << endl;
+      exit(-1);
+      }
+   if (classification == "DLL")
+      rule._purpose = MemoryEntry::DLL;
+   else if (classification == "STACK")
+      rule._purpose = MemoryEntry::STACK;
+   else if (classification == "SCC")
+      rule._purpose = MemoryEntry::SCC;
+   else if (find(begin(MemoryEntry::_purposeNames), end(MemoryEntry::_purposeNames), classification) != end(MemoryEntry::_purposeNames))
+      {
+      // The Java heap and the code cache are recognized from the javacore segments
+      cerr << "A classification rule cannot set the purpose " << classification << endl;
+      exit(-1);
+      }
+   else
+      rule._category = classification;
+   rules.push_back(rule);
+   }
+
+/*
+Rules file: one rule per line, the pattern followed by a purpose (DLL, STACK or SCC)
+or by the name of a custom category. Empty lines and lines starting with '#' are ignored.
+   libjemalloc.so   jemalloc
+   ^memfd:          memfd
+   /opt/agent/      agent
+*/
+void MapClassifier::readRulesFile(const char *filename)
+   {
+   ifstream myfile(filename);
+   if (!myfile.is_open())
+      {
+      cerr << "Cannot open " << filename << endl;
+      exit(-1);
+      }
+   vector<ClassificationRule> rules;
+   string line;
+   int lineNo = 0;
+   while (getline(myfile, line))
+      {
+      lineNo++;
+      vector<string> tokens;
+      tokenize(line, tokens, " \t\r");
+      if (tokens.empty() || tokens[0][0] == '#')
+         continue;
+      if (tokens.size() != 2)
+         {
+         cerr << "Expected 'pattern classification' on line " << lineNo << " of " << filename << ": " << line << endl;
+         exit(-1);
+         }
+      addRule(tokens[0], tokens[1], rules);
+      }
+   rules.insert(rules.end(), _rules.begin(), _rules.end());
+   _rules.swap(rules);
+   compile();
+   }
+
+// Build the goto trie of all patterns, then fold the failure links into the transitions
+// (breadth first) so that classify() follows exactly one transition per character
+void MapClassifier::compile()
+   {
+   _states.assign(1, State());
+   fill(begin(_states[0]._next), end(_states[0]._next), -1);
+   for (size_t ruleIndex = 0; ruleIndex < _rules.size(); ruleIndex++)
+      {
+      int state = 0;
+      for (unsigned char c : _rules[ruleIndex]._pattern)
+         {
+         if (_states[state]._next[c] < 0)
+            {
+            _states[state]._next[c] = (int)_states.size();
+            _states.push_back(State());
+            fill(begin(_states.back()._next), end(_states.back()._next), -1);
+            }
+         state = _states[state]._next[c];
+         }
+      _states[state]._matches.push_back((int)ruleIndex);
+      }
+
+   vector<int> failure(_states.size(), 0);
+   queue<int> toVisit;
+   for (int c = 0; c < 256; c++)
+      {
+      int child = _states[0]._next[c];
+      if (child < 0)
+         {
+         _states[0]._next[c] = 0;
+         }
+      else
+         {
+         failure[child] = 0;
+         toVisit.push(child);
+         }
+      }
+   while (!toVisit.empty())
+      {
+      int state = toVisit.front();
+      toVisit.pop();
+      // Patterns that end in the failure state also end here
+      const vector<int>& inherited = _states[failure[state]]._matches;
+      if (!inherited.empty())
+         {
+         vector<int> matches;
+         std::merge(_states[state]._matches.begin(), _states[state]._matches.end(), inherited.begin(), inherited.end(), back_inserter(matches));
+         _states[state]._matches.swap(matches);
+         }
+      for (int c = 0; c < 256; c++)
+         {
+         int child = _states[state]._next[c];
+         if (child < 0)
+            {
+            _states[state]._next[c] = _states[failure[state]]._next[c];
+            }
+         else
+            {
+            failure[child] = _states[failure[state]]._next[c];
+            toVisit.push(child);
+            }
+         }
+      }
+   }
+
+const ClassificationRule *MapClassifier::classify(string_view path) const
+   {
+   int best = -1;
+   int state = 0;
+   for (size_t pos = 0; pos < path.size(); pos++)
+      {
+      state = _states[state]._next[(unsigned char)path[pos]];
+      for (int ruleIndex : _states[state]._matches)
+         {
+         if (best >= 0 && ruleIndex >= best)
+            break; // matches are sorted
+         const ClassificationRule& rule = _rules[ruleIndex];
+         if (rule._anchoredAtStart && pos + 1 != rule._pattern.size())
+            continue;
+         if (rule._anchoredAtEnd && pos + 1 != path.size())
+            continue;
+         best = ruleIndex;
+         }
+      }
+   return best >= 0 ? &_rules[best] : nullptr;
+   }
+
+MapClassifier& getMapClassifier()
+   {
+   static MapClassifier classifier;
+   return classifier;
+   }
+
+void classifyMap(MemoryEntry& entry)
+   {
+   const ClassificationRule *rule = getMapClassifier().classify(entry.getDetailsString());
+   if (!rule)
+      return;
+   if (rule->_purpose != MemoryEntry::UNKNOWN)
+      entry.setPurpose(rule->_purpose);
+   else
+      entry._customCategory = rule->_category;
+   }
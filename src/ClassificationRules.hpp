@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _CLASSIFICATIONRULES_HPP__
+#define _CLASSIFICATIONRULES_HPP__
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MemoryEntry.hpp"
+
+// A rule classifies the maps whose path (details) contains _pattern.
+// '^' at the start of the pattern in a rules file anchors it to the start of the path,
+// '$' at the end anchors it to the end of the path
+struct ClassificationRule
+   {
+   std::string _pattern;
+   bool _anchoredAtStart = false;
+   bool _anchoredAtEnd = false;
+   MemoryEntry::SmapPurpose _purpose = MemoryEntry::UNKNOWN; // UNKNOWN for a custom category
+   std::string _category; // custom category, e.g. "jemalloc"; empty if the rule sets a purpose
+   };
+
+// All rules compiled into one Aho-Corasick automaton, so that a path is classified
+// in a single pass over its characters no matter how many rules there are.
+// When several rules match, the one that comes first wins
+class MapClassifier
+   {
+   public:
+      MapClassifier(); // the default rules that recognize shared libraries, thread stacks and the shared class cache
+      void readRulesFile(const char *filename); // rules from the file take precedence over the ones already known
+      const ClassificationRule *classify(std::string_view path) const; // nullptr if no rule matches
+      const std::vector<ClassificationRule>& getRules() const { return _rules; }
+   private:
+      void addRule(const std::string& pattern, const std::string& classification, std::vector<ClassificationRule>& rules) const;
+      void compile();
+      struct State
+         {
+         int _next[256];           // DFA transitions, failure links already folded in
+         std::vector<int> _matches; // rules whose pattern ends in this state, sorted
+         };
+      std::vector<ClassificationRule> _rules;
+      std::vector<State> _states;
+   };
+
+// The rules used when maps are read
+MapClassifier& getMapClassifier();
+
+// Set the purpose or the custom category of a map from the first rule that matches its details
+void classifyMap(MemoryEntry& entry);
+
+#endif // _CLASSIFICATIONRULES_HPP__
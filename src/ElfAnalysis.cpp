@@ -0,0 +1,471 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm> // for sort, upper_bound
+#include <cstdlib> // for getenv, free
+#include <cstring> // for strnlen, memcmp
+#include <cerrno>
+#include <cstdio> // for rename
+#include <cxxabi.h> // for __cxa_demangle
+#include <elf.h>
+#include <fcntl.h> // for open
+#include <unistd.h> // for close
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat, mkdir
+#include "ElfAnalysis.hpp"
+#include "smap.hpp"
+#include "PageMapSupport.hpp"
+
+using namespace std;
+
+// Directory where parsed ELF data is kept between runs.
+// $FOOTPRINT_CACHE_DIR, $XDG_CACHE_HOME/footprintAnalysis or ~/.cache/footprintAnalysis
+std::string getElfCacheDir()
+   {
+   const char *dir = getenv("FOOTPRINT_CACHE_DIR");
+   if (dir && *dir)
+      return string(dir) + "/elf";
+   dir = getenv("XDG_CACHE_HOME");
+   if (dir && *dir)
+      return string(dir) + "/footprintAnalysis/elf";
+   dir = getenv("HOME");
+   if (dir && *dir)
+      return string(dir) + "/.cache/footprintAnalysis/elf";
+   return string();
+   }
+
+static bool makeDirectories(const string& path)
+   {
+   for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+      {
+      string dir = path.substr(0, pos);
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+         return false;
+      if (pos == string::npos)
+         return true;
+      }
+   }
+
+// All offsets come from the file, so every access is checked against the size of the image
+template <typename T>
+static const T *elfPtr(const unsigned char *image, size_t imageSize, unsigned long long offset, unsigned long long count = 1)
+   {
+   if (offset > imageSize || count > (imageSize - offset) / sizeof(T))
+      return nullptr;
+   return reinterpret_cast<const T *>(image + offset);
+   }
+
+static string elfString(const unsigned char *image, size_t imageSize, const Elf64_Shdr& strtab, unsigned long long offset)
+   {
+   if (offset >= strtab.sh_size || strtab.sh_offset + offset >= imageSize)
+      return string();
+   const char *str = reinterpret_cast<const char *>(image + strtab.sh_offset + offset);
+   return string(str, strnlen(str, imageSize - strtab.sh_offset - offset));
+   }
+
+static const Elf64_Ehdr *getElfHeader(const unsigned char *image, size_t imageSize)
+   {
+   const Elf64_Ehdr *ehdr = elfPtr<Elf64_Ehdr>(image, imageSize, 0);
+   if (!ehdr || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+       ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+      return nullptr;
+   return ehdr;
+   }
+
+// The build-id is found in a PT_NOTE segment, so only the first pages of the file are touched
+static string readBuildId(const unsigned char *image, size_t imageSize, const Elf64_Ehdr *ehdr)
+   {
+   const Elf64_Phdr *phdrs = elfPtr<Elf64_Phdr>(image, imageSize, ehdr->e_phoff, ehdr->e_phnum);
+   if (!phdrs)
+      return string();
+   for (unsigned i = 0; i < ehdr->e_phnum; i++)
+      {
+      if (phdrs[i].p_type != PT_NOTE)
+         continue;
+      unsigned long long pos = phdrs[i].p_offset;
+      unsigned long long end = pos + phdrs[i].p_filesz;
+      while (pos + sizeof(Elf64_Nhdr) <= end)
+         {
+         const Elf64_Nhdr *note = elfPtr<Elf64_Nhdr>(image, imageSize, pos);
+         if (!note)
+            break;
+         unsigned long long nameOffset = pos + sizeof(Elf64_Nhdr);
+         unsigned long long descOffset = nameOffset + ((note->n_namesz + 3) & ~3ULL);
+         const unsigned char *desc = elfPtr<unsigned char>(image, imageSize, descOffset, note->n_descsz);
+         if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && desc &&
+             memcmp(image + nameOffset, "GNU", 4) == 0)
+            {
+            ostringstream buildId;
+            buildId << hex << setfill('0');
+            for (unsigned b = 0; b < note->n_descsz; b++)
+               buildId << setw(2) << (unsigned)desc[b];
+            return buildId.str();
+            }
+         pos = descOffset + ((note->n_descsz + 3) & ~3ULL);
+         }
+      }
+   return string();
+   }
+
+bool ElfImage::parse(const unsigned char *image, size_t imageSize)
+   {
+   const Elf64_Ehdr *ehdr = getElfHeader(image, imageSize);
+   const Elf64_Phdr *phdrs = ehdr ? elfPtr<Elf64_Phdr>(image, imageSize, ehdr->e_phoff, ehdr->e_phnum) : nullptr;
+   const Elf64_Shdr *shdrs = ehdr ? elfPtr<Elf64_Shdr>(image, imageSize, ehdr->e_shoff, ehdr->e_shnum) : nullptr;
+   if (!phdrs || !shdrs || ehdr->e_shstrndx >= ehdr->e_shnum)
+      return false;
+
+   for (unsigned i = 0; i < ehdr->e_phnum; i++)
+      if (phdrs[i].p_type == PT_LOAD)
+         _loadSegments.push_back(ElfLoadSegment{phdrs[i].p_offset, phdrs[i].p_vaddr, phdrs[i].p_filesz, phdrs[i].p_memsz});
+
+   const Elf64_Shdr& shstrtab = shdrs[ehdr->e_shstrndx];
+   const Elf64_Shdr *symtab = nullptr;
+   for (unsigned i = 0; i < ehdr->e_shnum; i++)
+      {
+      if ((shdrs[i].sh_flags & SHF_ALLOC) && shdrs[i].sh_size > 0)
+         _sections.push_back(ElfSection{elfString(image, imageSize, shstrtab, shdrs[i].sh_name), shdrs[i].sh_addr, shdrs[i].sh_size});
+      // Prefer the full symbol table; stripped libraries only have the dynamic one
+      if (shdrs[i].sh_type == SHT_SYMTAB || (shdrs[i].sh_type == SHT_DYNSYM && !symtab))
+         symtab = &shdrs[i];
+      }
+
+   if (symtab && symtab->sh_link < ehdr->e_shnum)
+      {
+      const Elf64_Shdr& strtab = shdrs[symtab->sh_link];
+      unsigned long long numSymbols = symtab->sh_size / sizeof(Elf64_Sym);
+      const Elf64_Sym *syms = elfPtr<Elf64_Sym>(image, imageSize, symtab->sh_offset, numSymbols);
+      for (unsigned long long i = 0; syms && i < numSymbols; i++)
+         {
+         unsigned char type = ELF64_ST_TYPE(syms[i].st_info);
+         if ((type != STT_FUNC && type != STT_OBJECT) || syms[i].st_size == 0 ||
+             syms[i].st_shndx == SHN_UNDEF || syms[i].st_shndx >= SHN_LORESERVE)
+            continue;
+         _symbols.push_back(ElfSymbol{syms[i].st_value, syms[i].st_size, type == STT_FUNC, elfString(image, imageSize, strtab, syms[i].st_name)});
+         }
+      }
+   // Sort by address and drop aliases (several names for the same code or data)
+   sort(_symbols.begin(), _symbols.end(),
+        [](const ElfSymbol& s1, const ElfSymbol& s2) { return s1._value < s2._value || (s1._value == s2._value && s1._size > s2._size); });
+   _symbols.erase(unique(_symbols.begin(), _symbols.end(),
+                         [](const ElfSymbol& s1, const ElfSymbol& s2) { return s1._value == s2._value && s1._size == s2._size; }),
+                  _symbols.end());
+   return true;
+   }
+
+/*
+Cache file format (numbers in hex):
+ELFSYMBOLS 1 <build-id>
+L <offset> <vaddr> <fileSize> <memSize>
+S <addr> <size> <name>
+F|O <value> <size> <name>
+*/
+bool ElfImage::readCache(const string& cacheFilename)
+   {
+   ifstream cacheFile(cacheFilename);
+   if (!cacheFile.is_open())
+      return false;
+   string magic, buildId;
+   int version = 0;
+   cacheFile >> magic >> version >> buildId;
+   if (magic != "ELFSYMBOLS" || version != 1 || buildId != _buildId)
+      return false;
+   cacheFile >> hex;
+   string kind, name;
+   while (cacheFile >> kind)
+      {
+      if (kind == "L")
+         {
+         ElfLoadSegment load;
+         cacheFile >> load._offset >> load._vaddr >> load._fileSize >> load._memSize;
+         _loadSegments.push_back(load);
+         }
+      else
+         {
+         unsigned long long addr, size;
+         cacheFile >> addr >> size;
+         cacheFile.get(); // the space before the name
+         getline(cacheFile, name);
+         if (kind == "S")
+            _sections.push_back(ElfSection{name, addr, size});
+         else
+            _symbols.push_back(ElfSymbol{addr, size, kind == "F", name});
+         }
+      }
+   return !cacheFile.bad();
+   }
+
+// Write to a temporary file first, so that concurrent runs never see a partial cache file
+void ElfImage::writeCache(const string& cacheFilename) const
+   {
+   string tmpFilename = cacheFilename + ".tmp" + to_string(getpid());
+   ofstream cacheFile(tmpFilename);
+   if (!cacheFile.is_open())
+      return;
+   cacheFile << "ELFSYMBOLS 1 " << _buildId << "\n" << hex;
+   for (auto& load : _loadSegments)
+      cacheFile << "L " << load._offset << " " << load._vaddr << " " << load._fileSize << " " << load._memSize << "\n";
+   for (auto& section : _sections)
+      cacheFile << "S " << section._addr << " " << section._size << " " << section._name << "\n";
+   for (auto& symbol : _symbols)
+      cacheFile << (symbol._isFunction ? "F " : "O ") << symbol._value << " " << symbol._size << " " << symbol._name << "\n";
+   cacheFile.close();
+   if (cacheFile.fail() || rename(tmpFilename.c_str(), cacheFilename.c_str()) != 0)
+      unlink(tmpFilename.c_str());
+   }
+
+/**
+ * Load the ELF information of a library, from the cache if the build-id is known,
+ * otherwise by parsing the file (which is then added to the cache).
+ * Returns false if the file cannot be read or is not a 64-bit little-endian ELF file
+*/
+bool ElfImage::load(const string& path, const string& cacheDir)
+   {
+   _path = path;
+   int fd = open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+      return false;
+   struct stat st;
+   void *mapping = MAP_FAILED;
+   if (fstat(fd, &st) == 0 && st.st_size > 0)
+      mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (mapping == MAP_FAILED)
+      return false;
+   const unsigned char *image = static_cast<const unsigned char *>(mapping);
+   size_t imageSize = st.st_size;
+
+   bool success = false;
+   const Elf64_Ehdr *ehdr = getElfHeader(image, imageSize);
+   if (ehdr)
+      {
+      _buildId = readBuildId(image, imageSize, ehdr);
+      string cacheFilename = (cacheDir.empty() || _buildId.empty()) ? string() : cacheDir + "/" + _buildId + ".sym";
+      if (!cacheFilename.empty() && readCache(cacheFilename))
+         {
+         success = true;
+         }
+      else
+         {
+         _loadSegments.clear(); _sections.clear(); _symbols.clear();
+         success = parse(image, imageSize);
+         if (success && !cacheFilename.empty() && makeDirectories(cacheDir))
+            writeCache(cacheFilename);
+         }
+      }
+   munmap(mapping, imageSize);
+   return success;
+   }
+
+// Resident bytes of [start, end) over all the maps that overlap it (maps are sorted by address)
+static unsigned long long residentBytesInRange(const vector<SmapEntry>& smaps, PageMapReader *pageMapReader,
+                                               unsigned long long start, unsigned long long end)
+   {
+   unsigned long long rss = 0;
+   auto crtMap = upper_bound(smaps.begin(), smaps.end(), start,
+                             [](unsigned long long addr, const SmapEntry& map) { return addr < map.getEnd(); });
+   for (; crtMap != smaps.end() && crtMap->getStart() < end; ++crtMap)
+      {
+      const vector<bool>& present = pageMapReader->getPresentPagesForVma(crtMap->getStart(), crtMap->getEnd());
+      rss += pageMapReader->countResidentBytes(present, crtMap->getStart(), max(start, crtMap->getStart()), min(end, crtMap->getEnd()));
+      }
+   return rss;
+   }
+
+static string demangle(const string& name)
+   {
+   int status = 0;
+   char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+   if (status != 0 || !demangled)
+      return name;
+   string result(demangled);
+   free(demangled);
+   return result;
+   }
+
+struct SymbolResidency
+   {
+   const ElfSymbol   *_symbol;
+   unsigned long long _resident;
+   };
+
+struct DllResidency
+   {
+   string             _path;
+   unsigned long long _rssKB = 0; // from smaps
+   unsigned long long _textSize = 0;
+   unsigned long long _textResident = 0;
+   unsigned long long _touchedFunctionBytes = 0; // size of the functions with at least one resident byte
+   size_t             _numSymbols = 0;
+   bool               _loaded = false;
+   };
+
+/**
+ * Map the resident pages of a library back to its sections and symbols.
+ * The load bias is found by matching the file offset of a map with the
+ * offset of a PT_LOAD segment.
+*/
+static void analyzeDll(const ElfImage& image, const vector<const SmapEntry*>& dllMaps, const vector<SmapEntry>& smaps,
+                       PageMapReader *pageMapReader, bool printDetails, DllResidency& dll)
+   {
+   const unsigned long long pageSize = pageMapReader->getPageSize();
+   bool biasFound = false;
+   unsigned long long bias = 0;
+   for (auto crtMap : dllMaps)
+      {
+      for (auto& load : image.getLoadSegments())
+         {
+         if ((load._offset & ~(pageSize - 1)) == crtMap->_offset)
+            {
+            bias = crtMap->getStart() - (load._vaddr & ~(pageSize - 1));
+            biasFound = true;
+            break;
+            }
+         }
+      if (biasFound)
+         break;
+      }
+   if (!biasFound)
+      {
+      cerr << "Cannot determine the load address of " << image.getPath() << endl;
+      return;
+      }
+   dll._loaded = true;
+   dll._numSymbols = image.getSymbols().size();
+
+   vector<SymbolResidency> symbols;
+   symbols.reserve(image.getSymbols().size());
+   for (auto& symbol : image.getSymbols())
+      {
+      unsigned long long resident = residentBytesInRange(smaps, pageMapReader, bias + symbol._value, bias + symbol._value + symbol._size);
+      symbols.push_back(SymbolResidency{&symbol, resident});
+      if (symbol._isFunction && resident > 0)
+         dll._touchedFunctionBytes += symbol._size;
+      }
+
+   if (printDetails)
+      cout << "\n" << image.getPath() << " (build-id " << (image.getBuildId().empty() ? "none" : image.getBuildId()) << ")\n" <<
+              setw(24) << "Section" << setw(12) << "SizeKB" << setw(12) << "ResidentKB" << setw(15) << "NonResidentKB\n";
+   for (auto& section : image.getSections())
+      {
+      unsigned long long resident = residentBytesInRange(smaps, pageMapReader, bias + section._addr, bias + section._addr + section._size);
+      if (section._name == ".text")
+         {
+         dll._textSize = section._size;
+         dll._textResident = resident;
+         }
+      if (printDetails)
+         cout << setw(24) << section._name << setw(12) << (section._size >> 10) << setw(12) << (resident >> 10) <<
+                 setw(14) << ((section._size - resident) >> 10) << "\n";
+      }
+   if (!printDetails)
+      return;
+
+   const size_t topN = 10;
+   size_t n = min(topN, symbols.size());
+   partial_sort(symbols.begin(), symbols.begin() + n, symbols.end(),
+                [](const SymbolResidency& s1, const SymbolResidency& s2) { return s1._resident > s2._resident; });
+   cout << "  Symbols with the most resident bytes:\n";
+   for (size_t i = 0; i < n && symbols[i]._resident > 0; i++)
+      cout << setw(12) << symbols[i]._resident << " of " << setw(10) << symbols[i]._symbol->_size << " bytes  " << demangle(symbols[i]._symbol->_name) << "\n";
+   // Functions that are never touched are dead weight on disk but not in memory;
+   // large non-resident functions that share pages with hot code are what reordering would fix
+   partial_sort(symbols.begin(), symbols.begin() + n, symbols.end(),
+                [](const SymbolResidency& s1, const SymbolResidency& s2) { return s1._symbol->_size - s1._resident > s2._symbol->_size - s2._resident; });
+   cout << "  Symbols with the most non-resident bytes:\n";
+   for (size_t i = 0; i < n && symbols[i]._symbol->_size > symbols[i]._resident; i++)
+      cout << setw(12) << symbols[i]._symbol->_size - symbols[i]._resident << " of " << setw(10) << symbols[i]._symbol->_size << " bytes  " << demangle(symbols[i]._symbol->_name) << "\n";
+
+   if (dll._textSize > 0)
+      {
+      // If all touched functions were packed together they would need this many pages
+      unsigned long long residentPages = (dll._textResident + pageSize - 1) / pageSize;
+      unsigned long long packedPages = (dll._touchedFunctionBytes + pageSize - 1) / pageSize;
+      const unsigned long long hugePageSize = 2 * 1024 * 1024;
+      unsigned long long hugePages = (dll._textSize + hugePageSize - 1) / hugePageSize;
+      cout << "  .text: " << (dll._textResident >> 10) << " KB resident in " << residentPages << " pages; touched functions total " <<
+              (dll._touchedFunctionBytes >> 10) << " KB (" << packedPages << " pages if packed together)\n";
+      if (residentPages > packedPages)
+         cout << "  Function reordering could save up to " << ((residentPages - packedPages) * pageSize >> 10) << " KB\n";
+      cout << "  Backing .text with 2MB pages would make " << ((hugePages * hugePageSize) >> 10) << " KB resident (" <<
+              hugePages << " TLB entries instead of " << residentPages << ")\n";
+      }
+   }
+
+/**
+ * For every shared library in the smaps, open the file on disk, read its
+ * symbol table and report how many bytes of each section and symbol are
+ * resident. Details are printed for the five libraries with the largest RSS,
+ * or for all libraries in verbose mode.
+*/
+void printDllSymbolResidency(const vector<SmapEntry>& smaps, PageMapReader *pageMapReader, bool verbose)
+   {
+   map<string, vector<const SmapEntry*>> dllMaps; // all maps of a library, keyed by path
+   for (auto& crtMap : smaps)
+      if (crtMap.getPurpose() == SmapEntry::DLL)
+         dllMaps[crtMap.getDetailsString()].push_back(&crtMap);
+
+   vector<DllResidency> dlls;
+   for (auto& dll : dllMaps)
+      {
+      DllResidency residency;
+      residency._path = dll.first;
+      for (auto crtMap : dll.second)
+         residency._rssKB += crtMap->getResidentSizeKB();
+      dlls.push_back(residency);
+      }
+   sort(dlls.begin(), dlls.end(), [](const DllResidency& d1, const DllResidency& d2) { return d1._rssKB > d2._rssKB; });
+
+   cout << "\nResidency of shared library sections and symbols:\n";
+   string cacheDir = getElfCacheDir();
+   const size_t numDetailed = 5;
+   for (size_t i = 0; i < dlls.size(); i++)
+      {
+      ElfImage image;
+      if (!image.load(dlls[i]._path, cacheDir))
+         {
+         cerr << "Cannot read ELF file " << dlls[i]._path << endl;
+         continue;
+         }
+      analyzeDll(image, dllMaps[dlls[i]._path], smaps, pageMapReader, verbose || i < numDetailed, dlls[i]);
+      }
+
+   cout << "\nSummary of .text residency:\n";
+   cout << setw(10) << "RSSKB" << setw(12) << "TextKB" << setw(12) << "ResidentKB" << setw(10) << "Resident" << setw(12) << "TouchedKB" << setw(10) << "Symbols" << "  Library\n";
+   for (auto& dll : dlls)
+      {
+      cout << setw(10) << dll._rssKB;
+      if (dll._loaded)
+         cout << setw(12) << (dll._textSize >> 10) << setw(12) << (dll._textResident >> 10) <<
+                 setw(9) << (dll._textSize ? dll._textResident * 100 / dll._textSize : 0) << "%" <<
+                 setw(12) << (dll._touchedFunctionBytes >> 10) << setw(10) << dll._numSymbols;
+      else
+         cout << setw(56) << "not analyzed";
+      cout << "  " << dll._path << "\n";
+      }
+   }
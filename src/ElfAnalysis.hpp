@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _ELFANALYSIS_HPP__
+#define _ELFANALYSIS_HPP__
+#include <string>
+#include <vector>
+class SmapEntry;
+class PageMapReader;
+
+struct ElfSection
+   {
+   std::string        _name;
+   unsigned long long _addr;
+   unsigned long long _size;
+   };
+
+// PT_LOAD program header: how a part of the file is mapped in memory
+struct ElfLoadSegment
+   {
+   unsigned long long _offset;
+   unsigned long long _vaddr;
+   unsigned long long _fileSize;
+   unsigned long long _memSize;
+   };
+
+struct ElfSymbol
+   {
+   unsigned long long _value; // address relative to the load bias
+   unsigned long long _size;
+   bool               _isFunction;
+   std::string        _name;
+   };
+
+// Sections, load segments and sized symbols of an ELF64 shared library.
+// Parsed data is cached on disk, keyed by the GNU build-id of the library,
+// so that a library is parsed only once across runs
+class ElfImage
+   {
+   std::string                 _path;
+   std::string                 _buildId; // hex string; empty if the library has no build-id note
+   std::vector<ElfSection>     _sections; // allocated sections only
+   std::vector<ElfLoadSegment> _loadSegments;
+   std::vector<ElfSymbol>      _symbols; // sorted by address
+   bool parse(const unsigned char *image, size_t imageSize);
+   bool readCache(const std::string& cacheFilename);
+   void writeCache(const std::string& cacheFilename) const;
+   public:
+      bool load(const std::string& path, const std::string& cacheDir);
+      const std::string& getPath() const { return _path; }
+      const std::string& getBuildId() const { return _buildId; }
+      const std::vector<ElfSection>& getSections() const { return _sections; }
+      const std::vector<ElfLoadSegment>& getLoadSegments() const { return _loadSegments; }
+      const std::vector<ElfSymbol>& getSymbols() const { return _symbols; }
+   }; // ElfImage
+
+std::string getElfCacheDir();
+void printDllSymbolResidency(const std::vector<SmapEntry>& smaps, PageMapReader *pageMapReader, bool verbose);
+
+#endif // _ELFANALYSIS_HPP__
@@ -21,120 +21,55 @@
  *******************************************************************************/
 #include <vector>
 #include <iostream>
+#include <fstream>
 #include <unordered_map>
+#include <map>
 #include <utility> // for std::pair
 #include <algorithm> // for sort
 #include <type_traits> // for is_same_v<>
+#include <cstring> // for strcmp
 #include <unistd.h> // for getopt
+#include <fcntl.h> // for open
+#include <exception>
 #include "smap.hpp"
 #include "CallSites.hpp"
 #include "Util.hpp"
 #include "vmmap.hpp"
 #include "AddrRange.hpp"
 #include "PageMapSupport.hpp"
-#undef WINDOWS_FOOTPRINT
+#include "Attribution.hpp"
+#include "TimeSeries.hpp"
+#include "VerboseGC.hpp"
+#include "JitVerboseLog.hpp"
+#include "PerfMap.hpp"
+#include "ElfAnalysis.hpp"
+#include "ResultWriter.hpp"
+#include "Pprof.hpp"
+#include "FootprintDiff.hpp"
+#include "InputFormat.hpp"
+#include "BufferedWriter.hpp"
+#include "ClassificationRules.hpp"
+#include "ResidencyHistogram.hpp"
+#include "RssReconciliation.hpp"
+#include "Sampler.hpp"
+#include "SampleStore.hpp"
+#include "HeadroomForecast.hpp"
+#include "InputPipeline.hpp"
+#include "HostAnalysis.hpp"
 using namespace std;
 
 
-// T can be either a J9Segment or a CallSite
-template <typename MAPENTRY, typename T>
-void annotateMapWithSegments(std::vector<MAPENTRY>&maps, const std::vector<T>& segments)
-   {
-   // Annotate maps with j9segments
-   cout << "Annotate maps with segments ...";
-   for (auto map = maps.begin(); map != maps.end(); ++map)
-      {
-      for (auto seg = segments.cbegin(); seg != segments.cend(); ++seg)
-         {
-         if (seg->disjoint(map->getAddrRange()))
-            continue;
-         if (map->getAddrRange().includes(*seg))
-            {
-            map->addCoveringRange(*seg);
-            // For segments, lets identify the maps that are covered by Java heap segments or CODECACHES
-            if constexpr (std::is_same_v<T, J9Segment>)
-               {
-               if (seg->getSegmentType() == J9Segment::JAVAHEAP)
-                  map->setPurpose(SmapEntry::JAVAHEAP);
-               if (seg->getSegmentType() == J9Segment::CODECACHE)
-                  map->setPurpose(SmapEntry::CODECACHE);
-               }
-            }
-         else
-            {
-            cerr << "Overlapping range SEG:" << *seg << " and SMAP:" << *map << endl;
-            map->addOverlappingRange(*seg);
-            //map->setPurpose(SmapEntry::GENERIC);
-            }
-         }
-      }
-   cout << "Done\n";
-   }
-
-template <typename MAPENTRY>
-void annotateMapWithThreadStacks(std::vector<MAPENTRY>&maps, std::vector<ThreadStack>& stacks)
-   {
-   // Annotate maps with threadStacks
-   cout << "Annotate maps with threads stacks ...";
-   for (auto map = maps.begin(); map != maps.end(); ++map)
-      {
-      for (auto stackRegion = stacks.begin(); stackRegion != stacks.end(); ++stackRegion)
-         {
-         if (stackRegion->disjoint(map->getAddrRange()))
-            continue;
-         // A stackRegion usually spans two smaps: one for the stack guard
-         // which is protected to R/W and one for the stack itself
-         // We want to cover the entire stack guard with part of the thread stack and
-         // cover entirely or partially the next smap with the remaining of the thread
-         // stack
-         if (map->getAddrRange().includes(*stackRegion))
-            {
-            map->addCoveringRange(*stackRegion);
-            map->setPurpose(SmapEntry::STACK);
-            break; // go to next smap
-            }
-         else
-            {
-            // This could be our stack guard
-            // Typically the start of the smap is the same as the start of the thread stack
-            if (stackRegion->includes(map->getAddrRange()))
-               {
-               if (stackRegion->getStart() == map->getAddrRange().getStart())
-                  {
-                  // Create a new threadStack just for the size of this smap
-                  // This is not technically a memory leak because we need it till the end of the program
-                  ThreadStack *threadStack = new ThreadStack(map->getAddrRange().getStart(), map->getAddrRange().getEnd(), stackRegion->getThreadName(), 0 /*rss*/);
-                  map->addCoveringRange(*threadStack);
-                  map->setPurpose(SmapEntry::STACK);
-                  // Substract the size of the stack guard from the ThreadStack
-                  // This adjusted ThreadStack will be attributed to the next map
-                  stackRegion->setStart(map->getAddrRange().getEnd());
-                  }
-               }
-            else
-               {
-               cout << "Unexpected situation with ThreadStack " << *stackRegion << " and smap " << *map;
-               map->addOverlappingRange(*stackRegion);
-               }
-            }
-         }
-      }
-   cout << "Done\n";
-   }
-
-
-
 template <typename MAPENTRY>
 unsigned long long printSpaceKBTakenBySharedLibraries(const vector<MAPENTRY> &smaps)
    {
    unsigned long long spaceTakenBySharedLibraries = 0;
-   TopTen<MAPENTRY, MemoryEntrySizeLessThan> topTen;
+   TopK<const MAPENTRY*, PointeeLess<MemoryEntrySizeLessThan>> topTen;
    for (auto crtMap = smaps.cbegin(); crtMap != smaps.cend(); ++crtMap)
       {
       if (crtMap->isMapForSharedLibrary())
          {
          spaceTakenBySharedLibraries += crtMap->sizeKB();
-         topTen.processElement(*crtMap);
+         topTen.processElement(&*crtMap);
          }
       }
    cout << "Total space taken by shared libraries: " << dec << spaceTakenBySharedLibraries << " KB\n";
@@ -144,287 +79,652 @@ unsigned long long printSpaceKBTakenBySharedLibraries(const vector<MAPENTRY> &sm
 
 
 template <typename MAPENTRY>
-void computeProportionalRssContribution(const MAPENTRY &crtMap, bool usePageMap,
-                                        unsigned long long virtualSize[], // output
-                                        unsigned long long rssSize[]) // output
+void printSpaceKBTakenByVmComponents(const vector<MAPENTRY> &smaps, bool usePageMap, size_t topK)
    {
-   const list<const AddrRange*> coveringRanges = crtMap.getCoveringRanges();
-   const list<const AddrRange*> overlapRanges = crtMap.getOverlappingRanges();
-   if (coveringRanges.size() != 0 && overlapRanges.size() != 0)
+   cout << "\nprintSpaceKBTakenByVmComponents...\n";
+
+   FootprintSummary<MAPENTRY> summary(topK);
+   computeFootprintSummary(smaps, usePageMap, summary);
+
+   cout << dec << endl;
+   cout << "Totals:       Virtual= " << setw(8) << (summary._totalVirtSize >> 10) << " KB; RSS= " << setw(8) << (summary._totalRssSize >> 10) << " KB\n";
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
       {
-      cerr << "Warning: smap starting at addr " << crtMap.getAddrRange().getStart() << " has both covering and overlapping ranges\n";
+      cout << setw(11) << AddrRange::RangeCategoryNames[i] << ":  Virtual= " << setw(8) << (summary._virtualSize[i] >> 10) << " KB; RSS= " << setw(8) << (summary._rssSize[i] >> 10) << " KB\n";
       }
 
-   unsigned long long totalCoveredSize = 0;
-   // The following sums up the virtual size for each category covering this smap
-   unsigned long long sz[AddrRange::NUM_CATEGORIES] = {0}; // one entry for each category
+   // Print explanation
+   cout << endl;
+   cout << "Unknown portion comes from maps that are partially covered by segments and callsites" << endl;
+   cout << "'Not covered' are maps that are really not covered by any segment or callsite" << endl;
+
+   // print the most expensive entries
+   cout << "\n RSS of dlls\n";
+   for_each(summary._dllRss.cbegin(), summary._dllRss.cend(),
+            [](const pair<string, unsigned long long>& element)
+                {cout << dec << setw(8) << (element.second >> 10) << " KB   " << element.first << endl; }
+           );
+
+   cout << "\nTop " << topK << " DDLs based on RSS:\n";
+   summary._topDlls.print();
 
-   for (auto seg = coveringRanges.cbegin(); seg != coveringRanges.cend(); ++seg)
+   cout << "\nTop " << topK << " maps not covered by anything\n";
+   summary._topNotCovered.print();
+   }
+
+
+// Memory charged to one segment, call-site or thread stack (see forEachMapAttribution)
+struct RangeAttribution
+   {
+   const AddrRange *_range;
+   unsigned long long _virtualBytes;
+   unsigned long long _rssBytes;
+   };
+
+struct RangeAttributionRssLessThan
+   {
+   bool operator() (const RangeAttribution& r1, const RangeAttribution& r2) const
       {
-      AddrRange::RangeCategories category = (*seg)->getRangeCategory();
-      unsigned long long size = (*seg)->size();
-      virtualSize[category] += size; // virtualSize[] sums up the virtual size of covering ranges for all smaps
-      sz[category] += size; // sz[] sums up the virtual size of covering ranges for this smap
-      totalCoveredSize += size;
-      if (usePageMap)
-         rssSize[category] += (*seg)->getRSS(); // rssSize[] sums up the RSS of covering ranges for all smaps
-      } // end for
-   // When using the pageMap we already have the RSS for each category,
-   // so we can skip estimating the RSS using the proportional scheme based on virtual size
-   if (usePageMap)
-      return;
+      return r1._rssBytes < r2._rssBytes || (r1._rssBytes == r2._rssBytes && r1._virtualBytes < r2._virtualBytes);
+      }
+   };
 
-   // Determine if the smap is covered by more than one type of range
-   int lastNonNullCategory = 0;
-   int numDifferentCategories = 0;
+// For each category, the segments, call-sites and thread stacks with the largest RSS
+template <typename MAPENTRY>
+void printLargestRangesByCategory(const vector<MAPENTRY> &smaps, bool usePageMap, size_t topK)
+   {
+   // A range that overlaps several maps is charged by each of them
+   unordered_map<const AddrRange*, RangeAttribution> rangeTotals;
+   for (const auto& crtMap : smaps)
+      {
+      forEachMapAttribution(crtMap, usePageMap,
+         [&rangeTotals](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            if (!range)
+               return;
+            RangeAttribution& totals = rangeTotals.emplace(range, RangeAttribution{range, 0, 0}).first->second;
+            totals._virtualBytes += virtualBytes;
+            totals._rssBytes += rssBytes;
+            });
+      }
+   vector<TopK<RangeAttribution, RangeAttributionRssLessThan>> topRanges(AddrRange::NUM_CATEGORIES, TopK<RangeAttribution, RangeAttributionRssLessThan>(topK));
+   for (const auto& entry : rangeTotals)
+      topRanges[entry.first->getRangeCategory()].processElement(entry.second);
+
+   cout << "\nLargest ranges by RSS in each category:\n";
    for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
       {
-      if (sz[i] > 0)
-         {
-         numDifferentCategories++;
-         lastNonNullCategory = i;
-         }
+      vector<RangeAttribution> largest = topRanges[i].getSortedElements();
+      if (largest.empty())
+         continue;
+      cout << AddrRange::RangeCategoryNames[i] << ":\n";
+      for (const auto& range : largest)
+         cout << "   RSS=" << dec << setfill(' ') << setw(8) << (range._rssBytes >> 10) << " KB " << *range._range << endl;
       }
-   if (totalCoveredSize > 0)
+   }
+
+// The RSS of each category split into pages that only this process maps and pages that
+// are shared with other processes. smaps gives Private_* and Shared_*, vmmap gives
+// Private WS and Shareable WS, so footprints from Linux and Windows can be compared.
+// The split of a map is applied proportionally to each piece of it that is attributed
+// to a category; maps without this information (e.g. maps files) count as private
+template <typename MAPENTRY>
+void printResidentSharingByCategory(const vector<MAPENTRY> &smaps, bool usePageMap)
+   {
+   unsigned long long privateRss[AddrRange::NUM_CATEGORIES] = {0};
+   unsigned long long sharedRss[AddrRange::NUM_CATEGORIES] = {0};
+   for (const auto& crtMap : smaps)
       {
-      // If the map is covered by segments of the same type
-      // then we can charge the entire RSS to that type
-      if (numDifferentCategories == 1)
-         {
-         rssSize[lastNonNullCategory] += (crtMap.getResidentSizeKB() << 10); // convert to bytes
-         }
-      else // Proportional allocation based on virtual size
-         {
-         unsigned long long rssAccountedFor = 0;
-         for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      unsigned long long privateKB = crtMap.privateResidentKB();
+      unsigned long long sharedKB = crtMap.sharedResidentKB();
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
             {
-            if (sz[i] != 0)
-               {
-               unsigned long long rssFraction = (crtMap.getResidentSizeKB() << 10) * sz[i] / crtMap.size();
-               rssSize[i] += rssFraction;
-               rssAccountedFor += rssFraction;
-               }
-            }
-         rssSize[AddrRange::UNKNOWN] += (crtMap.getResidentSizeKB() << 10) - rssAccountedFor;
-         virtualSize[AddrRange::UNKNOWN] += crtMap.size() - totalCoveredSize;
-         }
+            unsigned long long shared = privateKB + sharedKB > 0 ? (unsigned long long)((double)rssBytes * sharedKB / (privateKB + sharedKB)) : 0;
+            sharedRss[category] += shared;
+            privateRss[category] += rssBytes - shared;
+            });
       }
-   else // This map is not covered by anything
+   cout << "\nRSS by category split into private and shared pages (KB):\n";
+   cout << dec << setfill(' ') << setw(11) << "Category" << setw(12) << "RSS" << setw(12) << "Private" << setw(12) << "Shared" << endl;
+   unsigned long long totalPrivate = 0, totalShared = 0;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
       {
-      // Does it have overlapping ranges?
-      // An overlapping range could happen if smaps are gathered first and then by the time
-      // we collect the javacore the GC expands which makes the GC segment in the javacore
-      // be larger than the smap.
-      if (overlapRanges.size() != 0)
-         {
-         // If the j9segment totally overlaps the smap, then we know the exact type
-         // of j9memory for that smap and the entire RSS can be attributed to that type.
-         // We could relax this heuristic: if the overlapping segments for this smap are of the same kind
-         // then we can guess the kind of memory for the smap.
-         AddrRange::RangeCategories smapCategory = AddrRange::UNKNOWN;
-         for (auto seg = overlapRanges.cbegin(); seg != overlapRanges.cend(); ++seg)
+      cout << setw(11) << AddrRange::RangeCategoryNames[i] << setw(12) << ((privateRss[i] + sharedRss[i]) >> 10)
+           << setw(12) << (privateRss[i] >> 10) << setw(12) << (sharedRss[i] >> 10) << endl;
+      totalPrivate += privateRss[i];
+      totalShared += sharedRss[i];
+      }
+   cout << setw(11) << "Total" << setw(12) << ((totalPrivate + totalShared) >> 10) << setw(12) << (totalPrivate >> 10) << setw(12) << (totalShared >> 10) << endl;
+   }
+
+// Each category as reserved address space, committed (accessible) memory and resident pages.
+// Every piece of a map is charged to exactly one category (see forEachMapAttribution), so
+// reserved >= committed >= resident holds for each category and the totals count every byte once.
+// The committed part of a piece is that of its map: none for "---p" maps, the Committed column
+// for vmmap. J9 segments without MEMORY_TYPE_VIRTUAL are malloc'ed, so they are always committed
+template <typename MAPENTRY>
+void printReservedCommittedResidentByCategory(const vector<MAPENTRY> &smaps, bool usePageMap)
+   {
+   unsigned long long reserved[AddrRange::NUM_CATEGORIES] = {0};
+   unsigned long long committed[AddrRange::NUM_CATEGORIES] = {0};
+   unsigned long long resident[AddrRange::NUM_CATEGORIES] = {0};
+   for (const auto& crtMap : smaps)
+      {
+      const unsigned long long sizeKB = crtMap.sizeKB();
+      if (sizeKB == 0)
+         continue;
+      const unsigned long long reservedKB = crtMap.reservedKB();
+      const unsigned long long committedKB = min(crtMap.committedKB(), reservedKB);
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
             {
-            AddrRange::RangeCategories segCategory = (*seg)->getRangeCategory();
-            if (segCategory == AddrRange::UNKNOWN)
-               {
-               // Type of segment is not known, so type of smap is unknown
-               smapCategory = AddrRange::UNKNOWN;
-               break;
-               }
-            else
+            unsigned long long reservedBytes = (unsigned long long)((long double)virtualBytes * reservedKB / sizeKB);
+            unsigned long long committedBytes = (unsigned long long)((long double)virtualBytes * committedKB / sizeKB);
+            if (range && range->rangeType() == AddrRange::J9SEGMENT_RANGE &&
+                !(static_cast<const J9Segment*>(range)->getFlags() & MEMORY_TYPE_VIRTUAL))
                {
-               if (smapCategory == AddrRange::UNKNOWN) // Not yet set
-                  {
-                  smapCategory = segCategory;
-                  }
-               else // Different types of segments. Cannot determine the type of smap
-                  {
-                  smapCategory = AddrRange::UNKNOWN;
-                  break;
-                  }
+               // The segment is committed; the rest of the piece (the whole map when it has a
+               // sole purpose) is committed like the map
+               unsigned long long segmentBytes = min(range->size(), virtualBytes);
+               committedBytes = segmentBytes + (unsigned long long)((long double)(virtualBytes - segmentBytes) * committedKB / sizeKB);
                }
-            }
-         rssSize[smapCategory] += (crtMap.getResidentSizeKB() << 10);
-         virtualSize[smapCategory] += crtMap.size();
-         if (smapCategory == AddrRange::UNKNOWN)
-            {
-            cout << "smap with different/unknown segments that are not totaly included in this smap\n";
-            //topTenPartiallyCovered.processElement(*crtMap);
-            }
-         }
-      else // This smap is not covered by anything and it does not overlap anything
-         {
-         rssSize[AddrRange::NOTCOVERED] += (crtMap.getResidentSizeKB() << 10);
-         virtualSize[AddrRange::NOTCOVERED] += crtMap.size();
-         }
+            // Resident pages are committed and committed memory is reserved
+            committedBytes = max(committedBytes, rssBytes);
+            reservedBytes = max(reservedBytes, committedBytes);
+            reserved[category] += reservedBytes;
+            committed[category] += committedBytes;
+            resident[category] += rssBytes;
+            });
       }
+   cout << "\nReserved, committed and resident memory by category (KB):\n";
+   cout << dec << setfill(' ') << setw(11) << "Category" << setw(12) << "Reserved" << setw(12) << "Committed" << setw(12) << "Resident"
+        << setw(15) << "ReservedOnly" << endl;
+   unsigned long long totalReserved = 0, totalCommitted = 0, totalResident = 0;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      cout << setw(11) << AddrRange::RangeCategoryNames[i] << setw(12) << (reserved[i] >> 10) << setw(12) << (committed[i] >> 10)
+           << setw(12) << (resident[i] >> 10) << setw(15) << ((reserved[i] - committed[i]) >> 10) << endl;
+      totalReserved += reserved[i];
+      totalCommitted += committed[i];
+      totalResident += resident[i];
+      }
+   cout << setw(11) << "Total" << setw(12) << (totalReserved >> 10) << setw(12) << (totalCommitted >> 10)
+        << setw(12) << (totalResident >> 10) << setw(15) << ((totalReserved - totalCommitted) >> 10) << endl;
+   cout << "Container memory limits apply to the resident memory; address space limits and overcommit to the committed memory\n";
    }
 
-
+// Maps that the classification rules put in a custom category (e.g. jemalloc arenas or agents)
 template <typename MAPENTRY>
-void printSpaceKBTakenByVmComponents(const vector<MAPENTRY> &smaps, bool usePageMap)
+void printCustomCategories(const vector<MAPENTRY> &smaps, bool usePageMap)
    {
-   cout << "\nprintSpaceKBTakenByVmComponents...\n";
+   struct CategoryTotals { unsigned numMaps = 0; unsigned long long virtualBytes = 0; unsigned long long rssBytes = 0; };
+   std::map<string, CategoryTotals> totals;
+   for (const auto& crtMap : smaps)
+      {
+      if (crtMap.getCustomCategory().empty())
+         continue;
+      CategoryTotals& category = totals[crtMap.getCustomCategory()];
+      category.numMaps++;
+      category.virtualBytes += crtMap.size();
+      forEachMapAttribution(crtMap, usePageMap,
+         [&category](AddrRange::RangeCategories, const AddrRange *, unsigned long long, unsigned long long rssBytes)
+            { category.rssBytes += rssBytes; });
+      }
+   if (totals.empty())
+      return;
+   cout << "\nMaps in custom categories of the classification rules:\n";
+   cout << dec << setfill(' ') << setw(20) << left << "Category" << right << setw(8) << "Maps" << setw(14) << "Virtual(KB)" << setw(10) << "RSS(KB)" << endl;
+   for (const auto& category : totals)
+      cout << setw(20) << left << category.first << right << setw(8) << category.second.numMaps
+           << setw(14) << (category.second.virtualBytes >> 10) << setw(10) << (category.second.rssBytes >> 10) << endl;
+   }
 
-   // categories of covering ranges
-   unsigned long long virtualSize[AddrRange::NUM_CATEGORIES] = {0}; // one entry for each category
-   unsigned long long rssSize[AddrRange::NUM_CATEGORIES] = {0}; // one entry for each category
+// Options given on the command line
+struct AnalysisOptions
+   {
+   const char *javacoreFilename = nullptr;
+   const char *callsitesFilename = nullptr;
+   const char *smapsFilename = nullptr;
+   const char *snapshotDirname = nullptr;
+   unsigned long long fromMs = 0, toMs = ~0ULL; // time range of -d when it reads a sample store
+   unsigned long long downsampleMs = 0;
+   unsigned long long limitKB = 0; // container memory limit for the headroom forecast of -d and -i
+   const char *verboseGCFilename = nullptr;
+   const char *jitLogFilename = nullptr;
+   const char *perfMapFilename = nullptr;
+   const char *outputFilename = nullptr;
+   OutputFormat outputFormat = TEXT_OUTPUT;
+   size_t topK = 10;
+   const char *baselineSpec = nullptr;
+   const char *resultsCsvFilename = nullptr;
+   unsigned long long noiseKB = 1024;
+   int pid = 0;
+   bool verbose = false;
+   bool analyzeElf = false;
+   const char *mapListingFilename = nullptr; // -v listing of the maps; stdout if not given
+   const char *rulesFilename = nullptr;
+   unsigned long long residencyChunkKB = 0; // granularity of the residency histograms; 0 if not requested
+   bool residencyStrips = false;
+   double maxSkewPercent = 5.0; // smaps/pagemap skew above which the report is flagged (-p only)
+   bool refuseSkewedReport = false; // refuse instead of flagging
+   SamplerOptions sampler; // used when a sampling interval is given
+   bool sample = false;
+   const char *hostPidSpec = nullptr; // -H: "all" or a list of PIDs
+   };
+
+// Correlate the snapshots with the GC and JIT logs, if given
+void printSnapshotCorrelations(const vector<FootprintSnapshot>& snapshots, const char *verboseGCFilename, const char *jitLogFilename, size_t topK)
+   {
+   if (verboseGCFilename)
+      {
+      vector<GCHeapSample> gcSamples;
+      correlateVerboseGCLog(verboseGCFilename, snapshots, gcSamples);
+      printHeapOccupancy(snapshots, gcSamples);
+      }
+   if (jitLogFilename)
+      {
+      JitScratchReport jitReport(topK);
+      correlateJitVerboseLog(jitLogFilename, snapshots, jitReport);
+      printJitScratchReport(snapshots, jitReport);
+      }
+   }
 
-   TopTen<MAPENTRY, MemoryEntryRssLessThan> topTenDlls;
+// Attribution records of one side of a diff: either a file written with -o csv
+// or the raw inputs given as "smapsFile,javacoreFile[,callsitesFile]"
+void readAnalysisForDiff(const char *spec, vector<AttributionRecord>& records)
+   {
+   if (isSampleStoreSpec(spec))
+      {
+      readSampleStoreRecords(spec, records);
+      return;
+      }
+   vector<string> files;
+   tokenize(spec, files, ",");
+   if (files.size() == 1)
+      {
+      readAttributionRecordsCsv(spec, records);
+      return;
+      }
+   if (files.size() > 3)
+      {
+      cerr << "Expected smapsFile,javacoreFile[,callsitesFile] or a CSV results file instead of " << spec << endl;
+      exit(-1);
+      }
+   InputPipeline inputs(files[1].c_str(), files.size() == 3 ? files[2].c_str() : nullptr, nullptr);
+   analyzeMapsFile(files[0].c_str(), [&](auto& maps)
+      {
+      JavacoreInput& javacore = inputs.getJavacore(); // owned by the pipeline, which outlives the maps
+      annotateMapWithSegments(maps, javacore._segments);
+      annotateMapWithThreadStacks(maps, javacore._threadStacks);
+      if (inputs.hasCallSites())
+         annotateMapWithSegments(maps, inputs.getCallSites()._callSites);
+      inputs.waitForRss();
+      collectAttributionRecords(maps, false, records);
+      });
+   }
 
-   TopTen<MAPENTRY, MemoryEntryRssLessThan> topTenNotCovered;
+void printUsage(const char *progName)
+   {
+   cerr << "Usage: " << progName << " -s smapsFile -j javacoreFile [-c callsitesFile] [-g verboseGCFile] [-l jitVerboseLog] [-m perfMapFile] [-p PID [-e] [-y maxSkewPercent]] [-o text|json|csv|pprof|folded|folded-virtual|openmetrics [-f outputFile] [-k topK]] [-t rulesFile] [-v] [-w mapListingFile] [-z chunkKB] [-x]\n";
+   cerr << "       " << progName << " -b before [-r after.csv | -s smapsFile -j javacoreFile [-c callsitesFile] [-p PID]] [-n noiseKB] [-k topK]\n";
+   cerr << "       " << progName << " -d snapshotDirectory|sampleStore [-T fromSeconds,toSeconds] [-D seconds] [-L limitKB] [-g verboseGCFile] [-l jitVerboseLog]\n";
+   cerr << "       " << progName << " -i intervalSeconds -p PID -j javacoreFileOrDirectory [-c callsitesFile] [-u smaps|maps] [-A category:limitKB]... [-q maxCpuPercent] [-Q maxReadKBPerSecond] [-N numSamples] [-S sampleStore] [-L limitKB]\n";
+   cerr << "       " << progName << " -H all|PID,PID... [-j javacoreDirectory] [-e] [-k topK]\n";
+   cerr << "   -s accepts smaps, maps or vmmap (csv or text) output; the format is detected from the content\n";
+   cerr << "   -b compares with a previous analysis: a file written with -o csv or raw inputs given as smapsFile,javacoreFile[,callsitesFile]\n";
+   cerr << "   -r uses a file written with -o csv as the current analysis of -b\n";
+   cerr << "      -b and -r also accept sampleStore@first, sampleStore@last or sampleStore@secondsSinceEpoch\n";
+   cerr << "   -n RSS changes smaller than this many KB are reported as noise by -b (default 1024)\n";
+   cerr << "   -i samples the JVM with the given PID every intervalSeconds and prints its RSS per category; the segments come\n";
+   cerr << "      from the newest javacore (-j file or directory), which is read again when it changes\n";
+   cerr << "   -u smaps reads /proc/PID/smaps every sample (default); maps reads /proc/PID/maps and counts the RSS from the pagemap\n";
+   cerr << "   -A reports when the RSS of a category (or Total) goes above limitKB and when it goes back under it\n";
+   cerr << "   -q, -Q delay the next sample when a sample uses more CPU (percent of one CPU, default 1) or reads more than allowed\n";
+   cerr << "   -N stops after numSamples samples (default: when the process exits)\n";
+   cerr << "   -S appends the attribution records of every sample to a sample store (a directory, created if needed)\n";
+   cerr << "   -H analyzes every JVM of the host (all) or the listed PIDs in parallel and reports the memory they share;\n";
+   cerr << "      the segments come from the newest javacore of each PID in -j, and -e adds the .text size of shared libraries\n";
+   cerr << "   -d analyzes all javacore.<key>.txt/smaps.<key> pairs in a directory and prints per-category time series;\n";
+   cerr << "      given a sample store, it prints the samples between the -T times, with the peaks of each -D seconds\n";
+   cerr << "   -L forecasts when the RSS reaches a container memory limit of limitKB from the current trend of -d or -i\n";
+   cerr << "   -g compares the Java heap RSS with the heap occupancy after the last GC in a -Xverbosegclog file\n";
+   cerr << "   -l attributes JIT scratch memory to the compilations in a -Xjit:verbose={compilePerformance} log\n";
+   cerr << "   -m attributes code cache memory to the JIT compiled methods in a /tmp/perf-PID.map file (-Xjit:perfTool)\n";
+   cerr << "   -o writes the footprint results as JSON or CSV (with -v every map and its annotations are included)\n";
+   cerr << "   -o pprof writes a profile with the virtual and RSS bytes of each category, segment type, DLL, call-site and thread pool\n";
+   cerr << "   -o folded writes one 'category;subcategory;site bytes' line per attribution stack (RSS; folded-virtual: virtual size)\n";
+   cerr << "   -o openmetrics writes gauges per category, for the largest DLLs and for thread pools, labeled with the PID and JVM version\n";
+   cerr << "   -k is the length of the top lists and the number of DLLs and thread pools reported individually by -o openmetrics (default 10)\n";
+   cerr << "   -f writes the -o results to a file instead of stdout; the file is replaced atomically\n";
+   cerr << "   -t reads 'pattern classification' rules that put maps in a purpose (DLL, STACK, SCC) or a custom category by path;\n";
+   cerr << "      '^' and '$' anchor a pattern to the start and end of the path, and the first matching rule wins\n";
+   cerr << "   -w writes the list of maps and their annotations printed by -v to a file instead of stdout\n";
+   cerr << "   -z prints per-category histograms of the size of the maps and of the resident fraction of their chunks of this many KB\n";
+   cerr << "      (exact with -p, otherwise estimated from the RSS of each map)\n";
+   cerr << "   -x prints a strip per map that shows which of its chunks are resident (requires -p; chunks of -z KB, default 2048)\n";
+   cerr << "   -p also cross-checks the RSS of every smaps map with the pagemap and flags a skew score above 5%\n";
+   cerr << "   -y refuses to report when the smaps/pagemap skew score is above this percentage\n";
+   cerr << "   -e reports resident bytes per section and symbol of each shared library (requires -p)\n" << endl;
+   }
 
-   unordered_map<string, unsigned long long> dllCollection; // maps dll name to size (RSS)
+// Annotate the maps read from options._smapsFilename and report the results.
+// Instantiated once per map entry type; the input format is decided by the caller.
+// Returns false if the report is refused because the inputs are inconsistent
+template <typename MAPENTRY>
+bool analyzeFootprint(vector<MAPENTRY>& sMaps, const AnalysisOptions& options, const vector<AttributionRecord>& baselineRecords,
+                      ostream& resultStream, PageMapReader *pageMapReader, InputPipeline& inputs)
+   {
+   size_t topK = options.topK;
 
-   unsigned long long totalVirtSize = 0;
-   unsigned long long totalRssSize = 0;
+   // The RSS of segments, call-sites and stacks is counted from the presence bits of the VMAs
+   // that contain them, so that each VMA is read from the pagemap only once
+   if (pageMapReader)
+      {
+      vector<pair<unsigned long long, unsigned long long>> vmas;
+      vmas.reserve(sMaps.size());
+      for (const auto& crtMap : sMaps)
+         vmas.emplace_back(crtMap.getStart(), crtMap.getEnd());
+      pageMapReader->setVmas(vmas);
+      }
+   inputs.vmasSet();
 
-   // Iterate through all smaps/vmmaps
-   for (auto crtMap = smaps.cbegin(); crtMap != smaps.cend(); ++crtMap)
+   //===================== Javacore processing ============================
+   // Parsed by the pipeline while the maps were read; the RSS of the segments may still be counted
+   JavacoreInput& javacore = inputs.getJavacore(); // owned by the pipeline, which outlives the maps
+   vector<J9Segment>& segments = javacore._segments;
+   vector<ThreadStack>& threadStacks = javacore._threadStacks;
+   const JavacoreInfo& javacoreInfo = javacore._javacoreInfo;
+#ifdef DEBUG
+   // let's print all segments
+   cout << "Print segments:\n";
+   for (vector<J9Segment>::iterator it = segments.begin(); it != segments.end(); ++it)
+      cout << *it << endl;
+#endif
+   // Annotate maps with j9segments
+   annotateMapWithSegments(sMaps, segments);
+   annotateMapWithThreadStacks(sMaps, threadStacks);
+
+   //======================== Callsites processing =============================
+   if (options.callsitesFilename)
+      {
+      // Parsed by the pipeline; annotate the smaps file with callsites
+      annotateMapWithSegments(sMaps, inputs.getCallSites()._callSites);
+      }
+   // From here on the RSS of the ranges is used
+   inputs.waitForRss();
+
+   bool usePageMap = pageMapReader != nullptr;
+   if constexpr (is_same_v<MAPENTRY, SmapEntry>)
       {
-      totalVirtSize += crtMap->size();
-      totalRssSize += crtMap->getResidentSizeKB() << 10; // convert to bytes
+      // maps files have no RSS to compare with
+      if (usePageMap && detectInputFormat(options.smapsFilename) == SMAPS_INPUT)
+         {
+         RssReconciliation reconciliation(topK);
+         reconcileRssWithPageMap(sMaps, pageMapReader, reconciliation);
+         reconciliation.print(cout, options.maxSkewPercent);
+         if (options.refuseSkewedReport && reconciliation.skewPercent() > options.maxSkewPercent)
+            {
+            cerr << "Refusing to report: the skew between smaps and the pagemap is above " << options.maxSkewPercent << "%\n";
+            return false;
+            }
+         }
+      }
 
-      // Check if shared library; these require some extra processing
-      if (crtMap->getPurpose() == SmapEntry::DLL)
+   if (options.baselineSpec)
+      {
+      vector<AttributionRecord> records;
+      collectAttributionRecords(sMaps, usePageMap, records);
+      printFootprintDiff(baselineRecords, records, options.baselineSpec, options.smapsFilename, options.noiseKB << 10, topK);
+      }
+   else if (options.outputFormat == TEXT_OUTPUT)
+      {
+      if (options.verbose)
          {
-         topTenDlls.processElement(*crtMap);
-
-         // Note that in Linux a DLL may have 3 or even 4 smaps. e.g.
-         // Size = 11968 rss = 11136 Prot = r-xp / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
-         // Size = 960   rss = 256   Prot = r--p / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
-         // Size = 448   rss = 448   Prot = rw-p / home / jbench / mpirvu / JITDll_gcc / libj9jit28.so
-         // We want to sum-up all contributions for the same DLL. Thus let's create a hashtable
-         // that accumulates the sums (key is the name of the DLL, value is the total RSS)
-         // Then we need to sort by the total RSS
-         //
-         auto& dllTotalRSSSize = dllCollection[crtMap->getDetailsString()]; // If key does not exist, it will be inserted
-         dllTotalRSSSize += crtMap->getResidentSizeKB() << 10;
+         // print results one by one; there is a line for every map and annotation,
+         // so they are formatted into a large buffer that bypasses cout
+         int fd = STDOUT_FILENO;
+         if (options.mapListingFilename)
+            {
+            fd = open(options.mapListingFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+               {
+               cerr << "Cannot open " << options.mapListingFilename << endl;
+               exit(-1);
+               }
+            }
+         cout.flush();
+         BufferedWriter out(fd);
+         for (auto map = sMaps.cbegin(); map != sMaps.cend(); ++map)
+            map->printEntryWithAnnotations(out);
+         if (!out.flush())
+            cerr << "Cannot write the list of maps" << endl;
+         if (fd != STDOUT_FILENO)
+            close(fd);
          }
-      // The following types of smaps have a sole purpose
-      // and we can read the RSS summary directly from the smap
-      AddrRange::RangeCategories addrRangeCategory = AddrRange::UNKNOWN;
-      switch (crtMap->getPurpose())
+      printSpaceKBTakenByVmComponents(sMaps, usePageMap, topK);
+      printLargestRangesByCategory(sMaps, usePageMap, topK);
+      printResidentSharingByCategory(sMaps, usePageMap);
+      printReservedCommittedResidentByCategory(sMaps, usePageMap);
+      printCustomCategories(sMaps, usePageMap);
+      if constexpr (is_same_v<MAPENTRY, VmmapEntry>)
+         printVmmapWorkingSetBreakdown(sMaps, usePageMap);
+      if (options.residencyChunkKB)
+         printResidencyHistograms(sMaps, pageMapReader, options.residencyChunkKB << 10);
+      if (options.residencyStrips)
          {
-         case SmapEntry::DLL:
-            addrRangeCategory = AddrRange::DLL;
-            break;
-         case SmapEntry::SCC:
-            addrRangeCategory = AddrRange::SCC;
+         if (usePageMap)
+            printResidencyStrips(sMaps, pageMapReader, (options.residencyChunkKB ? options.residencyChunkKB : 2048) << 10);
+         else
+            cerr << "Residency strips (-x) require the PID of the JVM (-p)\n";
+         }
+      }
+   else
+      {
+      FootprintSummary<MAPENTRY> summary(topK);
+      switch (options.outputFormat)
+         {
+         case PPROF_OUTPUT:
+            writePprofResults(resultStream, sMaps, usePageMap);
             break;
-         case SmapEntry::STACK:
-            addrRangeCategory = AddrRange::STACK;
+         case FOLDED_OUTPUT:
+         case FOLDED_VIRTUAL_OUTPUT:
+            writeFoldedResults(resultStream, sMaps, usePageMap, options.outputFormat == FOLDED_OUTPUT);
             break;
-         case SmapEntry::JAVAHEAP:
-            addrRangeCategory = AddrRange::JAVAHEAP;
+         case OPENMETRICS_OUTPUT:
+            computeFootprintSummary(sMaps, usePageMap, summary);
+            writeOpenMetricsResults(resultStream, summary, sMaps, usePageMap, options.pid ? options.pid : javacoreInfo._processId, javacoreInfo, topK);
             break;
-         case SmapEntry::CODECACHE:
-            addrRangeCategory = AddrRange::CODECACHE;
+         case JSON_OUTPUT:
+            computeFootprintSummary(sMaps, usePageMap, summary);
+            writeJsonResults(resultStream, summary, sMaps, options.verbose);
             break;
          default:
-            addrRangeCategory = AddrRange::UNKNOWN;
+            computeFootprintSummary(sMaps, usePageMap, summary);
+            writeCsvResults(resultStream, summary, sMaps, usePageMap, options.verbose);
          }
-       if (addrRangeCategory != AddrRange::UNKNOWN)
-          {
-          virtualSize[addrRangeCategory] += crtMap->size();
-          rssSize[addrRangeCategory] += crtMap->getResidentSizeKB() << 10;
-          continue; // These smaps are not shared with other categories
-          }
-
-      // Determine whether a map is covered by ranges of different types and assign RSS in proportional values
-      // We can do a better job is we know for each page of the smap whether it is in RSS or not
-      computeProportionalRssContribution(*crtMap, usePageMap, virtualSize, rssSize);
-
-      if (crtMap->getCoveringRanges().size() == 0 &&
-          crtMap->getOverlappingRanges().size() == 0 &&
-          crtMap->getResidentSizeKB() != 0)
-         topTenNotCovered.processElement(*crtMap);
-      } // end for (iterate through smaps)
-   cout << dec << endl;
-   cout << "Totals:       Virtual= " << setw(8) << (totalVirtSize >> 10) << " KB; RSS= " << setw(8) << (totalRssSize >> 10) << " KB\n";
-   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
-      {
-      cout << setw(11) << AddrRange::RangeCategoryNames[i] << ":  Virtual= " << setw(8) << (virtualSize[i] >> 10) << " KB; RSS= " << setw(8) << (rssSize[i] >> 10) << " KB\n";
+      resultStream.flush();
       }
 
-   // Print explanation
-   cout << endl;
-   cout << "Unknown portion comes from maps that are partially covered by segments and callsites" << endl;
-   cout << "'Not covered' are maps that are really not covered by any segment or callsite" << endl;
-
-   // Process the hashtable with DLLs
-   //
-   using PairStringULL = pair < string, unsigned long long >;
-   // Ideally, above I would use something like  decltype(dllCollection)::value_type
-   // which is of type <const string, unsigned long long>
-   // However, the sort algorithm used below uses operator = and the const in front of the
-   // string creates problems when moving elements
-
-   // Take all elements from the hashtable and put them into a vector
-   vector<PairStringULL> vectorWithDlls(dllCollection.cbegin(), dllCollection.cend());
-
-
-   // Sort the vector using a custom comparator (lambda) that knows how to
-   // compare pairs (want to sort based on value of the map entry)
-   //
-   sort(vectorWithDlls.begin(), vectorWithDlls.end(),
-        [](decltype(vectorWithDlls)::const_reference p1, decltype(vectorWithDlls)::const_reference p2)
-           { return p1.second > p2.second; } // compare using the second element of the pair
-       );
-
-   // print the most expensive entries
-   cout << "\n RSS of dlls\n";
-   for_each(vectorWithDlls.cbegin(), vectorWithDlls.cend(),
-            [](decltype(vectorWithDlls)::const_reference element)
-                {cout << dec << setw(8) << (element.second >> 10) << " KB   " << element.first << endl; }
-           );
+   if (options.perfMapFilename)
+      {
+      PerfMapIndex perfMap;
+      perfMap.readPerfMapFile(options.perfMapFilename);
+      if (usePageMap)
+         perfMap.computeResidentMethodBytes(segments, pageMapReader);
+      printCodeCacheByMethod(perfMap, segments, usePageMap, topK);
+      }
 
-   cout << "\nTop 10 DDLs based on RSS:\n";
-   topTenDlls.print();
+   if (options.analyzeElf)
+      {
+      if constexpr (is_same_v<MAPENTRY, SmapEntry>)
+         {
+         if (usePageMap)
+            printDllSymbolResidency(sMaps, pageMapReader, options.verbose);
+         else
+            cerr << "Symbol residency analysis (-e) requires the PID of the JVM (-p)\n";
+         }
+      else
+         {
+         cerr << "Symbol residency analysis (-e) requires an smaps or maps file\n";
+         }
+      }
 
-   cout << "\nTop 10 maps not covered by anything\n";
-   topTenNotCovered.print();
+   if (options.verboseGCFilename || options.jitLogFilename)
+      {
+      vector<FootprintSnapshot> snapshots(1);
+      snapshots[0]._key = options.javacoreFilename;
+      snapshots[0]._timestampMs = javacoreInfo._dumpTimeMs;
+      snapshots[0]._jvmStartTimeMs = javacoreInfo._jvmStartTimeMs;
+      summarizeSnapshot(sMaps, segments, usePageMap, snapshots[0]);
+      printSnapshotCorrelations(snapshots, options.verboseGCFilename, options.jitLogFilename, topK);
+      }
+   return true;
    }
 
-
-
-#ifdef WINDOWS_FOOTPRINT
-typedef VmmapEntry MapEntry; // For Windows
-#else
-typedef SmapEntry MapEntry;  // For Linux
-#endif
-
-void printUsage(const char *progName)
+// Unlinks the temporary output file unless it was renamed, also when a reader throws
+struct TemporaryOutputFile
    {
-   cerr << "Usage: " << progName << " -s smapsFile -j javacoreFile [-c callsitesFile] [-i PID] [-v]\n" << endl;
-   }
+   string _name;
+   ~TemporaryOutputFile() { if (!_name.empty()) unlink(_name.c_str()); }
+   };
 
-int main(int argc, char* argv[])
+static int runFootprintAnalysis(int argc, char* argv[])
    {
    int opt;
-   const char *javacoreFilename = nullptr;
-   const char *callsitesFilename = nullptr;
-   const char *smapsFilename = nullptr;
-   int pid = 0;
-   bool verbose = false;
-   while ((opt = getopt(argc, argv, "c:j:ps:v")) != -1)
+   AnalysisOptions options;
+   while ((opt = getopt(argc, argv, "A:b:c:d:D:ef:g:H:i:j:k:l:L:m:n:N:o:p:q:Q:r:s:S:t:T:u:vw:xy:z:")) != -1)
       {
       switch (opt)
          {
+         case 'A':
+            {
+            RssAlert alert;
+            if (!parseRssAlert(optarg, alert))
+               {
+               cerr << "Expected category:limitKB instead of " << optarg << endl;
+               exit(EXIT_FAILURE);
+               }
+            options.sampler._alerts.push_back(alert);
+            break;
+            }
+         case 'b':
+            options.baselineSpec = optarg;
+            break;
+         case 'H':
+            options.hostPidSpec = optarg;
+            break;
          case 's':
-            smapsFilename = optarg;
+            options.smapsFilename = optarg;
+            break;
+         case 'd':
+            options.snapshotDirname = optarg;
+            break;
+         case 'D':
+            options.downsampleMs = strtoull(optarg, nullptr, 10) * 1000;
+            break;
+         case 'e':
+            options.analyzeElf = true;
+            break;
+         case 'f':
+            options.outputFilename = optarg;
+            break;
+         case 'g':
+            options.verboseGCFilename = optarg;
+            break;
+         case 'i':
+            options.sample = true;
+            options.sampler._intervalMs = (unsigned long long)(strtod(optarg, nullptr) * 1000);
             break;
          case 'j':
-            javacoreFilename = optarg;
+            options.javacoreFilename = optarg;
             break;
          case 'c':
-            callsitesFilename = optarg;
+            options.callsitesFilename = optarg;
+            break;
+         case 'k':
+            options.topK = strtoul(optarg, nullptr, 10);
+            break;
+         case 'l':
+            options.jitLogFilename = optarg;
+            break;
+         case 'L':
+            options.limitKB = strtoull(optarg, nullptr, 10);
+            break;
+         case 'm':
+            options.perfMapFilename = optarg;
+            break;
+         case 'n':
+            options.noiseKB = strtoull(optarg, nullptr, 10);
+            break;
+         case 'N':
+            options.sampler._numSamples = strtoull(optarg, nullptr, 10);
+            break;
+         case 'o':
+            options.outputFormat = parseOutputFormat(optarg);
             break;
          case 'p':
-            pid = atoi(optarg);
+            options.pid = atoi(optarg);
+            break;
+         case 'q':
+            options.sampler._maxCpuPercent = strtod(optarg, nullptr);
+            break;
+         case 'Q':
+            options.sampler._maxReadKBPerSec = strtoull(optarg, nullptr, 10);
+            break;
+         case 'r':
+            options.resultsCsvFilename = optarg;
+            break;
+         case 'S':
+            options.sampler._storeDirname = optarg;
+            break;
+         case 't':
+            options.rulesFilename = optarg;
+            break;
+         case 'T':
+            {
+            // from,to in seconds since the epoch; either can be empty
+            const char *comma = strchr(optarg, ',');
+            if (!comma)
+               {
+               cerr << "Expected fromSeconds,toSeconds instead of " << optarg << endl;
+               exit(EXIT_FAILURE);
+               }
+            if (comma != optarg)
+               options.fromMs = strtoull(optarg, nullptr, 10) * 1000;
+            if (comma[1])
+               options.toMs = strtoull(comma + 1, nullptr, 10) * 1000 + 999;
+            break;
+            }
+         case 'u':
+            if (strcmp(optarg, "maps") != 0 && strcmp(optarg, "smaps") != 0)
+               {
+               cerr << "The sampling tier (-u) must be smaps or maps\n";
+               exit(EXIT_FAILURE);
+               }
+            options.sampler._useMapsTier = strcmp(optarg, "maps") == 0;
             break;
          case 'v':
-            verbose = true;
+            options.verbose = true;
+            break;
+         case 'w':
+            options.mapListingFilename = optarg;
+            options.verbose = true;
+            break;
+         case 'x':
+            options.residencyStrips = true;
+            break;
+         case 'y':
+            options.maxSkewPercent = strtod(optarg, nullptr);
+            options.refuseSkewedReport = true;
+            break;
+         case 'z':
+            options.residencyChunkKB = strtoull(optarg, nullptr, 10);
+            if (options.residencyChunkKB == 0)
+               {
+               cerr << "The granularity of the residency histograms (-z) must be a positive number of KB\n";
+               exit(EXIT_FAILURE);
+               }
             break;
          default: /* '?' */
             printUsage(argv[0]);
@@ -432,60 +732,135 @@ int main(int argc, char* argv[])
          } // end switch
       } // end while
 
-   if (smapsFilename == nullptr || javacoreFilename == nullptr)
+   // The rules classify the maps as they are read
+   if (options.rulesFilename)
+      getMapClassifier().readRulesFile(options.rulesFilename);
+
+   // Sampling mode: follow a live JVM until it exits or enough samples are taken
+   if (options.sample)
       {
-      printUsage(argv[0]);
-      exit(EXIT_FAILURE);
+      if (!options.pid || !options.javacoreFilename || options.sampler._intervalMs == 0)
+         {
+         printUsage(argv[0]);
+         exit(EXIT_FAILURE);
+         }
+      options.sampler._pid = options.pid;
+      options.sampler._javacorePath = options.javacoreFilename;
+      options.sampler._callsitesFilename = options.callsitesFilename;
+      options.sampler._limitKB = options.limitKB;
+      runSampler(options.sampler, cout);
+      return 0;
       }
 
-   // If PID is given, open the page map file
-   PageMapReader *pageMapReader = pid ? new PageMapReader(pid) : nullptr;
-
-   // Read the smaps file
-   vector<MapEntry> sMaps;
-#ifdef WINDOWS_FOOTPRINT
-   readVmmapFile(smapsFilename, sMaps);
-#else
-   readSmapsFile(smapsFilename, sMaps);
-#endif
-
-
+   // Host mode: analyze the JVMs of the host together
+   if (options.hostPidSpec)
+      {
+      runHostAnalysis(options.hostPidSpec, options.javacoreFilename, options.analyzeElf, options.topK, cout);
+      return 0;
+      }
 
-   //===================== Javacore processing ============================
-   vector<J9Segment> segments; // must not become out-of-scope until I am done with the maps
-   vector<ThreadStack> threadStacks;
+   // Time series mode: analyze a directory of javacore/smaps pairs
+   if (options.snapshotDirname)
+      {
+      vector<FootprintSnapshot> snapshots;
+      if (isSampleStore(options.snapshotDirname))
+         {
+         readSampleStoreSnapshots(options.snapshotDirname, options.fromMs, options.toMs, options.downsampleMs, snapshots);
+         }
+      else
+         {
+         vector<SnapshotFiles> snapshotFiles;
+         findSnapshotFiles(options.snapshotDirname, snapshotFiles);
+         readSnapshots(snapshotFiles, snapshots);
+         }
+      printTimeSeries(snapshots);
+      if (options.limitKB)
+         printHeadroomForecast(snapshots, options.limitKB);
+      printSnapshotCorrelations(snapshots, options.verboseGCFilename, options.jitLogFilename, options.topK);
+      return 0;
+      }
 
-   readJavacore(javacoreFilename, segments, threadStacks, pageMapReader);
-#ifdef DEBUG
-   // let's print all segments
-   cout << "Print segments:\n";
-   for (vector<J9Segment>::iterator it = segments.begin(); it != segments.end(); ++it)
-      cout << *it << endl;
-#endif
-   // Annotate maps with j9segments
-   annotateMapWithSegments(sMaps, segments);
-   annotateMapWithThreadStacks(sMaps, threadStacks);
+   // Diff mode: both sides come from saved results or from "smaps,javacore" specs
+   vector<AttributionRecord> baselineRecords;
+   if (options.baselineSpec)
+      {
+      readAnalysisForDiff(options.baselineSpec, baselineRecords);
+      if (options.resultsCsvFilename)
+         {
+         vector<AttributionRecord> records;
+         readAnalysisForDiff(options.resultsCsvFilename, records);
+         printFootprintDiff(baselineRecords, records, options.baselineSpec, options.resultsCsvFilename, options.noiseKB << 10, options.topK);
+         return 0;
+         }
+      }
 
-   //======================== Callsites processing =============================
-   vector<CallSite> callSites; // must not become out-of-scope until I am done with the maps
-   if (callsitesFilename)
+   if (options.smapsFilename == nullptr || options.javacoreFilename == nullptr)
       {
-      // Read the callsites file
-      readCallSitesFile(callsitesFilename, callSites, pageMapReader);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+      }
 
-      // Annotate the smaps file with callsites
-      annotateMapWithSegments(sMaps, callSites);
+   // Structured results go to outputFilename or to stdout. In the latter case
+   // the progress messages printed on cout are diverted to stderr.
+   // The file is written under a temporary name and renamed when complete
+   ofstream outputFile;
+   TemporaryOutputFile tempOutputFile;
+   ostream resultStream(cout.rdbuf());
+   bool writeResultsToFile = options.outputFormat != TEXT_OUTPUT && options.outputFilename && !options.baselineSpec;
+   if (options.outputFormat != TEXT_OUTPUT)
+      {
+      if (writeResultsToFile)
+         {
+         tempOutputFile._name = string(options.outputFilename) + ".tmp" + to_string(getpid());
+         outputFile.open(tempOutputFile._name, ios::binary);
+         if (!outputFile.is_open())
+            {
+            cerr << "Cannot open " << tempOutputFile._name << endl;
+            tempOutputFile._name.clear();
+            exit(-1);
+            }
+         resultStream.rdbuf(outputFile.rdbuf());
+         }
+      else
+         {
+         cout.rdbuf(cerr.rdbuf());
+         }
       }
 
-   if (verbose)
+   // If PID is given, open the page map file
+   PageMapReader *pageMapReader = options.pid ? new PageMapReader(options.pid) : nullptr;
+
+   // The format of the maps file is detected once; the analysis is specialized for it
+   // The javacore and call-sites are parsed concurrently with the maps file
+   bool reported = true;
+   InputPipeline inputs(options.javacoreFilename, options.callsitesFilename, pageMapReader);
+   analyzeMapsFile(options.smapsFilename, [&](auto& maps)
+      {
+      reported = analyzeFootprint(maps, options, baselineRecords, resultStream, pageMapReader, inputs);
+      });
+   if (!reported)
       {
-      // print results one by one
-      for (vector<MapEntry>::const_iterator map = sMaps.begin(); map != sMaps.end(); ++map)
-         map->printEntryWithAnnotations();
+      if (writeResultsToFile)
+         {
+         outputFile.close();
+         unlink(tempOutputFile._name.c_str());
+         }
+      delete(pageMapReader);
+      exit(-1);
       }
 
-   bool usePageMap = pageMapReader != nullptr;
-   printSpaceKBTakenByVmComponents(sMaps, usePageMap);
+   if (writeResultsToFile)
+      {
+      // Readers of outputFilename never see a partially written file
+      outputFile.close();
+      if (outputFile.fail() || rename(tempOutputFile._name.c_str(), options.outputFilename) != 0)
+         {
+         cerr << "Cannot write " << options.outputFilename << endl;
+         unlink(tempOutputFile._name.c_str());
+         exit(-1);
+         }
+      tempOutputFile._name.clear();
+      }
 
    // pageMapReader is not needed anymore
    if (pageMapReader)
@@ -494,4 +869,17 @@ int main(int argc, char* argv[])
    return 0;
    }
 
-
+// The readers throw std::runtime_error when an input cannot be read or parsed, also from
+// the threads that read the inputs concurrently. They all end up here
+int main(int argc, char* argv[])
+   {
+   try
+      {
+      return runFootprintAnalysis(argc, argv);
+      }
+   catch (const exception& e)
+      {
+      cerr << e.what() << endl;
+      exit(-1);
+      }
+   }
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdlib>
+#include "FootprintDiff.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+// Split one CSV line into fields; quoted fields may contain ',' and doubled quotes
+static void splitCsvLine(const string& line, vector<string>& fields)
+   {
+   fields.clear();
+   string field;
+   bool inQuotes = false;
+   for (size_t i = 0; i < line.size(); i++)
+      {
+      char c = line[i];
+      if (inQuotes)
+         {
+         if (c == '"')
+            {
+            if (i + 1 < line.size() && line[i + 1] == '"')
+               field.push_back(line[++i]);
+            else
+               inQuotes = false;
+            }
+         else
+            {
+            field.push_back(c);
+            }
+         }
+      else if (c == '"')
+         {
+         inQuotes = true;
+         }
+      else if (c == ',')
+         {
+         fields.push_back(field);
+         field.clear();
+         }
+      else if (c != '\r')
+         {
+         field.push_back(c);
+         }
+      }
+   fields.push_back(field);
+   }
+
+/*
+ * Read the 'attribution' records of a file written with -o csv
+ * record,kind,category,name,start,end,virtual_bytes,rss_bytes,protection,map_start
+ * attribution,,CallSites,CallSites;segment.c;segment.c:99,,,4096,2400,,
+ */
+void readAttributionRecordsCsv(const char *csvFilename, vector<AttributionRecord>& records)
+   {
+   cout << "Reading results file: " << csvFilename << endl;
+   ifstream myfile(csvFilename);
+   if (!myfile.is_open())
+      {
+      cerr << "Cannot open " << csvFilename << endl;
+      exit(-1);
+      }
+   string line;
+   vector<string> fields;
+   // Find the columns by name, so that columns added later do not break old readers
+   getline(myfile, line);
+   splitCsvLine(line, fields);
+   size_t recordCol = find(fields.begin(), fields.end(), "record") - fields.begin();
+   size_t nameCol = find(fields.begin(), fields.end(), "name") - fields.begin();
+   size_t virtualCol = find(fields.begin(), fields.end(), "virtual_bytes") - fields.begin();
+   size_t rssCol = find(fields.begin(), fields.end(), "rss_bytes") - fields.begin();
+   size_t numCols = fields.size();
+   if (recordCol == numCols || nameCol == numCols || virtualCol == numCols || rssCol == numCols)
+      {
+      cerr << csvFilename << " was not written with -o csv\n";
+      exit(-1);
+      }
+   records.clear();
+   while (getline(myfile, line))
+      {
+      if (line.compare(0, 12, "attribution,") != 0)
+         continue;
+      splitCsvLine(line, fields);
+      if (fields.size() < numCols)
+         continue;
+      AttributionRecord record;
+      record._stack = fields[nameCol];
+      record._virtualBytes = strtoull(fields[virtualCol].c_str(), nullptr, 10);
+      record._rssBytes = strtoull(fields[rssCol].c_str(), nullptr, 10);
+      records.push_back(record);
+      }
+   if (records.empty())
+      {
+      cerr << "No attribution records found in " << csvFilename << endl;
+      exit(-1);
+      }
+   // Files written by this tool are already sorted, but the merge below relies on it
+   if (!is_sorted(records.begin(), records.end()))
+      sort(records.begin(), records.end());
+   }
+
+namespace
+   {
+   struct AttributionDelta
+      {
+      string _stack;
+      unsigned long long _virtualBefore = 0, _virtualAfter = 0;
+      unsigned long long _rssBefore = 0, _rssAfter = 0;
+      bool _inBefore = false, _inAfter = false;
+      long long rssDelta() const { return (long long)_rssAfter - (long long)_rssBefore; }
+      long long virtualDelta() const { return (long long)_virtualAfter - (long long)_virtualBefore; }
+      void add(const AttributionDelta& other)
+         {
+         _virtualBefore += other._virtualBefore; _virtualAfter += other._virtualAfter;
+         _rssBefore += other._rssBefore; _rssAfter += other._rssAfter;
+         _inBefore |= other._inBefore; _inAfter |= other._inAfter;
+         }
+      };
+
+   // Sum up the deltas of all stacks that share the first numFrames frames; result is sorted by stack
+   void aggregateDeltas(const vector<AttributionDelta>& deltas, int numFrames, vector<AttributionDelta>& aggregated)
+      {
+      unordered_map<string, size_t> index;
+      for (const auto& delta : deltas)
+         {
+         size_t end = delta._stack.find(';');
+         for (int i = 1; i < numFrames && end != string::npos; i++)
+            end = delta._stack.find(';', end + 1);
+         string prefix = delta._stack.substr(0, end);
+         auto inserted = index.emplace(prefix, aggregated.size());
+         if (inserted.second)
+            {
+            aggregated.emplace_back();
+            aggregated.back()._stack = prefix;
+            }
+         aggregated[inserted.first->second].add(delta);
+         }
+      sort(aggregated.begin(), aggregated.end(), [](const AttributionDelta& d1, const AttributionDelta& d2) { return d1._stack < d2._stack; });
+      }
+
+   void printSignedKB(long long bytes, int width)
+      {
+      // Round towards zero so that tiny changes print as 0 rather than -1
+      long long kb = bytes / 1024;
+      string text = (kb > 0 ? "+" : "") + to_string(kb);
+      cout << setw(width) << text;
+      }
+
+   void printPercent(unsigned long long before, long long delta)
+      {
+      if (before == 0)
+         cout << setw(9) << (delta == 0 ? "" : "new");
+      else
+         cout << setw(8) << fixed << setprecision(1) << (100.0 * delta / before) << "%";
+      }
+
+   // List the entries whose RSS changed by at least noiseBytes, largest change first
+   void printRankedChanges(const char *title, vector<AttributionDelta>& deltas, unsigned long long noiseBytes, size_t topK)
+      {
+      long long noiseSum = 0;
+      size_t numNoise = 0;
+      vector<const AttributionDelta*> changes;
+      for (const auto& delta : deltas)
+         {
+         if ((unsigned long long)llabs(delta.rssDelta()) < noiseBytes)
+            {
+            if (delta.rssDelta() != 0)
+               numNoise++;
+            noiseSum += delta.rssDelta();
+            }
+         else
+            {
+            changes.push_back(&delta);
+            }
+         }
+      sort(changes.begin(), changes.end(), [](const AttributionDelta *d1, const AttributionDelta *d2)
+         { return llabs(d1->rssDelta()) > llabs(d2->rssDelta()); });
+
+      cout << "\n" << title << " (" << changes.size() << " above the noise threshold)\n";
+      cout << setw(12) << "RSSdelta(KB)" << setw(9) << "RSS%" << setw(15) << "VirtDelta(KB)" << "  Entry\n";
+      for (size_t i = 0; i < changes.size() && i < topK; i++)
+         {
+         const AttributionDelta *delta = changes[i];
+         printSignedKB(delta->rssDelta(), 12);
+         printPercent(delta->_rssBefore, delta->rssDelta());
+         printSignedKB(delta->virtualDelta(), 15);
+         cout << "  " << delta->_stack;
+         if (!delta->_inBefore)
+            cout << " (new)";
+         else if (!delta->_inAfter)
+            cout << " (gone)";
+         cout << endl;
+         }
+      if (changes.size() > topK)
+         cout << "   ... " << changes.size() - topK << " more\n";
+      cout << "Noise: " << numNoise << " entries changed by less than " << (noiseBytes >> 10) << " KB; net ";
+      printSignedKB(noiseSum, 0);
+      cout << " KB\n";
+      }
+   } // anonymous namespace
+
+void printFootprintDiff(const vector<AttributionRecord>& before, const vector<AttributionRecord>& after,
+                        const string& beforeName, const string& afterName,
+                        unsigned long long noiseBytes, size_t topK)
+   {
+   // Align the two sets of stacks with a merge of the sorted inputs
+   vector<AttributionDelta> deltas;
+   deltas.reserve(max(before.size(), after.size()));
+   auto b = before.cbegin(), a = after.cbegin();
+   while (b != before.cend() || a != after.cend())
+      {
+      AttributionDelta delta;
+      bool takeBefore = a == after.cend() || (b != before.cend() && b->_stack <= a->_stack);
+      bool takeAfter = b == before.cend() || (a != after.cend() && a->_stack <= b->_stack);
+      if (takeBefore)
+         {
+         delta._stack = b->_stack;
+         delta._virtualBefore = b->_virtualBytes;
+         delta._rssBefore = b->_rssBytes;
+         delta._inBefore = true;
+         ++b;
+         }
+      if (takeAfter)
+         {
+         delta._stack = a->_stack;
+         delta._virtualAfter = a->_virtualBytes;
+         delta._rssAfter = a->_rssBytes;
+         delta._inAfter = true;
+         ++a;
+         }
+      deltas.push_back(delta);
+      }
+
+   cout << "\nFootprint difference: " << beforeName << " -> " << afterName << endl;
+   vector<AttributionDelta> categories;
+   aggregateDeltas(deltas, 1, categories);
+   AttributionDelta total;
+   cout << setw(12) << "Category" << setw(16) << "RSSbefore(KB)" << setw(15) << "RSSafter(KB)" << setw(12) << "Delta(KB)" << setw(9) << "Delta%" << setw(15) << "VirtDelta(KB)" << endl;
+   // Categories are printed in the usual order; names unknown to this version of the tool come last
+   vector<const AttributionDelta*> orderedCategories;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      for (const auto& category : categories)
+         if (category._stack == AddrRange::RangeCategoryNames[i])
+            orderedCategories.push_back(&category);
+   for (const auto& category : categories)
+      if (find(orderedCategories.begin(), orderedCategories.end(), &category) == orderedCategories.end())
+         orderedCategories.push_back(&category);
+   for (const AttributionDelta *category : orderedCategories)
+      {
+      cout << setw(12) << category->_stack << setw(16) << (category->_rssBefore >> 10) << setw(15) << (category->_rssAfter >> 10);
+      printSignedKB(category->rssDelta(), 12);
+      printPercent(category->_rssBefore, category->rssDelta());
+      printSignedKB(category->virtualDelta(), 15);
+      cout << endl;
+      total.add(*category);
+      }
+   cout << setw(12) << "Total" << setw(16) << (total._rssBefore >> 10) << setw(15) << (total._rssAfter >> 10);
+   printSignedKB(total.rssDelta(), 12);
+   printPercent(total._rssBefore, total.rssDelta());
+   printSignedKB(total.virtualDelta(), 15);
+   cout << endl;
+
+   vector<AttributionDelta> components;
+   aggregateDeltas(deltas, 2, components);
+   printRankedChanges("Largest RSS changes by DLL, segment type, call-site file and thread pool", components, noiseBytes, topK);
+
+   // Call-sites are the stacks under the CallSites root frame; other stacks can be as deep
+   // (e.g. "Unknown;<custom category>;<path>")
+   const string callSitePrefix = string(AddrRange::RangeCategoryNames[AddrRange::CALLSITE]) + ';';
+   vector<AttributionDelta> callSites;
+   for (const auto& delta : deltas)
+      if (delta._stack.compare(0, callSitePrefix.size(), callSitePrefix) == 0)
+         callSites.push_back(delta);
+   if (!callSites.empty())
+      printRankedChanges("Largest RSS changes by call-site", callSites, noiseBytes, topK);
+   }
@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <cmath>     // for sqrt, isinf
+#include <limits>
+#include <algorithm> // for max
+#include "HeadroomForecast.hpp"
+#include "TimeSeries.hpp"
+
+using namespace std;
+
+static const double INFINITE_SECONDS = numeric_limits<double>::infinity();
+
+void LinearFit::add(double t, double y)
+   {
+   if (_n == 0)
+      _firstT = t;
+   _n += 1;
+   double dt = t - _meanT, dy = y - _meanY;
+   _meanT += dt / _n;
+   _meanY += dy / _n;
+   _stt += dt * (t - _meanT);
+   _sty += dt * (y - _meanY);
+   _syy += dy * (y - _meanY);
+   }
+
+double LinearFit::residualStdDev() const
+   {
+   if (_n <= 2)
+      return 0;
+   double sse = _stt > 0 ? _syy - _sty * _sty / _stt : _syy;
+   return sqrt(max(0.0, sse) / (_n - 2));
+   }
+
+double LinearFit::slopeStdErr() const
+   {
+   if (_n <= 2 || _stt <= 0)
+      return INFINITE_SECONDS;
+   return residualStdDev() / sqrt(_stt);
+   }
+
+void PiecewiseTrend::add(double t, double y, double pairedY)
+   {
+   if (_segment.count() >= MIN_SEGMENT_SAMPLES)
+      {
+      // Residuals within the noise floor (0.5% of the value, at least 256 KB) are not drift
+      double predicted = _segment.valueAt(t);
+      double sigma = max(_segment.residualStdDev(), max(fabs(predicted) * 0.005, 256.0));
+      double z = (y - predicted) / sigma;
+      _cusumUp = max(0.0, _cusumUp + z - 0.5);
+      _cusumDown = max(0.0, _cusumDown - z - 0.5);
+      if (_cusumUp > 5 || _cusumDown > 5)
+         {
+         // The samples since the drift began start the new segment; this one is added below
+         _segment = _sinceDrift;
+         _pairedSegment = _pairedSinceDrift;
+         _sinceDrift = LinearFit();
+         _pairedSinceDrift = LinearFit();
+         _cusumUp = _cusumDown = 0;
+         _numSegments++;
+         }
+      else if (_cusumUp == 0 && _cusumDown == 0)
+         {
+         _sinceDrift = LinearFit();
+         _pairedSinceDrift = LinearFit();
+         }
+      else
+         {
+         _sinceDrift.add(t, y);
+         _pairedSinceDrift.add(t, pairedY);
+         }
+      }
+   _segment.add(t, y);
+   _pairedSegment.add(t, pairedY);
+   }
+
+void HeadroomForecast::add(double elapsedSec, const FootprintSnapshot& snapshot)
+   {
+   _lastTime = elapsedSec;
+   _lastTotalKB = snapshot._totalRssSize / 1024.0;
+   double attributedKB = 0;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      _categories[i].add(elapsedSec, snapshot._rssSize[i] / 1024.0);
+      attributedKB += snapshot._rssSize[i] / 1024.0;
+      }
+   _total.add(elapsedSec, _lastTotalKB, _lastTotalKB - attributedKB);
+   }
+
+// Growth of the total RSS that is not in the categories (with -p the RSS of the maps that are
+// not covered by any range is only in the total). The categories have trends of their own
+// that may start at other times, so the unattributed RSS is fitted over the samples of the
+// trend of the total rather than taken as a difference of slopes
+double HeadroomForecast::unattributedSlope() const
+   {
+   return _total.pairedSegment().slope();
+   }
+
+static const char *culpritName(int culprit)
+   {
+   return culprit == AddrRange::NUM_CATEGORIES ? "Unattributed" : AddrRange::RangeCategoryNames[culprit];
+   }
+
+// Two-sided 95% quantile of Student's t distribution
+static double t95(size_t degreesOfFreedom)
+   {
+   static const double quantiles[] = {12.71, 4.30, 3.18, 2.78, 2.57, 2.45, 2.36, 2.31, 2.26, 2.23,
+                                      2.20, 2.18, 2.16, 2.14, 2.13, 2.12, 2.11, 2.10, 2.09, 2.09};
+   if (degreesOfFreedom == 0)
+      return INFINITE_SECONDS;
+   if (degreesOfFreedom <= sizeof(quantiles) / sizeof(quantiles[0]))
+      return quantiles[degreesOfFreedom - 1];
+   return degreesOfFreedom <= 60 ? 2.02 : 1.96;
+   }
+
+HeadroomForecast::Estimate HeadroomForecast::estimate() const
+   {
+   Estimate estimate;
+   double maxSlope = 0;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      if (_categories[i].segment().slope() > maxSlope)
+         {
+         maxSlope = _categories[i].segment().slope();
+         estimate._culprit = i;
+         }
+      }
+   if (unattributedSlope() > maxSlope)
+      estimate._culprit = AddrRange::NUM_CATEGORIES;
+   if (_lastTotalKB >= _limitKB)
+      {
+      estimate._reached = true;
+      return estimate;
+      }
+   const LinearFit& fit = _total.segment();
+   double slope = fit.slope();
+   if (fit.count() < 3 || slope <= 0)
+      return estimate;
+   estimate._growing = true;
+   double headroomKB = _limitKB - _lastTotalKB;
+   double margin = t95(fit.count() - 2) * fit.slopeStdErr();
+   estimate._seconds = headroomKB / slope;
+   estimate._lowerSeconds = headroomKB / (slope + margin);
+   estimate._upperSeconds = slope > margin ? headroomKB / (slope - margin) : INFINITE_SECONDS;
+   return estimate;
+   }
+
+static string formatDuration(double seconds)
+   {
+   if (isinf(seconds))
+      return "never";
+   char buffer[32];
+   if (seconds < 120)
+      snprintf(buffer, sizeof(buffer), "%.0fs", seconds);
+   else if (seconds < 7200)
+      snprintf(buffer, sizeof(buffer), "%.0fm", seconds / 60);
+   else if (seconds < 172800)
+      snprintf(buffer, sizeof(buffer), "%.1fh", seconds / 3600);
+   else
+      snprintf(buffer, sizeof(buffer), "%.1fd", seconds / 86400);
+   return buffer;
+   }
+
+string HeadroomForecast::summary() const
+   {
+   Estimate estimate = this->estimate();
+   if (estimate._reached)
+      return "above limit";
+   if (!estimate._growing)
+      return "not growing";
+   string text = formatDuration(estimate._seconds) + " [" + formatDuration(estimate._lowerSeconds) + "," + formatDuration(estimate._upperSeconds) + "]";
+   if (estimate._culprit >= 0)
+      text += string(" ") + culpritName(estimate._culprit);
+   return text;
+   }
+
+void HeadroomForecast::print(ostream& os) const
+   {
+   Estimate estimate = this->estimate();
+   const LinearFit& fit = _total.segment();
+   os << "\nHeadroom to the memory limit of " << (unsigned long long)_limitKB << " KB:\n";
+   os << "RSS now " << (unsigned long long)_lastTotalKB << " KB; trend fitted over the last " << fit.count() << " samples (since "
+      << (unsigned long long)fit.firstTime() << "s)";
+   if (_total.numSegments() > 1)
+      os << "; the " << _total.numSegments() - 1 << " earlier phase(s), e.g. the warm-up, are not used";
+   os << endl;
+   if (estimate._reached)
+      os << "The RSS is already above the limit\n";
+   else if (!estimate._growing)
+      os << "The RSS does not grow; the limit is not reached at the current trend\n";
+   else
+      {
+      os << "Total RSS grows " << fixed << setprecision(0) << fit.slope() * 3600 << " KB/hour; the limit is reached in "
+         << formatDuration(estimate._seconds) << " (95% bounds " << formatDuration(estimate._lowerSeconds) << " to "
+         << formatDuration(estimate._upperSeconds) << ")\n";
+      os.unsetf(ios::floatfield);
+      os << setprecision(6);
+      }
+
+   double growthKBPerSec = max(0.0, unattributedSlope());
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      growthKBPerSec += max(0.0, _categories[i].segment().slope());
+   os << setw(12) << "Category" << setw(12) << "KB/hour" << setw(8) << "Share" << setw(10) << "Since(s)" << endl;
+   for (int i = 0; i <= AddrRange::NUM_CATEGORIES; i++)
+      {
+      const LinearFit& category = i < AddrRange::NUM_CATEGORIES ? _categories[i].segment() : _total.segment();
+      double slope = i < AddrRange::NUM_CATEGORIES ? category.slope() : unattributedSlope();
+      if (category.count() == 0 || llround(slope * 3600) == 0)
+         continue;
+      double share = slope > 0 && growthKBPerSec > 0 ? slope * 100 / growthKBPerSec : 0;
+      os << setw(12) << culpritName(i) << setw(12) << llround(slope * 3600)
+         << setw(7) << lround(share) << "%" << setw(10) << (unsigned long long)category.firstTime()
+         << (i == estimate._culprit ? "  <- grows fastest" : "") << endl;
+      }
+   }
+
+void printHeadroomForecast(const vector<FootprintSnapshot>& snapshots, unsigned long long limitKB)
+   {
+   if (snapshots.empty())
+      return;
+   HeadroomForecast forecast(limitKB);
+   unsigned long long startMs = snapshots.front()._timestampMs;
+   for (const auto& snapshot : snapshots)
+      forecast.add(snapshot._timestampMs >= startMs ? (snapshot._timestampMs - startMs) / 1000.0 : 0, snapshot);
+   forecast.print(cout);
+   }
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _HEADROOMFORECAST_HPP__
+#define _HEADROOMFORECAST_HPP__
+#include <vector>
+#include <string>
+#include <iostream>
+#include "AddrRange.hpp"
+
+struct FootprintSnapshot;
+
+// Least-squares line through the samples added so far. The sums are updated in O(1)
+// per sample (Welford style, so that large values do not cancel out)
+class LinearFit
+   {
+   double _n = 0;
+   double _meanT = 0, _meanY = 0;
+   double _stt = 0, _sty = 0, _syy = 0; // centered sums of squares and products
+   double _firstT = 0;
+
+   public:
+      void add(double t, double y);
+      size_t count() const { return (size_t)_n; }
+      double firstTime() const { return _firstT; }
+      double slope() const { return _stt > 0 ? _sty / _stt : 0; }
+      double valueAt(double t) const { return _meanY + slope() * (t - _meanT); }
+      double residualStdDev() const;
+      double slopeStdErr() const; // infinite with fewer than 3 samples
+   }; // LinearFit
+
+// Piecewise linear trend of one series. The samples are compared with the line of the
+// current segment; a two-sided CUSUM of the standardized residuals detects when they drift
+// away from it (the end of the warm-up, a new load level, a leak that starts) and the
+// samples taken since the drift began become the new segment. Only the current segment is
+// used for forecasting, so the steep growth of the warm-up does not inflate the trend.
+// A paired series (pairedY) is fitted over exactly the samples of the segment, so that its
+// slope can be compared with the slope of the segment
+class PiecewiseTrend
+   {
+   static const size_t MIN_SEGMENT_SAMPLES = 5; // before the segment is tested for drift
+   LinearFit _segment;
+   LinearFit _sinceDrift;   // samples since the CUSUM left zero
+   LinearFit _pairedSegment, _pairedSinceDrift;
+   double _cusumUp = 0, _cusumDown = 0;
+   size_t _numSegments = 1;
+
+   public:
+      void add(double t, double y, double pairedY = 0);
+      const LinearFit& segment() const { return _segment; }
+      const LinearFit& pairedSegment() const { return _pairedSegment; }
+      size_t numSegments() const { return _numSegments; }
+   }; // PiecewiseTrend
+
+// Time until the RSS reaches a container memory limit, from the trends of the total RSS and
+// of every category. Each sample updates the trends in O(1); nothing is refitted
+class HeadroomForecast
+   {
+   double _limitKB;
+   double _lastTime = 0;
+   double _lastTotalKB = 0;
+   PiecewiseTrend _total;
+   PiecewiseTrend _categories[AddrRange::NUM_CATEGORIES];
+   double unattributedSlope() const;
+
+   public:
+      struct Estimate
+         {
+         bool _reached = false;     // the RSS is already above the limit
+         bool _growing = false;     // false if the limit is never reached at the current trend
+         double _seconds = 0;       // expected time to the limit
+         double _lowerSeconds = 0;  // 95% bounds from the uncertainty of the slope
+         double _upperSeconds = 0;  // infinite if a flat trend cannot be excluded
+         int _culprit = -1;         // category that grows fastest; -1 if none grows and NUM_CATEGORIES
+                                    // for the growth of the total that no category accounts for
+         };
+
+      explicit HeadroomForecast(unsigned long long limitKB) : _limitKB(limitKB) {}
+      void add(double elapsedSec, const FootprintSnapshot& snapshot);
+      Estimate estimate() const;
+      // One-line summary for the rows of the sampler, e.g. "3.2h [2.5h,4.4h] DLL"
+      std::string summary() const;
+      void print(std::ostream& os) const;
+   }; // HeadroomForecast
+
+// Feed the snapshots of a time series to a forecast and print it
+void printHeadroomForecast(const std::vector<FootprintSnapshot>& snapshots, unsigned long long limitKB);
+
+#endif // _HEADROOMFORECAST_HPP__
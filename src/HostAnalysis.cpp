@@ -0,0 +1,422 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <list>
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm> // for sort, min, max
+#include <thread>
+#include <atomic>
+#include <cstring>   // for strtok_r
+#include <cstdlib>   // for strtol, strtoull
+#include <exception>
+#include <dirent.h>  // for opendir/readdir
+#include <unistd.h>  // for getpid, sysconf
+#include <sys/stat.h>
+#include "HostAnalysis.hpp"
+#include "smap.hpp"
+#include "Javacore.hpp"
+#include "Attribution.hpp"
+#include "TimeSeries.hpp"
+#include "ElfAnalysis.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+// File-backed memory of one JVM, per file
+struct FileUse
+   {
+   string _path;
+   unsigned long long _inode = 0;
+   MemoryEntry::SmapPurpose _purpose = MemoryEntry::UNKNOWN;
+   unsigned long long _rssKB = 0;
+   unsigned long long _pssKB = 0;
+   };
+
+// A JVM of the host and the result of its analysis
+struct HostJvm
+   {
+   int _pid = 0;
+   string _javacoreFilename; // empty if there is no javacore for this PID
+   bool _staleJavacore = false; // the newest javacore for this PID is older than the process
+   bool _analyzed = false;   // false if the process went away or its inputs cannot be read
+   string _error;            // why the JVM was not analyzed
+   unsigned long long _pssKB = 0;
+   FootprintSnapshot _snapshot;
+   vector<FileUse> _files;
+   };
+
+// The processes that have the JVM library mapped
+static void discoverJvms(vector<int>& pids)
+   {
+   DIR *dir = opendir("/proc");
+   if (!dir)
+      {
+      cerr << "Cannot list /proc\n";
+      exit(-1);
+      }
+   int self = getpid();
+   while (struct dirent *dirEntry = readdir(dir))
+      {
+      char *end;
+      long pid = strtol(dirEntry->d_name, &end, 10);
+      if (*end != '\0' || pid <= 0 || pid == self)
+         continue;
+      ifstream mapsFile("/proc/" + to_string(pid) + "/maps");
+      string line;
+      while (getline(mapsFile, line))
+         {
+         if (line.find("/libjvm.so") != string::npos || line.find("/libj9vm") != string::npos)
+            {
+            pids.push_back(pid);
+            break;
+            }
+         }
+      }
+   closedir(dir);
+   sort(pids.begin(), pids.end());
+   }
+
+struct JavacoreFile
+   {
+   string _path;
+   time_t _mtime = 0;
+   };
+
+// Newest javacore of every PID in a directory, by the PID in the name of the file
+static void indexJavacores(const char *javacoreDir, map<int, JavacoreFile>& javacores)
+   {
+   DIR *dir = opendir(javacoreDir);
+   if (!dir)
+      {
+      cerr << "Cannot open javacore directory " << javacoreDir << endl;
+      exit(-1);
+      }
+   while (struct dirent *dirEntry = readdir(dir))
+      {
+      // javacore.<date>.<time>.<PID>.<seq>.txt
+      vector<string> fields;
+      tokenize(dirEntry->d_name, fields, ".");
+      if (fields.size() != 6 || fields[0] != "javacore" || fields[5] != "txt")
+         continue;
+      int pid = atoi(fields[3].c_str());
+      string path = string(javacoreDir) + "/" + dirEntry->d_name;
+      struct stat st;
+      if (pid <= 0 || stat(path.c_str(), &st) != 0)
+         continue;
+      auto javacore = javacores.find(pid);
+      if (javacore == javacores.end() || st.st_mtime > javacore->second._mtime ||
+          (st.st_mtime == javacore->second._mtime && path > javacore->second._path))
+         javacores[pid] = JavacoreFile{path, st.st_mtime};
+      }
+   closedir(dir);
+   }
+
+// Start of a process in seconds since the epoch: field 22 of /proc/PID/stat is the start in
+// clock ticks since boot, and btime in /proc/stat is the boot time. Returns false if unknown
+static bool getProcessStartTime(int pid, time_t& startTime)
+   {
+   ifstream statFile("/proc/" + to_string(pid) + "/stat");
+   string stat;
+   if (!getline(statFile, stat))
+      return false;
+   // The command name (field 2) is in parentheses and may contain spaces
+   size_t commandEnd = stat.rfind(')');
+   if (commandEnd == string::npos)
+      return false;
+   istringstream fields(stat.substr(commandEnd + 1));
+   string field;
+   for (int fieldNo = 3; fieldNo <= 22; fieldNo++)
+      if (!(fields >> field))
+         return false;
+   unsigned long long startTicks = strtoull(field.c_str(), nullptr, 10);
+
+   ifstream procStat("/proc/stat");
+   string line;
+   while (getline(procStat, line))
+      {
+      if (line.compare(0, 6, "btime ") == 0)
+         {
+         startTime = strtoull(line.c_str() + 6, nullptr, 10) + startTicks / sysconf(_SC_CLK_TCK);
+         return true;
+         }
+      }
+   return false;
+   }
+
+// Analyze one JVM. An input that cannot be read (the process exited, its javacore is truncated)
+// is reported in jvm._error and leaves jvm._analyzed false; the other JVMs are not affected
+static void analyzeJvm(HostJvm& jvm)
+   {
+   string smapsFilename = "/proc/" + to_string(jvm._pid) + "/smaps";
+   if (!ifstream(smapsFilename).is_open())
+      {
+      jvm._error = "cannot read the smaps of this process"; // gone, or owned by another user
+      return;
+      }
+   // The messages of the readers and of the annotation would be interleaved with those of
+   // the other JVMs, so they are dropped
+   ostream progress(nullptr);
+   vector<J9Segment> segments;
+   vector<ThreadStack> threadStacks;
+   vector<SmapEntry> maps;
+   list<ThreadStack> stackGuards;
+   try
+      {
+      if (!jvm._javacoreFilename.empty())
+         readJavacore(jvm._javacoreFilename.c_str(), segments, threadStacks, nullptr, nullptr, progress);
+      readSmapsFile(smapsFilename.c_str(), maps, progress);
+      if (maps.empty())
+         {
+         jvm._error = "the process has no maps";
+         return;
+         }
+      // A javacore that does not match the maps (e.g. taken before the heap moved) can give a map two purposes
+      annotateMapWithSegments(maps, segments, progress);
+      annotateMapWithThreadStacks(maps, threadStacks, &stackGuards, progress);
+      }
+   catch (const exception& e)
+      {
+      jvm._error = e.what();
+      return;
+      }
+   summarizeSnapshot(maps, segments, false /*usePageMap*/, jvm._snapshot, progress);
+
+   map<pair<unsigned long long, string>, FileUse> files;
+   for (const auto& crtMap : maps)
+      {
+      jvm._pssKB += crtMap._pss;
+      if (crtMap._inode == 0)
+         continue;
+      FileUse& use = files[make_pair(crtMap._inode, crtMap.getDetailsString())];
+      use._path = crtMap.getDetailsString();
+      use._inode = crtMap._inode;
+      if (crtMap.getPurpose() == MemoryEntry::DLL || crtMap.getPurpose() == MemoryEntry::SCC)
+         use._purpose = crtMap.getPurpose();
+      use._rssKB += crtMap.getResidentSizeKB();
+      use._pssKB += crtMap._pss;
+      }
+   for (auto& file : files)
+      jvm._files.push_back(file.second);
+   jvm._analyzed = true;
+   }
+
+// Files of the host, merged from the JVMs that map them. A file is described (and, for
+// shared libraries, its ELF image parsed) once, however many JVMs map it
+class SharedFileTable
+   {
+   public:
+   struct SharedFile
+      {
+      string _path;
+      MemoryEntry::SmapPurpose _purpose = MemoryEntry::UNKNOWN;
+      unsigned _numJvms = 0;
+      unsigned long long _rssKB = 0; // sum over the JVMs
+      unsigned long long _pssKB = 0;
+      long long _textKB = -1;        // size of .text; -1 if the ELF image was not parsed
+      unsigned long long savedKB() const { return _rssKB - min(_rssKB, _pssKB); }
+      };
+
+   private:
+   map<pair<unsigned long long, string>, SharedFile> _files;
+
+   public:
+      void add(const FileUse& use)
+         {
+         SharedFile& file = _files[make_pair(use._inode, use._path)];
+         file._path = use._path;
+         if (use._purpose != MemoryEntry::UNKNOWN)
+            file._purpose = use._purpose;
+         file._numJvms++;
+         file._rssKB += use._rssKB;
+         file._pssKB += use._pssKB;
+         }
+      void parseSharedLibraries()
+         {
+         string cacheDir = getElfCacheDir();
+         for (auto& entry : _files)
+            {
+            SharedFile& file = entry.second;
+            if (file._purpose != MemoryEntry::DLL || file._numJvms < 2)
+               continue;
+            ElfImage image;
+            if (!image.load(file._path, cacheDir))
+               continue;
+            file._textKB = 0;
+            for (const auto& section : image.getSections())
+               if (section._name == ".text")
+                  file._textKB = section._size >> 10;
+            }
+         }
+      // Files mapped by at least two JVMs, by decreasing memory saved by sharing
+      void getSharedFiles(vector<const SharedFile*>& shared) const
+         {
+         for (const auto& entry : _files)
+            if (entry.second._numJvms >= 2)
+               shared.push_back(&entry.second);
+         sort(shared.begin(), shared.end(), [](const SharedFile* f1, const SharedFile* f2) { return f1->savedKB() > f2->savedKB(); });
+         }
+   }; // SharedFileTable
+
+static void printJvmTable(const vector<HostJvm>& jvms, ostream& out)
+   {
+   bool usedCategory[AddrRange::NUM_CATEGORIES] = {false};
+   for (const auto& jvm : jvms)
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         if (jvm._snapshot._rssSize[i] != 0)
+            usedCategory[i] = true;
+
+   out << "\nRSS (KB) by JVM:\n";
+   out << setw(10) << "PID" << setw(12) << "RSS" << setw(12) << "PSS";
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      if (usedCategory[i])
+         out << setw(12) << AddrRange::RangeCategoryNames[i];
+   out << "  Javacore\n";
+   FootprintSnapshot host;
+   unsigned long long hostPssKB = 0;
+   for (const auto& jvm : jvms)
+      {
+      if (!jvm._analyzed)
+         {
+         out << setw(10) << jvm._pid << "  not analyzed: " << jvm._error << "\n";
+         continue;
+         }
+      out << setw(10) << jvm._pid << setw(12) << (jvm._snapshot._totalRssSize >> 10) << setw(12) << jvm._pssKB;
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         {
+         host._rssSize[i] += jvm._snapshot._rssSize[i];
+         if (usedCategory[i])
+            out << setw(12) << (jvm._snapshot._rssSize[i] >> 10);
+         }
+      out << "  " << (!jvm._javacoreFilename.empty() ? jvm._javacoreFilename : jvm._staleJavacore ? "none (the newest is older than the process)" : "none") << "\n";
+      host._totalRssSize += jvm._snapshot._totalRssSize;
+      hostPssKB += jvm._pssKB;
+      }
+   out << setw(10) << "Host" << setw(12) << (host._totalRssSize >> 10) << setw(12) << hostPssKB;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      if (usedCategory[i])
+         out << setw(12) << (host._rssSize[i] >> 10);
+   out << "\nThe sum of the RSS of the JVMs is " << (host._totalRssSize >> 10) << " KB; the host pays the sum of their PSS, "
+       << hostPssKB << " KB (" << ((host._totalRssSize >> 10) - min(host._totalRssSize >> 10, hostPssKB)) << " KB saved by sharing)\n";
+   }
+
+static void printSharedFiles(const SharedFileTable& table, bool analyzeElf, size_t topK, ostream& out)
+   {
+   vector<const SharedFileTable::SharedFile*> shared;
+   table.getSharedFiles(shared);
+   out << "\nFiles mapped by more than one JVM (" << shared.size() << "; top " << min(topK, shared.size()) << " by KB saved):\n";
+   out << setw(6) << "JVMs" << setw(14) << "RSSsum(KB)" << setw(14) << "PSSsum(KB)" << setw(12) << "Saved(KB)";
+   if (analyzeElf)
+      out << setw(10) << "Text(KB)";
+   out << setw(6) << "Kind" << "  File\n";
+   for (size_t i = 0; i < shared.size() && i < topK; i++)
+      {
+      const SharedFileTable::SharedFile& file = *shared[i];
+      out << setw(6) << file._numJvms << setw(14) << file._rssKB << setw(14) << file._pssKB << setw(12) << file.savedKB();
+      if (analyzeElf)
+         {
+         if (file._textKB >= 0)
+            out << setw(10) << file._textKB;
+         else
+            out << setw(10) << "-";
+         }
+      const char *kind = file._purpose == MemoryEntry::DLL ? "DLL" : file._purpose == MemoryEntry::SCC ? "SCC" : "file";
+      out << setw(6) << kind << "  " << file._path << "\n";
+      }
+   }
+
+void runHostAnalysis(const char *pidSpec, const char *javacoreDir, bool analyzeElf, size_t topK, ostream& out)
+   {
+   vector<int> pids;
+   if (strcmp(pidSpec, "all") == 0)
+      discoverJvms(pids);
+   else
+      {
+      vector<string> tokens;
+      tokenize(pidSpec, tokens, ",");
+      for (const auto& token : tokens)
+         {
+         char *end;
+         long pid = strtol(token.c_str(), &end, 10);
+         if (*end != '\0' || pid <= 0)
+            {
+            cerr << "Expected 'all' or a comma separated list of PIDs instead of " << pidSpec << endl;
+            exit(-1);
+            }
+         pids.push_back(pid);
+         }
+      }
+   if (pids.empty())
+      {
+      out << "No JVM found\n";
+      return;
+      }
+
+   // The javacore directory is listed once for all the JVMs. A javacore older than the
+   // process was written by an earlier process with the same PID
+   map<int, JavacoreFile> javacores;
+   if (javacoreDir)
+      indexJavacores(javacoreDir, javacores);
+   vector<HostJvm> jvms(pids.size());
+   for (size_t i = 0; i < pids.size(); i++)
+      {
+      jvms[i]._pid = pids[i];
+      auto javacore = javacores.find(pids[i]);
+      if (javacore == javacores.end())
+         continue;
+      time_t startTime;
+      if (getProcessStartTime(pids[i], startTime) && javacore->second._mtime < startTime)
+         jvms[i]._staleJavacore = true;
+      else
+         jvms[i]._javacoreFilename = javacore->second._path;
+      }
+
+   // The JVMs are independent: worker threads pick the next JVM until none is left
+   unsigned numThreads = min<size_t>(max(1u, thread::hardware_concurrency()), jvms.size());
+   out << "Analyzing " << jvms.size() << " JVMs with " << numThreads << " threads\n";
+   atomic<size_t> nextJvm(0);
+   auto worker = [&]()
+      {
+      for (size_t i = nextJvm++; i < jvms.size(); i = nextJvm++)
+         analyzeJvm(jvms[i]);
+      };
+   vector<thread> threads;
+   for (unsigned t = 1; t < numThreads; t++)
+      threads.emplace_back(worker);
+   worker(); // the main thread works too
+   for (auto& t : threads)
+      t.join();
+
+   SharedFileTable table;
+   for (const auto& jvm : jvms)
+      for (const auto& file : jvm._files)
+         table.add(file);
+   if (analyzeElf)
+      table.parseSharedLibraries();
+
+   printJvmTable(jvms, out);
+   printSharedFiles(table, analyzeElf, topK, out);
+   }
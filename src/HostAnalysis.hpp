@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _HOSTANALYSIS_HPP__
+#define _HOSTANALYSIS_HPP__
+#include <iostream>
+
+// Host mode: analyze many JVMs of the same host at once.
+// The JVMs are the processes that map libjvm.so or libj9vm*.so, or the PIDs given in 'pidSpec'
+// ("all" or a comma separated list). Each JVM is annotated with its newest javacore in
+// 'javacoreDir' (javacore.<date>.<time>.<PID>.<seq>.txt) that is not older than the process,
+// if any, and reduced to per-category totals; the JVMs are analyzed in parallel, each reading
+// its own smaps, so the cost grows with the number of JVMs. A JVM whose inputs cannot be read
+// is reported and skipped. Afterwards the file-backed maps of all the JVMs are merged by file,
+// which gives the host-level cost of shared memory: the sum of PSS, rather than the sum of RSS
+// of every JVM. With analyzeElf, the ELF image of each shared library mapped by at least two
+// JVMs is parsed once, rather than once per JVM
+void runHostAnalysis(const char *pidSpec, const char *javacoreDir, bool analyzeElf, size_t topK, std::ostream& out);
+
+#endif // _HOSTANALYSIS_HPP__
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cctype> // for isxdigit
+#include <stdexcept> // runtime_error
+#include "InputFormat.hpp"
+
+using namespace std;
+
+// A maps line starts with an address range like "00400000-00404000 r-xp"
+static bool looksLikeMapsLine(const string& line)
+   {
+   size_t pos = 0;
+   while (pos < line.size() && isxdigit(line[pos]))
+      pos++;
+   if (pos == 0 || pos >= line.size() || line[pos] != '-')
+      return false;
+   size_t endStart = ++pos;
+   while (pos < line.size() && isxdigit(line[pos]))
+      pos++;
+   return pos > endStart && pos < line.size() && line[pos] == ' ';
+   }
+
+// An smaps entry continues with lines like "Size:                 16 kB"
+static bool looksLikeSmapsDetailLine(const string& line)
+   {
+   size_t colon = line.find(':');
+   if (colon == string::npos || colon == 0)
+      return false;
+   for (size_t i = 0; i < colon; i++)
+      if (!isalnum(line[i]) && line[i] != '_')
+         return false;
+   return true;
+   }
+
+//-------------------------------- detectInputFormat ----------------------------
+// Look at the first few lines of the file to decide which reader to use.
+// vmmap output may start with a few lines about the process before the header.
+//-------------------------------------------------------------------------------
+InputFormat detectInputFormat(const char *filename)
+   {
+   ifstream myfile(filename);
+   if (!myfile.is_open())
+      throw runtime_error("Cannot open " + string(filename));
+   const int maxLinesToInspect = 64;
+   string line;
+   for (int lineNo = 0; lineNo < maxLinesToInspect && getline(myfile, line); lineNo++)
+      {
+      if (line.find("\"Address\",\"Type\",\"Size\"") != string::npos)
+         return VMMAP_CSV_INPUT;
+      size_t addrPos = line.find("Address");
+      if (addrPos != string::npos && line.find("Type", addrPos) != string::npos && line.find("Committed", addrPos) != string::npos)
+         return VMMAP_TEXT_INPUT;
+      if (looksLikeMapsLine(line))
+         {
+         // smaps and maps share the main line; smaps has detail lines after it
+         string nextLine;
+         if (getline(myfile, nextLine) && looksLikeSmapsDetailLine(nextLine))
+            return SMAPS_INPUT;
+         return MAPS_INPUT;
+         }
+      }
+   return UNKNOWN_INPUT;
+   }
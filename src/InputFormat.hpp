@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _INPUTFORMAT_HPP__
+#define _INPUTFORMAT_HPP__
+#include <iostream>
+#include <vector>
+#include <stdexcept> // runtime_error
+#include <string>
+#include "smap.hpp"
+#include "vmmap.hpp"
+
+// The kinds of memory map dumps we know how to read.
+// The format is detected from the content of the file, not from its name,
+// so that a single binary can analyze dumps collected on Linux and on Windows
+enum InputFormat
+   {
+   SMAPS_INPUT = 0,  // /proc/<pid>/smaps
+   MAPS_INPUT,       // /proc/<pid>/maps; no RSS information unless the page map is used
+   VMMAP_CSV_INPUT,  // vmmap -csv output (Windows)
+   VMMAP_TEXT_INPUT, // vmmap text output (Windows)
+   UNKNOWN_INPUT
+   };
+
+// Throws std::runtime_error if the file cannot be opened
+InputFormat detectInputFormat(const char *filename);
+
+// Read the maps with the reader that matches the format of the file and hand them to 'analyze',
+// which is typically a generic lambda taking 'auto& maps'.
+// The format is decided once per file, so the analysis is instantiated for each
+// map entry type and there is no dispatch per map entry.
+// Throws std::runtime_error if the file cannot be read or its format is not recognized
+template <typename ANALYSIS>
+void analyzeMapsFile(const char *filename, ANALYSIS analyze, std::ostream& progress = std::cout)
+   {
+   InputFormat format = detectInputFormat(filename);
+   switch (format)
+      {
+      case SMAPS_INPUT:
+      case MAPS_INPUT:
+         {
+         std::vector<SmapEntry> maps;
+         if (format == SMAPS_INPUT)
+            readSmapsFile(filename, maps, progress);
+         else
+            readMapsFile(filename, maps, progress);
+         analyze(maps);
+         break;
+         }
+      case VMMAP_CSV_INPUT:
+      case VMMAP_TEXT_INPUT:
+         {
+         std::vector<VmmapEntry> maps;
+         readVmmapFile(filename, maps, progress);
+         analyze(maps);
+         break;
+         }
+      default:
+         throw std::runtime_error("Cannot recognize " + std::string(filename) + " as an smaps, maps or vmmap file");
+      }
+   }
+
+#endif // _INPUTFORMAT_HPP__
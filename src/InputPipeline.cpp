@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <iostream>
+#include "InputPipeline.hpp"
+#include "Attribution.hpp"
+#include "PageMapSupport.hpp"
+
+using namespace std;
+
+InputPipeline::InputPipeline(const char *javacoreFilename, const char *callsitesFilename, PageMapReader *pageMapReader) :
+   _vmasKnown(_vmasSet.get_future().share())
+   {
+   shared_future<void> vmasKnown = _vmasKnown;
+   _javacoreInput.reset(new JavacoreInput);
+   _javacoreParsedFuture = _javacoreParsed.get_future();
+   JavacoreInput *javacore = _javacoreInput.get();
+   promise<void> *javacoreParsed = &_javacoreParsed;
+   _javacoreDone = async(launch::async, [=]()
+      {
+      try
+         {
+         readJavacore(javacoreFilename, javacore->_segments, javacore->_threadStacks, nullptr, &javacore->_javacoreInfo, javacore->_progress);
+         if (pageMapReader)
+            {
+            vmasKnown.wait();
+            computeRangesRss(javacore->_threadStacks, *pageMapReader);
+            }
+         }
+      catch (...)
+         {
+         javacoreParsed->set_exception(current_exception());
+         throw;
+         }
+      javacoreParsed->set_value();
+      if (pageMapReader)
+         computeRangesRss(javacore->_segments, *pageMapReader);
+      });
+   if (callsitesFilename)
+      {
+      _callSitesInput.reset(new CallSitesInput);
+      _callSitesParsedFuture = _callSitesParsed.get_future();
+      CallSitesInput *callSites = _callSitesInput.get();
+      promise<void> *callSitesParsed = &_callSitesParsed;
+      _callSitesDone = async(launch::async, [=]()
+         {
+         try
+            {
+            readCallSitesFile(callsitesFilename, callSites->_callSites, nullptr, callSites->_progress);
+            }
+         catch (...)
+            {
+            callSitesParsed->set_exception(current_exception());
+            throw;
+            }
+         callSitesParsed->set_value();
+         if (pageMapReader)
+            {
+            vmasKnown.wait();
+            computeRangesRss(callSites->_callSites, *pageMapReader);
+            }
+         });
+      }
+   }
+
+// The readers must not wait forever for VMAs that will never come
+InputPipeline::~InputPipeline()
+   {
+   vmasSet();
+   }
+
+void InputPipeline::vmasSet()
+   {
+   if (!_vmasSetCalled)
+      {
+      _vmasSetCalled = true;
+      _vmasSet.set_value();
+      }
+   }
+
+JavacoreInput& InputPipeline::getJavacore()
+   {
+   if (_javacoreParsedFuture.valid())
+      {
+      _javacoreParsedFuture.get();
+      cout << _javacoreInput->_progress.str();
+      }
+   return *_javacoreInput;
+   }
+
+CallSitesInput& InputPipeline::getCallSites()
+   {
+   if (_callSitesParsedFuture.valid())
+      {
+      _callSitesParsedFuture.get();
+      cout << _callSitesInput->_progress.str();
+      }
+   return *_callSitesInput;
+   }
+
+void InputPipeline::waitForRss()
+   {
+   if (_javacoreDone.valid())
+      _javacoreDone.get();
+   if (_callSitesDone.valid())
+      _callSitesDone.get();
+   }
@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _INPUTPIPELINE_HPP__
+#define _INPUTPIPELINE_HPP__
+#include <vector>
+#include <string>
+#include <sstream>
+#include <future>
+#include <memory>
+#include "Javacore.hpp"
+#include "CallSites.hpp"
+class PageMapReader;
+
+// The ranges read from a javacore
+struct JavacoreInput
+   {
+   std::vector<J9Segment> _segments;
+   std::vector<ThreadStack> _threadStacks;
+   JavacoreInfo _javacoreInfo;
+   std::ostringstream _progress; // messages of the reader, printed when the input is used
+   };
+
+struct CallSitesInput
+   {
+   std::vector<CallSite> _callSites;
+   std::ostringstream _progress;
+   };
+
+// Concurrent ingestion of the inputs of an analysis. The javacore and the call-sites file
+// are parsed on threads of their own while the caller reads the maps file. When the maps
+// are known (vmasSet), each reader counts the RSS of its ranges from the pagemap. The caller
+// gets an input as soon as it is parsed and annotates the maps with it while the RSS of its
+// ranges is still being counted; waitForRss must return before the RSS of a range is used.
+// The RSS of thread stacks is counted before the javacore is handed over, because the
+// annotation moves the start of the stacks over their guard pages.
+// A reader that fails reports its exception to the caller, which gets it from getJavacore,
+// getCallSites or waitForRss. The inputs are taken in the usual order, so the output does not
+// depend on which reader finishes first
+class InputPipeline
+   {
+   std::promise<void> _vmasSet;
+   std::shared_future<void> _vmasKnown;
+   std::unique_ptr<JavacoreInput> _javacoreInput;
+   std::unique_ptr<CallSitesInput> _callSitesInput;
+   std::promise<void> _javacoreParsed, _callSitesParsed;
+   std::future<void> _javacoreParsedFuture, _callSitesParsedFuture;
+   std::future<void> _javacoreDone, _callSitesDone; // the readers; declared last so they are joined first
+   bool _vmasSetCalled = false;
+
+   public:
+      // pageMapReader may be null; callsitesFilename may be null
+      InputPipeline(const char *javacoreFilename, const char *callsitesFilename, PageMapReader *pageMapReader);
+      ~InputPipeline();
+      // The VMAs of the pageMapReader describe the maps: the readers may count the RSS now
+      void vmasSet();
+      // Wait until the input is parsed and print the progress messages of its reader.
+      // The input belongs to the pipeline
+      JavacoreInput& getJavacore();
+      bool hasCallSites() const { return _callSitesInput != nullptr; }
+      CallSitesInput& getCallSites();
+      // Wait until the readers have counted the RSS of their ranges
+      void waitForRss();
+   }; // InputPipeline
+
+#endif // _INPUTPIPELINE_HPP__
@@ -23,19 +23,21 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <cstring> // for strlen
+#include <cstdlib> // for strtoull
 #include <fstream>
 #include <regex>
+#include <stdexcept> // runtime_error
 #include "Util.hpp"
 #include "Javacore.hpp"
 #include "PageMapSupport.hpp"
 
 using namespace std;
 
-void J9Segment::print(std::ostream& os) const
+void J9Segment::format(BufferedWriter& out) const
    {
-   os << std::hex << getTypeName() << " ID=" << setfill('0') << setw(16) << _id <<
-      " Start=" << setfill('0') << setw(16) << getStart() << " End=" << setfill('0') << setw(16) << getEnd() <<
-      " size=" << setfill(' ') << std::dec << setw(5) << sizeKB() << " KB flags=" << std::hex << setfill('0') << setw(8) << getFlags();
+   out.write(getTypeName()).write(" ID=").hex(_id, 16).write(" Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16)
+      .write(" size=").dec(sizeKB(), 5).write(" KB flags=").hex(getFlags(), 8);
    }
 
 // Convert from a J9Segment::SegmentType to a RangeCategory
@@ -95,11 +97,10 @@ J9Segment::SegmentType determineSegmentType(const string& line)
    return J9Segment::UNKNOWN;
    }
 
-void ThreadStack::print(std::ostream& os) const
+void ThreadStack::format(BufferedWriter& out) const
    {
-   os << " ThreadName=" << setfill(' ') << setw(16) << _threadName << std::hex <<
-      " Start=" << setfill('0') << setw(16) << getStart() << " End=" << setfill('0') << setw(16) << getEnd() <<
-      " size=" << setfill(' ') << std::dec << setw(5) << sizeKB() << " KB";
+   out.write(" ThreadName=").padLeft(_threadName, 16).write(" Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16)
+      .write(" size=").dec(sizeKB(), 5).write(" KB");
    }
 
 void javacoreParseStack(ifstream& myfile, int& lineNo, vector<ThreadStack>& threadStacks, PageMapReader *pageMapReader)
@@ -158,7 +159,7 @@ void javacoreParseStack(ifstream& myfile, int& lineNo, vector<ThreadStack>& thre
          {
          // Search for "3XMTHREADINFO2            (native stack address range from:0x00007F17035D8000, to:0x00007F1703619000, size:0x41000)"
          std::cmatch result;
-         std::regex  pattern("3XMTHREADINFO2\\s+\\(native stack address range from:0x([0-9A-F]+), to:0x([0-9A-F]+), size:0x([0-9A-F]+)");
+         static const std::regex pattern("3XMTHREADINFO2\\s+\\(native stack address range from:0x([0-9A-F]+), to:0x([0-9A-F]+), size:0x([0-9A-F]+)");
          if (std::regex_search(line.c_str(), result, pattern))
             {
             unsigned long long startAddr = hex2ull(result[1]);
@@ -180,19 +181,18 @@ void javacoreParseStack(ifstream& myfile, int& lineNo, vector<ThreadStack>& thre
 /**
  * Read the javacore file and extract the memory segments and thread stacks
  * The output is stored in the segments and threadStacks vectors
+ * If javacoreInfo is not null, it is filled with information from the javacore header
 */
-void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, vector<ThreadStack>& threadStacks, PageMapReader *pageMapReader)
+void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, vector<ThreadStack>& threadStacks, PageMapReader *pageMapReader,
+                  JavacoreInfo *javacoreInfo, ostream& progress)
    {
-   cout << "Reading javacore file: " << string(javacoreFilename) << endl;
+   progress << "Reading javacore file: " << string(javacoreFilename) << endl;
    // Open the file
    ifstream myfile(javacoreFilename);
 
    // check if successfull
    if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << javacoreFilename << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot open " + string(javacoreFilename));
 
    // read each line from file
    string line;
@@ -206,6 +206,39 @@ void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, ve
 
       if (!memInfoFound)
          {
+         // 1TIDATETIME    Date: 2022/03/31 at 15:08:04:123
+         if (javacoreInfo && line.compare(0, 12, "1TIDATETIME ") == 0)
+            {
+            javacoreInfo->_dumpTimeMs = parseDateTimeMs(line);
+            continue;
+            }
+         // 1CISTARTTIME   JVM start time: 2022/03/31 at 15:08:03:456
+         if (javacoreInfo && line.compare(0, 13, "1CISTARTTIME ") == 0)
+            {
+            javacoreInfo->_jvmStartTimeMs = parseDateTimeMs(line);
+            continue;
+            }
+         // 1CIPROCESSID   Process ID: 1234 (0x4D2)
+         if (javacoreInfo && line.compare(0, 13, "1CIPROCESSID ") == 0)
+            {
+            size_t pos = line.find(':');
+            if (pos != string::npos)
+               javacoreInfo->_processId = strtoull(line.c_str() + pos + 1, nullptr, 10);
+            continue;
+            }
+         // 1CIJAVAVERSION JRE 17.0.9 Linux amd64-64 (build 17.0.9+9)
+         // 1CIVMVERSION   Eclipse OpenJ9 VM openj9-0.41.0
+         if (javacoreInfo && (line.compare(0, 15, "1CIJAVAVERSION ") == 0 || line.compare(0, 13, "1CIVMVERSION ") == 0))
+            {
+            size_t start = line.find_first_not_of(" \t", line.find(' '));
+            size_t end = line.find_last_not_of(" \t\r");
+            string version = start == string::npos ? string() : line.substr(start, end + 1 - start);
+            if (line[3] == 'J')
+               javacoreInfo->_javaVersion = version;
+            else
+               javacoreInfo->_vmVersion = version;
+            continue;
+            }
          // search for:0SECTION       MEMINFO subcomponent dump routine
          if (line.find("0SECTION       MEMINFO subcomponent dump routine") != std::string::npos)
             {
@@ -230,9 +263,7 @@ void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, ve
             vector<string> tokens;
             tokenize(line, tokens);
             if (tokens.size() < 6)
-               {
-               cerr << "Have found " << tokens.size() << " instead of 6-7 at line " << lineNo << endl; exit(-1);
-               }
+               throw runtime_error("Have found " + to_string(tokens.size()) + " instead of 6-7 at line " + to_string(lineNo));
             if (tokens[0] == "1STHEAPSPACE" && tokens[5] == "Generational")
                {
                // Skip this line because it has no address information
@@ -242,19 +273,14 @@ void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, ve
             unsigned long long startAddr = hex2ull(tokens[2]);
             unsigned long long endAddr = hex2ull(tokens[3]);
             if (id == HEX_CONVERT_ERROR || startAddr == HEX_CONVERT_ERROR || endAddr == HEX_CONVERT_ERROR)
-               {
-               cerr << "HEX_CONVERT_ERROR in javacore at line:" << lineNo << " : " << line << std::endl;
-               exit(-1);
-               }
+               throw runtime_error("HEX_CONVERT_ERROR in javacore at line:" + to_string(lineNo) + " : " + line);
             segments.push_back(J9Segment(id, startAddr, endAddr, segmentType, 0, 0/*rss*/));
             }
          else if (line.find("1STSEGTYPE", 0) != std::string::npos)
             {
             segmentType = determineSegmentType(line);
             if (segmentType == J9Segment::UNKNOWN)
-               {
-               cerr << "Unknown segment type at line " << lineNo << endl;  exit(-1);
-               }
+               throw runtime_error("Unknown segment type at line " + to_string(lineNo));
             }
          else if (line.find("1STSEGMENT", 0) != std::string::npos)
             {
@@ -269,16 +295,12 @@ void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, ve
             vector<string> tokens;
             tokenize(line, tokens);
             if (tokens.size() != 7)
-               {
-               cerr << "Have found " << tokens.size() << " instead of 7 at line " << lineNo << endl; exit(-1);
-               }
+               throw runtime_error("Have found " + to_string(tokens.size()) + " instead of 7 at line " + to_string(lineNo));
             unsigned long long id        = hex2ull(tokens[1]);
             unsigned long long startAddr = hex2ull(tokens[2]);
             unsigned long long endAddr   = hex2ull(tokens[4]);
             if (id == HEX_CONVERT_ERROR || startAddr == HEX_CONVERT_ERROR || endAddr == HEX_CONVERT_ERROR)
-               {
-               cerr << "HEX_CONVERT_ERROR in javacore at line:" << lineNo << " : " << line << std::endl; exit(-1);
-               }
+               throw runtime_error("HEX_CONVERT_ERROR in javacore at line:" + to_string(lineNo) + " : " + line);
             unsigned flags = strtoul(tokens[5].c_str(), NULL, 16);
 
             // For some segment types we may want to compute the RSS right here
@@ -297,6 +319,6 @@ void readJavacore(const char * javacoreFilename, vector<J9Segment>& segments, ve
       } // end while
    javacoreParseStack(myfile, lineNo, threadStacks, pageMapReader);
    myfile.close();
-   cout << "Reading of segments from javacore file finished\n";
+   progress << "Reading of segments from javacore file finished\n";
    }
 
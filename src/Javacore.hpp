@@ -53,6 +53,7 @@ class J9Segment : public  AddrRange
    public:
       J9Segment(unsigned long long id, unsigned long long start, unsigned long long end, SegmentType segType, unsigned flags, unsigned long long rss) :
          AddrRange(start, end, rss),  _id(id), _type(segType), _flags(flags) {}
+      unsigned long long getId() const { return _id; }
       const char *getTypeName() const { return _segmentTypes[_type]; }
       SegmentType getSegmentType() const { return _type; }
       unsigned getFlags() const { return _flags; }
@@ -67,8 +68,7 @@ class J9Segment : public  AddrRange
       virtual RangeCategories getRangeCategory() const override;
       bool isJITScratch() const { return _type == INTERNAL && (_flags & MEMORY_TYPE_JIT_SCRATCH_SPACE); }
       bool isJITPersistent() const { return _type == INTERNAL && (_flags & MEMORY_TYPE_JIT_PERSISTENT); }
-   protected:
-      virtual void print(std::ostream& os) const;
+      virtual void format(BufferedWriter& out) const override;
    }; // J9Segment
 
 
@@ -88,12 +88,24 @@ class ThreadStack : public  AddrRange
          }
       virtual int rangeType() const override { return THREADSTACK_RANGE; }
       virtual RangeCategories getRangeCategory() const override { return STACK; }
-   protected:
-      virtual void print(std::ostream& os) const;
+      virtual void format(BufferedWriter& out) const override;
    }; // J9Segment
 
+// General information found in the header of the javacore
+struct JavacoreInfo
+   {
+   unsigned long long _dumpTimeMs = 0; // from 1TIDATETIME; milliseconds since epoch (local time of the JVM)
+   unsigned long long _jvmStartTimeMs = 0; // from 1CISTARTTIME; same time base as _dumpTimeMs
+   unsigned long long _processId = 0;      // from 1CIPROCESSID
+   std::string _javaVersion;               // from 1CIJAVAVERSION, e.g. "JRE 17.0.9 Linux amd64-64 (build 17.0.9+9)"
+   std::string _vmVersion;                 // from 1CIVMVERSION, e.g. "Eclipse OpenJ9 VM openj9-0.41.0"
+   };
+
 J9Segment::SegmentType determineSegmentType(const std::string& line);
-void readJavacore(const char * javacoreFilename, std::vector<J9Segment>& segments, std::vector<ThreadStack>& threadStacks, PageMapReader *pagemapReader);
+// Throws std::runtime_error if the file cannot be read or parsed. The progress messages go
+// to 'progress', so that a reader running on its own thread can buffer them
+void readJavacore(const char * javacoreFilename, std::vector<J9Segment>& segments, std::vector<ThreadStack>& threadStacks, PageMapReader *pagemapReader,
+                  JavacoreInfo *javacoreInfo = nullptr, std::ostream& progress = std::cout);
 
 
 #endif // _J9_SEGMENT_HPP__
\ No newline at end of file
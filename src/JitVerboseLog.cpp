@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm> // for lower_bound
+#include <cstring> // for strlen
+#include <cctype> // for isdigit
+#include <stdexcept> // runtime_error
+#include "JitVerboseLog.hpp"
+
+using namespace std;
+
+std::ostream& operator<<(std::ostream& os, const JitCompilation& comp)
+   {
+   os << "scratch=" << setw(7) << comp._scratchSystemKB << " KB region=" << setw(7) << comp._scratchRegionKB <<
+         " KB time=" << setw(8) << comp._timeUs << "us (" << comp._optLevel << ") " << comp._method;
+   return os;
+   }
+
+// Parse the decimal number that follows 'key' in the line. Returns false if 'key' is not present
+static bool parseNumberAfter(const string& line, const char *key, size_t startPos, unsigned long long& value)
+   {
+   size_t pos = line.find(key, startPos);
+   if (pos == string::npos)
+      return false;
+   pos = line.find_first_not_of(' ', pos + strlen(key));
+   if (pos == string::npos || !isdigit((unsigned char)line[pos]))
+      return false;
+   value = 0;
+   for (; pos < line.size() && isdigit((unsigned char)line[pos]); pos++)
+      value = value * 10 + (line[pos] - '0');
+   return true;
+   }
+
+// Parse a successful compilation line. Returns false for all other lines
+static bool parseCompilationLine(const string& line, JitCompilation& comp)
+   {
+   // + (warm) java/lang/String.hashCode()I @ 00007F1B2C00003C-00007F1B2C000080 ...
+   if (line.size() < 4 || line[0] != '+' || line[2] != '(')
+      return false;
+   size_t levelEnd = line.find(')', 3);
+   if (levelEnd == string::npos)
+      return false;
+   size_t methodStart = levelEnd + 2;
+   size_t methodEnd = line.find(" @ ", methodStart);
+   if (methodEnd == string::npos)
+      return false;
+   // mem=[region=1024 system=16384]KB is only printed with {compilePerformance}
+   size_t memPos = line.find(" mem=[", methodEnd);
+   if (memPos == string::npos)
+      return false;
+   comp._optLevel.assign(line, 3, levelEnd - 3);
+   comp._method.assign(line, methodStart, methodEnd - methodStart);
+   comp._scratchRegionKB = comp._scratchSystemKB = comp._timeUs = 0;
+   parseNumberAfter(line, "region=", memPos, comp._scratchRegionKB);
+   parseNumberAfter(line, "system=", memPos, comp._scratchSystemKB);
+   parseNumberAfter(line, " time=", methodEnd, comp._timeUs);
+   comp._hasTimestamp = parseNumberAfter(line, " t=", methodEnd, comp._offsetMs);
+   return true;
+   }
+
+/**
+ * Stream through a JIT verbose log collecting scratch memory statistics per
+ * optimization level, the compilations with the largest scratch memory, and
+ * for each snapshot the peak compilation since the previous snapshot.
+ * Compilations are placed in time using their t= offset and the JVM start
+ * time from the javacore; snapshots must be sorted by timestamp.
+*/
+void correlateJitVerboseLog(const char *jitLogFilename, const vector<FootprintSnapshot>& snapshots, JitScratchReport& report)
+   {
+   cout << "Reading JIT verbose log: " << jitLogFilename << endl;
+   ifstream myfile(jitLogFilename);
+   if (!myfile.is_open())
+      {
+      throw runtime_error("Cannot open " + string(jitLogFilename));
+      }
+   // Time of every snapshot relative to the start of the JVM
+   vector<unsigned long long> snapshotOffsetsMs;
+   for (auto& snapshot : snapshots)
+      {
+      if (snapshot._jvmStartTimeMs == 0 || snapshot._timestampMs < snapshot._jvmStartTimeMs)
+         {
+         snapshotOffsetsMs.clear(); // cannot place compilations in time
+         break;
+         }
+      snapshotOffsetsMs.push_back(snapshot._timestampMs - snapshot._jvmStartTimeMs);
+      }
+   report._windows.assign(snapshots.size(), JitScratchWindow());
+
+   string line;
+   JitCompilation comp;
+   while (getline(myfile, line))
+      {
+      if (!parseCompilationLine(line, comp))
+         continue;
+      report._numCompilations++;
+      report._topCompilations.processElement(comp);
+
+      auto level = find_if(report._optLevels.begin(), report._optLevels.end(),
+                           [&comp](const JitOptLevelStats& stats) { return stats._optLevel == comp._optLevel; });
+      if (level == report._optLevels.end())
+         {
+         report._optLevels.push_back(JitOptLevelStats());
+         level = report._optLevels.end() - 1;
+         level->_optLevel = comp._optLevel;
+         }
+      level->_numCompilations++;
+      level->_totalSystemKB += comp._scratchSystemKB;
+      level->_maxSystemKB = max(level->_maxSystemKB, comp._scratchSystemKB);
+      level->_totalTimeUs += comp._timeUs;
+
+      if (!comp._hasTimestamp)
+         {
+         report._numWithoutTimestamp++;
+         continue;
+         }
+      // The compilation belongs to the first snapshot taken after it ended
+      auto snapshotIt = lower_bound(snapshotOffsetsMs.begin(), snapshotOffsetsMs.end(), comp._offsetMs);
+      if (snapshotIt == snapshotOffsetsMs.end())
+         continue;
+      JitScratchWindow& window = report._windows[snapshotIt - snapshotOffsetsMs.begin()];
+      window._numCompilations++;
+      if (window._numCompilations == 1 || comp._scratchSystemKB > window._peak._scratchSystemKB)
+         window._peak = comp;
+      }
+   sort(report._optLevels.begin(), report._optLevels.end(),
+        [](const JitOptLevelStats& s1, const JitOptLevelStats& s2) { return s1._maxSystemKB > s2._maxSystemKB; });
+   }
+
+void printJitScratchReport(const vector<FootprintSnapshot>& snapshots, const JitScratchReport& report)
+   {
+   cout << "\nJIT scratch memory by optimization level (" << report._numCompilations << " compilations):\n";
+   cout << setw(24) << "Level" << setw(14) << "Compilations" << setw(14) << "AvgScratchKB" << setw(14) << "MaxScratchKB" << setw(15) << "TotalTime(ms)" << "\n";
+   for (auto& level : report._optLevels)
+      {
+      cout << setw(24) << level._optLevel << setw(14) << level._numCompilations <<
+              setw(14) << level._totalSystemKB / level._numCompilations << setw(14) << level._maxSystemKB <<
+              setw(15) << level._totalTimeUs / 1000 << "\n";
+      }
+   cout << "\nCompilations with the largest scratch memory:\n";
+   report._topCompilations.print();
+
+   if (report._numWithoutTimestamp == report._numCompilations)
+      {
+      cout << "\nThe JIT verbose log has no timestamps (t=); compilations cannot be correlated with snapshots\n";
+      return;
+      }
+   if (snapshots.empty() || snapshots.front()._jvmStartTimeMs == 0)
+      {
+      cout << "\nThe javacore has no JVM start time (1CISTARTTIME); compilations cannot be correlated with snapshots\n";
+      return;
+      }
+   cout << "\nJIT memory at each snapshot and the compilation with the largest scratch memory since the previous snapshot:\n";
+   cout << setw(10) << "Elapsed(s)" << setw(14) << "ScratchVirtKB" << setw(13) << "ScratchRSSKB" << setw(14) << "PersistVirtKB" << setw(13) << "PersistRSSKB" <<
+           setw(8) << "Comps" << "  Peak compilation\n";
+   unsigned long long startMs = snapshots.front()._timestampMs;
+   for (size_t i = 0; i < snapshots.size(); i++)
+      {
+      const FootprintSnapshot& snapshot = snapshots[i];
+      const JitScratchWindow& window = report._windows[i];
+      cout << setw(10) << (snapshot._timestampMs >= startMs ? (snapshot._timestampMs - startMs) / 1000 : 0) <<
+              setw(14) << (snapshot._virtualSize[AddrRange::SCRATCH] >> 10) << setw(13) << (snapshot._rssSize[AddrRange::SCRATCH] >> 10) <<
+              setw(14) << (snapshot._virtualSize[AddrRange::PERSIST] >> 10) << setw(13) << (snapshot._rssSize[AddrRange::PERSIST] >> 10) <<
+              setw(8) << window._numCompilations;
+      if (window._numCompilations > 0)
+         cout << "  " << window._peak;
+      cout << "\n";
+      }
+   }
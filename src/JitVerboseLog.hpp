@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _JITVERBOSELOG_HPP__
+#define _JITVERBOSELOG_HPP__
+#include <string>
+#include <vector>
+#include <iostream>
+#include "TimeSeries.hpp"
+#include "Util.hpp"
+
+/*
+One compilation from a -Xjit:verbose={compilePerformance} log, e.g.
++ (warm) java/lang/String.hashCode()I @ 00007F1B2C00003C-00007F1B2C000080 OrdinaryMethod - Q_SZ=0 Q_SZI=0 QW=1 j9m=0000000000B0B568 bcsz=55 time=553us mem=[region=1024 system=16384]KB compThreadID=0
+'region' is the scratch memory used by the compilation and 'system' is the memory
+of the J9 scratch segments (MEMORY_TYPE_JIT_SCRATCH_SPACE) allocated to satisfy it
+*/
+struct JitCompilation
+   {
+   std::string        _method;
+   std::string        _optLevel;
+   unsigned long long _scratchRegionKB = 0;
+   unsigned long long _scratchSystemKB = 0;
+   unsigned long long _timeUs = 0;
+   unsigned long long _offsetMs = 0; // time since JVM start, from t= when present
+   bool               _hasTimestamp = false;
+   };
+std::ostream& operator<<(std::ostream& os, const JitCompilation& comp);
+
+struct JitCompilationScratchLessThan
+   {
+   bool operator() (const JitCompilation& c1, const JitCompilation& c2) const
+      {
+      return c1._scratchSystemKB < c2._scratchSystemKB;
+      }
+   };
+
+// Aggregate scratch memory demand for all compilations at one optimization level
+struct JitOptLevelStats
+   {
+   std::string        _optLevel;
+   unsigned long long _numCompilations = 0;
+   unsigned long long _totalSystemKB = 0;
+   unsigned long long _maxSystemKB = 0;
+   unsigned long long _totalTimeUs = 0;
+   };
+
+// Compilations that finished between the previous snapshot and this one
+struct JitScratchWindow
+   {
+   unsigned long long _numCompilations = 0;
+   JitCompilation     _peak; // compilation with the largest scratch memory in the window
+   };
+
+struct JitScratchReport
+   {
+   unsigned long long _numCompilations = 0;
+   unsigned long long _numWithoutTimestamp = 0;
+   std::vector<JitOptLevelStats> _optLevels;
+   TopK<JitCompilation, JitCompilationScratchLessThan> _topCompilations;
+   std::vector<JitScratchWindow> _windows; // one for each snapshot
+   explicit JitScratchReport(size_t topK = 10) : _topCompilations(topK) {}
+   };
+
+// Throws std::runtime_error if the file cannot be read
+void correlateJitVerboseLog(const char *jitLogFilename, const std::vector<FootprintSnapshot>& snapshots, JitScratchReport& report);
+void printJitScratchReport(const std::vector<FootprintSnapshot>& snapshots, const JitScratchReport& report);
+
+#endif // _JITVERBOSELOG_HPP__
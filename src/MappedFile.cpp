@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <fcntl.h> // for open
+#include <unistd.h> // for close
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include "MappedFile.hpp"
+
+bool MappedFile::open(const char *filename)
+   {
+   close();
+   int fd = ::open(filename, O_RDONLY);
+   if (fd < 0)
+      return false;
+   struct stat st;
+   bool success = fstat(fd, &st) == 0;
+   if (success && st.st_size > 0)
+      {
+      void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED)
+         {
+         // The file is read front to back only once
+         madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+         _data = static_cast<const char *>(mapping);
+         _size = st.st_size;
+         }
+      else
+         {
+         success = false;
+         }
+      }
+   ::close(fd);
+   return success;
+   }
+
+void MappedFile::close()
+   {
+   if (_data)
+      munmap(const_cast<char *>(_data), _size);
+   _data = nullptr;
+   _size = 0;
+   }
@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _MAPPEDFILE_HPP__
+#define _MAPPEDFILE_HPP__
+#include <string_view>
+#include <cstddef>
+
+// Read-only view of a whole file mapped in memory.
+// Readers tokenize the contents with string_views instead of copying lines and fields
+class MappedFile
+   {
+   public:
+      MappedFile() : _data(nullptr), _size(0) {}
+      ~MappedFile() { close(); }
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+      bool open(const char *filename); // false if the file cannot be opened; an empty file is valid
+      void close();
+      std::string_view contents() const { return std::string_view(_data, _size); }
+   private:
+      const char *_data;
+      size_t _size;
+   };
+
+// Iterates through the lines of a text without copying them.
+// The line terminator, including a '\r' before '\n', is not part of the line
+class LineReader
+   {
+   public:
+      explicit LineReader(std::string_view text) : _text(text), _pos(0) {}
+      bool nextLine(std::string_view& line)
+         {
+         if (_pos >= _text.size())
+            return false;
+         size_t endPos = _text.find('\n', _pos);
+         if (endPos == std::string_view::npos)
+            endPos = _text.size();
+         line = _text.substr(_pos, endPos - _pos);
+         if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+         _pos = endPos + 1;
+         return true;
+         }
+   private:
+      std::string_view _text;
+      size_t _pos;
+   };
+
+#endif // _MAPPEDFILE_HPP__
@@ -22,10 +22,26 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <stdexcept> // runtime_error
+#include <sstream>
 #include "MemoryEntry.hpp"
 
 using namespace std;
 
+void MemoryEntry::setPurpose(SmapPurpose purpose)
+   {
+   if (_purpose == UNKNOWN)
+      {
+      _purpose = purpose;
+      }
+   else if (_purpose != purpose)
+      {
+      ostringstream message;
+      message << "Error: Setting _purpose to '" << _purposeNames[purpose] << "' but purpose already set to '" << _purposeNames[_purpose] << "' for " << *this;
+      throw runtime_error(message.str());
+      }
+   }
+
 void MemoryEntry::addCoveringRange(const AddrRange& seg)
    {
    // insert based on start address
@@ -41,38 +57,41 @@ void MemoryEntry::addCoveringRange(const AddrRange& seg)
    _coveringRanges.insert(s, &seg);
    }
 
-void MemoryEntry::print(std::ostream& os) const
+void MemoryEntry::format(BufferedWriter& out) const
    {
-   os << std::hex << "Start=" << setfill('0') << setw(16) << getStart() <<
-      " End=" << setfill('0') << setw(16) << getEnd() << std::dec <<
-      " Size=" << setfill(' ') << setw(6) << sizeKB() << " rss=" << setfill(' ') << setw(6) << _rss << " Prot=" << getProtectionString();
+   out.write("Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16)
+      .write(" Size=").dec(sizeKB(), 6).write(" rss=").dec(_rss, 6).write(" Prot=").write(_protection);
    if (_details.length() > 0)
-      os << " " << _details;
+      out.put(' ').write(_details);
    }
 
 // Print entry with annotations
-void MemoryEntry::printEntryWithAnnotations() const
+void MemoryEntry::printEntryWithAnnotations(BufferedWriter& out) const
    {
    // Print the entry first
-   cout << "MemEntry: " << *this << endl;
+   out.write("MemEntry: ");
+   format(out);
+   out.put('\n');
    // Check whether I need to print any covering segments/call-sites
-   const list<const AddrRange*> coveringRanges = getCoveringRanges();
-   if (coveringRanges.size() != 0)
+   if (_coveringRanges.size() != 0)
       {
-      cout << "\tCovering segments/call-sites:\n";
+      out.write("\tCovering segments/call-sites:\n");
       // Go through the list of covering ranges
-      for (list<const AddrRange*>::const_iterator range = coveringRanges.begin(); range != coveringRanges.end(); ++range)
+      for (const AddrRange *range : _coveringRanges)
          {
-         cout << "\t\t" << **range << endl;
+         out.write("\t\t");
+         range->format(out);
+         out.put('\n');
          }
       }
-   const list<const AddrRange*> overlappingRanges = getOverlappingRanges();
-   if (overlappingRanges.size() != 0)
+   if (_overlappingRanges.size() != 0)
       {
-      cout << "\tOverlapping segments/call-sites:\n";
-      for (list<const AddrRange*>::const_iterator range = overlappingRanges.begin(); range != overlappingRanges.end(); ++range)
+      out.write("\tOverlapping segments/call-sites:\n");
+      for (const AddrRange *range : _overlappingRanges)
          {
-         cout << "\t\t" << **range << endl;
+         out.write("\t\t");
+         range->format(out);
+         out.put('\n');
          }
       }
    }
@@ -33,25 +33,54 @@
 class MemoryEntry
    {
    public:
+   // Some maps contain allocations for a single purpose, such as the java heap, stack, or code cache.
+   // If a map is for a single purpose, we can use this enum to identify the purpose.
+   // Otherwise, the purpose is GENERIC.
+   // For maps with a single purpose we can get RSS directly from the map and don't have to read the page map
+   enum SmapPurpose {
+      UNKNOWN = 0,
+      GENERIC,
+      JAVAHEAP,
+      DLL,
+      STACK,
+      CODECACHE,
+      SCC
+   };
+   static constexpr const char * const _purposeNames[] = {
+      "UNKNOWN",
+      "GENERIC",
+      "JAVAHEAP",
+      "DLL",
+      "STACK",
+      "CODECACHE",
+      "SCC"
+   };
       AddrRange          _addrRange;
       unsigned long long _rss;
       std::string        _details;
       std::string        _protection;
+      std::string        _customCategory; // set by a classification rule; empty for most maps
       // The following two fields are sorted lists of heterogenous objects derived from AddrRange
       // To be able to call the correct 'print' function based on the type of the object
       // we must store pointers
       std::list<const AddrRange*> _coveringRanges;    // address ranges that are included of this smap;
       std::list<const AddrRange*> _overlappingRanges; // address ranges that overlap or are bigger than this smap
+   private:
+      SmapPurpose _purpose;
    public:
       MemoryEntry() { clear(); }
       virtual void clear()
          {
          _addrRange.clear();
          _details.clear();
+         _customCategory.clear();
          _rss = 0;
          _coveringRanges.clear();
          _overlappingRanges.clear();
+         _purpose = UNKNOWN;
          }
+      SmapPurpose getPurpose() const { return _purpose; }
+      void setPurpose(SmapPurpose purpose); // throws std::runtime_error if a different purpose was set before
       const AddrRange& getAddrRange() const { return _addrRange; }
       void addCoveringRange(const AddrRange& seg);
       void addOverlappingRange(const AddrRange& seg) { _overlappingRanges.push_back(&seg); }
@@ -64,6 +93,7 @@ class MemoryEntry
       unsigned long long gapKB(const MemoryEntry& toOther) const { return _addrRange.gapKB(toOther.getAddrRange()); }
       const std::string& getDetailsString() const { return _details; }
       const std::string& getProtectionString() const { return _protection; }
+      const std::string& getCustomCategory() const { return _customCategory; }
       unsigned long long getStart() const { return _addrRange.getStart(); }
       unsigned long long getEnd() const { return _addrRange.getEnd(); }
       void setStart(unsigned long long a){ _addrRange.setStart(a); }
@@ -72,10 +102,17 @@ class MemoryEntry
       //bool disjoint(const AddrRange& other) const { return _endAddr <= other._startAddr || other._endAddr <= _startAddr; }
       bool operator <(const MemoryEntry& other) const { return this->getAddrRange() < other.getAddrRange(); }
       bool operator >(const MemoryEntry& other) const { return this->getAddrRange() > other.getAddrRange(); }
-      virtual void printEntryWithAnnotations() const;
+      void printEntryWithAnnotations(BufferedWriter& out) const;
+      // Text of the entry, as printed by operator<<
+      virtual void format(BufferedWriter& out) const;
       friend std::ostream& operator<<(std::ostream& os, const MemoryEntry& ar);
    protected:
-      virtual void print(std::ostream& os) const;
+      void print(std::ostream& os) const
+         {
+         BufferedWriter out;
+         format(out);
+         os << out.view();
+         }
    };
 
 inline std::ostream& operator<< (std::ostream& os, const MemoryEntry& me)
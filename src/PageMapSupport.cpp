@@ -8,6 +8,7 @@
 #include <string.h> // strerror
 #include <stdexcept> // runtime_error
 #include <iostream> // cerr
+#include <algorithm> // sort, upper_bound
 #include "PageMapSupport.hpp"
 
 
@@ -40,8 +41,8 @@ PageMapReader::PageMapReader(int pid): _pid(pid)
    // form filename
    snprintf(_pagemapPath, sizeof(_pagemapPath), "/proc/%d/pagemap", pid);
 
-   int pagemapfd = open(_pagemapPath, O_RDONLY);
-   if (pagemapfd < 0)
+   _pagemapfd = open(_pagemapPath, O_RDONLY);
+   if (_pagemapfd < 0)
       {
       std::cerr << "Cannot open pagemap file: " << _pagemapPath << std::endl;
       std::cerr << "Verify that PID exists and that we have read permission on the file." << std::endl;
@@ -55,7 +56,143 @@ PageMapReader::~PageMapReader()
    close(_pagemapfd);
    }
 
+// Remember the VMAs of the process (e.g. the maps read from its smaps file).
+// computeRssForAddrRange will then use the presence bits cached for each VMA.
+// The VMAs describe a new state of the process, so the bits cached so far are dropped
+void PageMapReader::setVmas(const std::vector<std::pair<unsigned long long, unsigned long long>>& vmas)
+   {
+   std::unique_lock<std::shared_mutex> lock(_cacheMutex);
+   _vmaPresentPages.clear();
+   _vmaChunkChecksums.clear();
+   _vmas = vmas;
+   std::sort(_vmas.begin(), _vmas.end());
+   for (const auto& vma : _vmas)
+      _vmaPresentPages[vma.first].reset(new VmaPages(vma.second));
+   }
+
+void PageMapReader::updateVmas(const std::vector<std::pair<unsigned long long, unsigned long long>>& vmas, const std::vector<bool>& dirty)
+   {
+   std::unique_lock<std::shared_mutex> lock(_cacheMutex);
+   std::unordered_map<unsigned long long, std::unique_ptr<VmaPages>> presentPages;
+   std::unordered_map<unsigned long long, std::vector<uint64_t>> chunkChecksums;
+   for (size_t i = 0; i < vmas.size(); i++)
+      {
+      std::unique_ptr<VmaPages>& pages = presentPages[vmas[i].first];
+      if (!dirty[i])
+         {
+         auto present = _vmaPresentPages.find(vmas[i].first);
+         if (present != _vmaPresentPages.end() && present->second->_end == vmas[i].second)
+            pages.swap(present->second);
+         auto checksums = _vmaChunkChecksums.find(vmas[i].first);
+         if (checksums != _vmaChunkChecksums.end())
+            chunkChecksums[vmas[i].first].swap(checksums->second);
+         }
+      if (!pages)
+         pages.reset(new VmaPages(vmas[i].second));
+      }
+   _vmaPresentPages.swap(presentPages);
+   _vmaChunkChecksums.swap(chunkChecksums);
+   _vmas = vmas;
+   std::sort(_vmas.begin(), _vmas.end());
+   }
+
+bool PageMapReader::refreshVma(unsigned long long vmaStart, unsigned long long vmaEnd, unsigned long long round,
+                               std::vector<std::pair<unsigned long long, unsigned long long>>& changed, bool& probedOnly)
+   {
+   std::unique_lock<std::shared_mutex> lock(_cacheMutex);
+   probedOnly = false;
+   std::unique_ptr<VmaPages>& pages = _vmaPresentPages[vmaStart];
+   std::vector<uint64_t>& checksums = _vmaChunkChecksums[vmaStart];
+   size_t numPages = (vmaEnd - vmaStart + _pageSize - 1) / _pageSize;
+   size_t numChunks = (numPages + CHECKSUM_CHUNK_PAGES - 1) / CHECKSUM_CHUNK_PAGES;
+   bool known = pages && pages->_end == vmaEnd && pages->_present.size() == numPages && checksums.size() == numChunks;
+   // Small VMAs are cheap enough to read entirely every round
+   if (known && numChunks >= REFRESH_PROBE_STRIDE)
+      {
+      bool probeChanged = false;
+      std::vector<bool> probe;
+      for (size_t chunk = round % REFRESH_PROBE_STRIDE; chunk < numChunks && !probeChanged; chunk += REFRESH_PROBE_STRIDE)
+         {
+         size_t firstPage = chunk * CHECKSUM_CHUNK_PAGES, lastPage = std::min<size_t>(numPages, firstPage + CHECKSUM_CHUNK_PAGES);
+         readPresentPages(vmaStart + firstPage * _pageSize, std::min(vmaEnd, vmaStart + lastPage * _pageSize), probe);
+         probeChanged = !std::equal(probe.begin(), probe.end(), pages->_present.begin() + firstPage);
+         }
+      if (!probeChanged)
+         {
+         probedOnly = true;
+         return false;
+         }
+      }
+   pages.reset(new VmaPages(vmaEnd));
+   const std::vector<bool>& present = presentPages(*pages, vmaStart);
+
+   bool anyChanged = false;
+   checksums.resize(numChunks);
+   for (size_t chunk = 0; chunk < numChunks; chunk++)
+      {
+      // FNV-1a over the presence bits packed in 64-bit words
+      uint64_t checksum = 14695981039346656037ULL, word = 0;
+      size_t firstPage = chunk * CHECKSUM_CHUNK_PAGES, lastPage = std::min<size_t>(present.size(), firstPage + CHECKSUM_CHUNK_PAGES);
+      for (size_t page = firstPage; page < lastPage; page++)
+         {
+         word = (word << 1) | present[page];
+         if ((page - firstPage) % 64 == 63)
+            {
+            checksum = (checksum ^ word) * 1099511628211ULL;
+            word = 0;
+            }
+         }
+      checksum = (checksum ^ word) * 1099511628211ULL;
+      if (known && checksums[chunk] == checksum)
+         continue;
+      checksums[chunk] = checksum;
+      anyChanged = true;
+      unsigned long long chunkStart = vmaStart + firstPage * _pageSize;
+      unsigned long long chunkEnd = std::min(vmaEnd, vmaStart + lastPage * _pageSize);
+      if (!changed.empty() && changed.back().second == chunkStart)
+         changed.back().second = chunkEnd; // adjacent changed chunks make one interval
+      else
+         changed.emplace_back(chunkStart, chunkEnd);
+      }
+   return anyChanged;
+   }
+
+// Resident bytes of [startAddr, endAddr). The parts of the range inside known VMAs are
+// counted from the cached presence bits of the VMA; the rest is read from the pagemap
 unsigned long long PageMapReader::computeRssForAddrRange(unsigned long long startAddr, unsigned long long endAddr)
+   {
+   if (startAddr >= endAddr)
+      throw std::runtime_error("invalid address range");
+   std::shared_lock<std::shared_mutex> lock(_cacheMutex);
+   if (_vmas.empty())
+      return readRssForAddrRange(startAddr, endAddr);
+
+   unsigned long long rss = 0;
+   // First VMA that may contain startAddr
+   auto vma = std::upper_bound(_vmas.begin(), _vmas.end(), std::make_pair(startAddr, ~0ULL));
+   if (vma != _vmas.begin())
+      --vma;
+   unsigned long long cursor = startAddr;
+   for (; vma != _vmas.end() && vma->first < endAddr && cursor < endAddr; ++vma)
+      {
+      if (vma->second <= cursor)
+         continue;
+      if (vma->first > cursor)
+         {
+         rss += readRssForAddrRange(cursor, vma->first); // hole between the known VMAs
+         cursor = vma->first;
+         }
+      unsigned long long pieceEnd = std::min(endAddr, vma->second);
+      rss += countResidentBytes(presentPages(*_vmaPresentPages.at(vma->first), vma->first), vma->first, cursor, pieceEnd);
+      cursor = pieceEnd;
+      }
+   if (cursor < endAddr)
+      rss += readRssForAddrRange(cursor, endAddr);
+   return rss;
+   }
+
+// Resident bytes of [startAddr, endAddr) read page by page from the pagemap
+unsigned long long PageMapReader::readRssForAddrRange(unsigned long long startAddr, unsigned long long endAddr)
    {
    if (startAddr >= endAddr)
       throw std::runtime_error("invalid address range");
@@ -113,4 +250,83 @@ unsigned long long PageMapReader::computeRssForAddrRange(unsigned long long star
          }
       } // end for
    return rss;
-   }
\ No newline at end of file
+   }
+
+// Determine which pages of [startAddr, endAddr) are present in physical memory.
+// The range is extended to page boundaries and present[i] corresponds to the
+// i-th page starting from the page that contains startAddr.
+// Entries are read in large batches rather than one pread per page
+void PageMapReader::readPresentPages(unsigned long long startAddr, unsigned long long endAddr, std::vector<bool>& present)
+   {
+   if (startAddr >= endAddr)
+      throw std::runtime_error("invalid address range");
+   unsigned long long firstPage = startAddr / _pageSize;
+   unsigned long long lastPage = (endAddr + _pageSize - 1) / _pageSize; // exclusive
+   present.assign(lastPage - firstPage, false);
+
+   const unsigned long long BATCH_SIZE = 8192; // pagemap entries read at once
+   uint64_t entries[BATCH_SIZE];
+   for (unsigned long long page = firstPage; page < lastPage; page += BATCH_SIZE)
+      {
+      unsigned long long numPages = lastPage - page < BATCH_SIZE ? lastPage - page : BATCH_SIZE;
+      ssize_t bytesToRead = numPages * sizeof(uint64_t);
+      ssize_t bytesRead = pread(_pagemapfd, entries, bytesToRead, (off_t)(page * sizeof(uint64_t)));
+      if (bytesRead < 0)
+         {
+         // Is the process still alive?
+         throw std::runtime_error("cannot read pagemap file: " + std::string(_pagemapPath) + std::string(strerror(errno)));
+         }
+      // The pagemap ends before the top of the address space (e.g. [vsyscall]); such pages are not present
+      if (bytesRead < bytesToRead)
+         numPages = bytesRead / sizeof(uint64_t);
+      for (unsigned long long i = 0; i < numPages; i++)
+         {
+         pmd_t pmd;
+         pmd.pmd = entries[i];
+         if (pmd.pmd != 0 && pmd.present)
+            present[page - firstPage + i] = true;
+         }
+      }
+   }
+
+// The presence bits of a VMA; the pagemap is read only the first time. The caller holds _cacheMutex
+const std::vector<bool>& PageMapReader::presentPages(VmaPages& pages, unsigned long long vmaStart)
+   {
+   std::call_once(pages._read, [&]() { readPresentPages(vmaStart, pages._end, pages._present); });
+   return pages._present;
+   }
+
+// Return the presence bits for a VMA. The pagemap is read only the first time a VMA is requested
+const std::vector<bool>& PageMapReader::getPresentPagesForVma(unsigned long long vmaStart, unsigned long long vmaEnd)
+   {
+      {
+      std::shared_lock<std::shared_mutex> lock(_cacheMutex);
+      auto it = _vmaPresentPages.find(vmaStart);
+      if (it != _vmaPresentPages.end() && it->second->_end == vmaEnd)
+         return presentPages(*it->second, vmaStart);
+      }
+   // Not one of the VMAs that were set
+   std::unique_lock<std::shared_mutex> lock(_cacheMutex);
+   std::unique_ptr<VmaPages>& pages = _vmaPresentPages[vmaStart];
+   if (!pages || pages->_end != vmaEnd)
+      pages.reset(new VmaPages(vmaEnd));
+   return presentPages(*pages, vmaStart);
+   }
+
+// Count the resident bytes of [startAddr, endAddr) given the presence bits of a
+// larger range whose first page starts at presentStartAddr (page aligned)
+unsigned long long PageMapReader::countResidentBytes(const std::vector<bool>& present, unsigned long long presentStartAddr,
+                                                     unsigned long long startAddr, unsigned long long endAddr) const
+   {
+   unsigned long long rss = 0;
+   while (startAddr < endAddr)
+      {
+      unsigned long long pageEnd = (startAddr & ~(_pageSize - 1)) + _pageSize;
+      unsigned long long chunkEnd = endAddr < pageEnd ? endAddr : pageEnd;
+      size_t pageIndex = (startAddr - presentStartAddr) / _pageSize;
+      if (pageIndex < present.size() && present[pageIndex])
+         rss += chunkEnd - startAddr;
+      startAddr = chunkEnd;
+      }
+   return rss;
+   }
@@ -1,5 +1,12 @@
 #ifndef PAGEMAPSUPPORT_HPP_
 #define PAGEMAPSUPPORT_HPP_
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
 
 class PageMapReader
    {
@@ -7,11 +14,55 @@ class PageMapReader
    long _pageSize; // page size of the system
    char _pagemapPath[64]; // buffer for holding the path to the pagemap file
    int _pagemapfd; // file descriptor for the pagemap file
+   // Presence bits of a VMA, read from the pagemap the first time they are needed. Threads that
+   // need different VMAs read them concurrently; threads that need the same VMA wait for one read
+   struct VmaPages
+      {
+      unsigned long long _end;
+      std::once_flag _read;
+      std::vector<bool> _present;
+      VmaPages(unsigned long long end) : _end(end) {}
+      };
+   // Presence bits for entire VMAs, read once and shared by all analyses (key is the start of the VMA).
+   // There is an entry for every VMA in _vmas, so looking up a VMA does not change the map
+   std::unordered_map<unsigned long long, std::unique_ptr<VmaPages>> _vmaPresentPages;
+   // VMAs of the process (start, end), sorted by start address. Ranges inside them are
+   // counted from the presence bits of their VMAs, so each VMA is scanned only once
+   std::vector<std::pair<unsigned long long, unsigned long long>> _vmas;
+   // The input reader threads count RSS under a shared lock; the methods that change
+   // the VMAs or read their bits again hold it exclusively
+   std::shared_mutex _cacheMutex;
+   // Checksums of the presence bits of every CHECKSUM_CHUNK_PAGES pages of a VMA, taken by refreshVma
+   static const unsigned long long CHECKSUM_CHUNK_PAGES = 512;
+   std::unordered_map<unsigned long long, std::vector<uint64_t>> _vmaChunkChecksums;
+
+   unsigned long long readRssForAddrRange(unsigned long long startAddr, unsigned long long endAddr);
+   const std::vector<bool>& presentPages(VmaPages& pages, unsigned long long vmaStart);
 
    public:
    PageMapReader(int pid);
    ~PageMapReader();
+   void setVmas(const std::vector<std::pair<unsigned long long, unsigned long long>>& vmas);
+   // New VMAs for a process whose pages changed only in the VMAs flagged dirty: the presence
+   // bits cached for the other VMAs are kept
+   void updateVmas(const std::vector<std::pair<unsigned long long, unsigned long long>>& vmas, const std::vector<bool>& dirty);
+   // Check whether the presence bits of a VMA changed since the previous refreshVma and append
+   // to 'changed' the chunks of the VMA whose bits differ (the whole VMA the first time).
+   // Only one chunk in REFRESH_PROBE_STRIDE is probed, starting at 'round' % REFRESH_PROBE_STRIDE;
+   // the VMA is read again entirely only if a probed chunk changed. Successive rounds probe all
+   // the chunks, so a change is seen at the latest after REFRESH_PROBE_STRIDE rounds: when
+   // 'probedOnly' is set, the bits of the chunks that were not probed may be that old.
+   // Returns true if any chunk changed
+   static const unsigned long long REFRESH_PROBE_STRIDE = 8;
+   bool refreshVma(unsigned long long vmaStart, unsigned long long vmaEnd, unsigned long long round,
+                   std::vector<std::pair<unsigned long long, unsigned long long>>& changed, bool& probedOnly);
    unsigned long long computeRssForAddrRange(unsigned long long startAddr, unsigned long long endAddr);
+   void readPresentPages(unsigned long long startAddr, unsigned long long endAddr, std::vector<bool>& present);
+   // The presence bits of a VMA, read once. The reference stays valid until the VMAs are set again
+   const std::vector<bool>& getPresentPagesForVma(unsigned long long vmaStart, unsigned long long vmaEnd);
+   unsigned long long countResidentBytes(const std::vector<bool>& present, unsigned long long presentStartAddr,
+                                         unsigned long long startAddr, unsigned long long endAddr) const;
+   long getPageSize() const { return _pageSize; }
    };
 
 #endif /* PAGEMAPSUPPORT_HPP_ */
\ No newline at end of file
@@ -0,0 +1,287 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm> // for sort, upper_bound
+#include <unordered_map>
+#include <stdexcept> // runtime_error
+#include "PerfMap.hpp"
+#include "Javacore.hpp"
+#include "PageMapSupport.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+// Optimization levels appended by the JIT to the method name in the perf map
+static const char * const optLevelNames[] = { "noOpt", "cold", "warm", "hot", "veryHot", "scorching", "reducedWarm", "unknown" };
+
+void JittedMethod::format(BufferedWriter& out) const
+   {
+   out.write("Start=").hex(getStart(), 16).write(" End=").hex(getEnd(), 16)
+      .write(" Size=").dec(size(), 7).write(" rss=").dec(getRSS(), 7).write(" (").write(_optLevel).write(") ").write(_name);
+   }
+
+// java/lang/String.hashCode()I --> java/lang
+std::string JittedMethod::getPackageName() const
+   {
+   size_t classEnd = _name.find('.');
+   if (classEnd == string::npos)
+      return "<non-Java>"; // e.g. JIT helpers or trampolines
+   size_t packageEnd = _name.rfind('/', classEnd);
+   if (packageEnd == string::npos)
+      return "<default>";
+   return _name.substr(0, packageEnd);
+   }
+
+/*
+Each line describes one method: start address, size (both in hex) and name
+7F1B2C00003C 44 java/lang/String.hashCode()I_warm
+The file is only appended to, so when code cache space is reused after a
+method is unloaded or recompiled, the old entry overlaps the new one.
+Overlaps are resolved in favor of the entry that comes later in the file.
+*/
+void PerfMapIndex::readPerfMapFile(const char *perfMapFilename)
+   {
+   cout << "Reading perf map file: " << perfMapFilename << endl;
+   ifstream myfile(perfMapFilename);
+   if (!myfile.is_open())
+      {
+      throw runtime_error("Cannot open " + string(perfMapFilename));
+      }
+   vector<pair<JittedMethod, size_t>> methods; // the second element is the position in the file
+   string line, startStr, sizeStr;
+   int lineNo = 0;
+   while (getline(myfile, line))
+      {
+      lineNo++;
+      size_t startPos = line.find_first_not_of(" \t");
+      if (startPos == string::npos)
+         continue;
+      size_t sizePos = line.find(' ', startPos);
+      size_t namePos = sizePos == string::npos ? string::npos : line.find(' ', sizePos + 1);
+      if (namePos == string::npos)
+         {
+         cerr << "Cannot parse perf map line " << lineNo << ": " << line << endl;
+         continue;
+         }
+      startStr.assign(line, startPos, sizePos - startPos);
+      sizeStr.assign(line, sizePos + 1, namePos - sizePos - 1);
+      unsigned long long start = hex2ull(startStr);
+      unsigned long long size = hex2ull(sizeStr);
+      if (start == HEX_CONVERT_ERROR || size == HEX_CONVERT_ERROR || size == 0)
+         continue;
+      string name = line.substr(namePos + 1);
+      string optLevel;
+      size_t levelPos = name.rfind('_');
+      if (levelPos != string::npos)
+         {
+         for (const char *levelName : optLevelNames)
+            {
+            if (name.compare(levelPos + 1, string::npos, levelName) == 0)
+               {
+               optLevel = levelName;
+               name.resize(levelPos);
+               break;
+               }
+            }
+         }
+      methods.emplace_back(JittedMethod(start, start + size, name, optLevel), methods.size());
+      }
+
+   sort(methods.begin(), methods.end(),
+        [](const pair<JittedMethod, size_t>& m1, const pair<JittedMethod, size_t>& m2) { return m1.first.getStart() < m2.first.getStart(); });
+   _methods.clear();
+   _methods.reserve(methods.size());
+   vector<size_t> positions; // file position of the methods kept in _methods
+   size_t numStale = 0;
+   for (auto& m : methods)
+      {
+      if (!_methods.empty() && m.first.getStart() < _methods.back().getEnd())
+         {
+         numStale++;
+         if (m.second < positions.back())
+            continue; // the method already in the index is newer
+         _methods.pop_back();
+         positions.pop_back();
+         }
+      _methods.push_back(m.first);
+      positions.push_back(m.second);
+      }
+   cout << "Found " << _methods.size() << " methods in the perf map (" << numStale << " overlapping stale entries dropped)" << endl;
+   }
+
+// Binary search for the method that contains the given address
+const JittedMethod *PerfMapIndex::findMethod(unsigned long long addr) const
+   {
+   auto it = upper_bound(_methods.begin(), _methods.end(), addr,
+                         [](unsigned long long a, const JittedMethod& m) { return a < m.getStart(); });
+   if (it == _methods.begin())
+      return nullptr;
+   --it;
+   return addr < it->getEnd() ? &*it : nullptr;
+   }
+
+vector<JittedMethod>::iterator PerfMapIndex::firstMethodEndingAfter(unsigned long long addr)
+   {
+   return upper_bound(_methods.begin(), _methods.end(), addr,
+                      [](unsigned long long a, const JittedMethod& m) { return a < m.getEnd(); });
+   }
+
+/**
+ * Compute the resident bytes of every method in the code cache.
+ * The pagemap is read once for each code cache segment and the methods of
+ * that segment are walked in address order, so the cost is linear in the
+ * number of pages plus the number of methods.
+*/
+void PerfMapIndex::computeResidentMethodBytes(const vector<J9Segment>& segments, PageMapReader *pageMapReader)
+   {
+   const unsigned long long pageSize = pageMapReader->getPageSize();
+   vector<bool> present;
+   for (auto& seg : segments)
+      {
+      if (seg.getSegmentType() != J9Segment::CODECACHE)
+         continue;
+      pageMapReader->readPresentPages(seg.getStart(), seg.getEnd(), present);
+      unsigned long long firstPageAddr = seg.getStart() & ~(pageSize - 1);
+      for (auto method = firstMethodEndingAfter(seg.getStart()); method != _methods.end() && method->getStart() < seg.getEnd(); ++method)
+         {
+         unsigned long long start = max(method->getStart(), seg.getStart());
+         unsigned long long end = min(method->getEnd(), seg.getEnd());
+         unsigned long long rss = pageMapReader->countResidentBytes(present, firstPageAddr, start, end);
+         method->setRSS(method->getRSS() + rss);
+         }
+      }
+   }
+
+struct JittedMethodRssLessThan
+   {
+   bool operator() (const JittedMethod& m1, const JittedMethod& m2) const { return m1.getRSS() < m2.getRSS(); }
+   };
+
+struct JittedMethodSizeLessThan
+   {
+   bool operator() (const JittedMethod& m1, const JittedMethod& m2) const { return m1.size() < m2.size(); }
+   };
+
+// Totals for a group of methods (same package or same optimization level)
+struct MethodGroupTotals
+   {
+   unsigned long long _numMethods = 0;
+   unsigned long long _size = 0;
+   unsigned long long _rss = 0;
+   };
+
+static void printMethodGroups(const unordered_map<string, MethodGroupTotals>& groups, const char *heading, size_t maxEntries, bool usePageMap)
+   {
+   vector<pair<string, MethodGroupTotals>> sortedGroups(groups.begin(), groups.end());
+   sort(sortedGroups.begin(), sortedGroups.end(),
+        [usePageMap](const pair<string, MethodGroupTotals>& g1, const pair<string, MethodGroupTotals>& g2)
+           { return usePageMap ? g1.second._rss > g2.second._rss : g1.second._size > g2.second._size; });
+   cout << "\n" << heading << "\n";
+   cout << setw(10) << "Methods" << setw(12) << "SizeKB" << setw(12) << "RSSKB" << "  Name\n";
+   for (size_t i = 0; i < sortedGroups.size() && i < maxEntries; i++)
+      {
+      const MethodGroupTotals& totals = sortedGroups[i].second;
+      cout << setw(10) << totals._numMethods << setw(12) << (totals._size >> 10) << setw(12) << (totals._rss >> 10) << "  " << sortedGroups[i].first << "\n";
+      }
+   if (sortedGroups.size() > maxEntries)
+      cout << "... " << sortedGroups.size() - maxEntries << " more\n";
+   }
+
+/**
+ * Report code cache usage per method, package and optimization level and show
+ * how concentrated the footprint is: whether a few large methods or a long
+ * tail of small ones account for most of the code cache.
+ * Without pagemap information, method sizes are used instead of RSS.
+*/
+void printCodeCacheByMethod(const PerfMapIndex& perfMap, const vector<J9Segment>& segments, bool usePageMap, size_t topK)
+   {
+   const vector<JittedMethod>& methods = perfMap.getMethods();
+   unsigned long long codeCacheSize = 0;
+   for (auto& seg : segments)
+      if (seg.getSegmentType() == J9Segment::CODECACHE)
+         codeCacheSize += seg.size();
+
+   unordered_map<string, MethodGroupTotals> byPackage, byOptLevel;
+   TopK<const JittedMethod*, PointeeLess<JittedMethodRssLessThan>> topByRss(topK);
+   TopK<const JittedMethod*, PointeeLess<JittedMethodSizeLessThan>> topBySize(topK);
+   vector<unsigned long long> methodValues; // RSS or size of each method, for the concentration analysis
+   methodValues.reserve(methods.size());
+   unsigned long long totalSize = 0, totalRss = 0;
+   for (auto& method : methods)
+      {
+      totalSize += method.size();
+      totalRss += method.getRSS();
+      MethodGroupTotals& package = byPackage[method.getPackageName()];
+      MethodGroupTotals& optLevel = byOptLevel[method.getOptLevel().empty() ? string("<none>") : method.getOptLevel()];
+      for (MethodGroupTotals *totals : { &package, &optLevel })
+         {
+         totals->_numMethods++;
+         totals->_size += method.size();
+         totals->_rss += method.getRSS();
+         }
+      if (usePageMap)
+         topByRss.processElement(&method);
+      else
+         topBySize.processElement(&method);
+      methodValues.push_back(usePageMap ? method.getRSS() : method.size());
+      }
+
+   cout << "\nCode cache by JIT compiled method:\n";
+   cout << "Code cache segments: " << (codeCacheSize >> 10) << " KB. Methods: " << methods.size() <<
+           " using " << (totalSize >> 10) << " KB";
+   if (usePageMap)
+      cout << " of which " << (totalRss >> 10) << " KB are resident";
+   cout << endl;
+
+   // How many methods account for half and for 90% of the footprint?
+   sort(methodValues.begin(), methodValues.end(), greater<unsigned long long>());
+   unsigned long long total = usePageMap ? totalRss : totalSize;
+   unsigned long long sum = 0, topSum = 0;
+   size_t methodsForHalf = 0, methodsFor90 = 0;
+   for (size_t i = 0; i < methodValues.size(); i++)
+      {
+      sum += methodValues[i];
+      if (i < topK)
+         topSum = sum;
+      if (methodsForHalf == 0 && sum * 2 >= total)
+         methodsForHalf = i + 1;
+      if (methodsFor90 == 0 && sum * 10 >= total * 9)
+         methodsFor90 = i + 1;
+      }
+   if (total > 0)
+      {
+      cout << "Top " << topK << " methods account for " << topSum * 100 / total << "% of the " << (usePageMap ? "RSS" : "size") <<
+              "; " << methodsForHalf << " methods account for 50% and " << methodsFor90 << " methods for 90%\n";
+      }
+
+   printMethodGroups(byOptLevel, "By optimization level:", byOptLevel.size(), usePageMap);
+   printMethodGroups(byPackage, "Top packages:", 20, usePageMap);
+   cout << "\nLargest methods by " << (usePageMap ? "RSS" : "size") << ":\n";
+   if (usePageMap)
+      topByRss.print();
+   else
+      topBySize.print();
+   }
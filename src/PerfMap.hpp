@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _PERFMAP_HPP__
+#define _PERFMAP_HPP__
+#include <string>
+#include <vector>
+#include "AddrRange.hpp"
+class PageMapReader;
+class J9Segment;
+
+// The code of a JIT compiled method as described by /tmp/perf-PID.map (-Xjit:perfTool)
+// 00007F1B2C00003C 44 java/lang/String.hashCode()I_warm
+class JittedMethod : public AddrRange
+   {
+   std::string _name;     // signature without the optimization level
+   std::string _optLevel; // empty if the perf map entry does not end with a known level
+   public:
+      JittedMethod(unsigned long long start, unsigned long long end, const std::string& name, const std::string& optLevel) :
+         AddrRange(start, end, 0), _name(name), _optLevel(optLevel) {}
+      const std::string& getName() const { return _name; }
+      const std::string& getOptLevel() const { return _optLevel; }
+      std::string getPackageName() const;
+      virtual void clear()
+         {
+         AddrRange::clear();
+         _name.clear();
+         _optLevel.clear();
+         }
+      virtual int rangeType() const override { return JITMETHOD_RANGE; }
+      virtual RangeCategories getRangeCategory() const override { return CODECACHE; }
+      virtual void format(BufferedWriter& out) const override;
+   }; // JittedMethod
+
+// Sorted, non-overlapping set of JIT compiled methods that supports address lookup
+class PerfMapIndex
+   {
+   std::vector<JittedMethod> _methods; // sorted by start address
+   public:
+      void readPerfMapFile(const char *perfMapFilename); // throws std::runtime_error if the file cannot be read
+      const std::vector<JittedMethod>& getMethods() const { return _methods; }
+      const JittedMethod *findMethod(unsigned long long addr) const;
+      std::vector<JittedMethod>::iterator firstMethodEndingAfter(unsigned long long addr);
+      void computeResidentMethodBytes(const std::vector<J9Segment>& segments, PageMapReader *pageMapReader);
+   }; // PerfMapIndex
+
+void printCodeCacheByMethod(const PerfMapIndex& perfMap, const std::vector<J9Segment>& segments, bool usePageMap, size_t topK);
+
+#endif // _PERFMAP_HPP__
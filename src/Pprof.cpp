@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Pprof.hpp"
+
+using namespace std;
+
+// Minimal protobuf encoding; see https://protobuf.dev/programming-guides/encoding/
+namespace
+   {
+   enum WireType { VARINT = 0, LENGTH_DELIMITED = 2 };
+
+   void putVarint(string& buf, unsigned long long value)
+      {
+      while (value >= 0x80)
+         {
+         buf.push_back((char)((value & 0x7f) | 0x80));
+         value >>= 7;
+         }
+      buf.push_back((char)value);
+      }
+
+   void putKey(string& buf, unsigned field, WireType wireType)
+      {
+      putVarint(buf, (field << 3) | wireType);
+      }
+
+   void putUint(string& buf, unsigned field, unsigned long long value)
+      {
+      if (value == 0) // default value need not be encoded
+         return;
+      putKey(buf, field, VARINT);
+      putVarint(buf, value);
+      }
+
+   void putBytes(string& buf, unsigned field, const string& bytes)
+      {
+      putKey(buf, field, LENGTH_DELIMITED);
+      putVarint(buf, bytes.size());
+      buf.append(bytes);
+      }
+
+   void putPackedUints(string& buf, unsigned field, const vector<unsigned long long>& values)
+      {
+      string packed;
+      for (auto value : values)
+         putVarint(packed, value);
+      putBytes(buf, field, packed);
+      }
+   } // anonymous namespace
+
+PprofBuilder::PprofBuilder()
+   {
+   internString(""); // required by the format
+   _virtualId = internString("virtual");
+   _rssId = internString("rss");
+   _bytesId = internString("bytes");
+   }
+
+unsigned long long PprofBuilder::internString(const string& str)
+   {
+   auto inserted = _stringIds.emplace(str, _strings.size());
+   if (inserted.second)
+      _strings.push_back(str);
+   return inserted.first->second;
+   }
+
+unsigned long long PprofBuilder::internLocation(const string& name, const string& file, unsigned line)
+   {
+   // The same name may be an interior frame without a file and a leaf with one,
+   // or two leaves at different lines; each of them is a location of its own
+   _locationKey.assign(name);
+   _locationKey.push_back('\0');
+   _locationKey.append(file);
+   _locationKey.push_back('\0');
+   _locationKey.append(to_string(line));
+   auto inserted = _locationIds.emplace(_locationKey, _locations.size() + 1); // ids start at 1
+   if (inserted.second)
+      _locations.push_back(Location{internString(name), file.empty() ? 0 : internString(file), line});
+   return inserted.first->second;
+   }
+
+void PprofBuilder::addSample(const vector<string>& frames, const string& file, unsigned line,
+                             unsigned long long virtualBytes, unsigned long long rssBytes)
+   {
+   // pprof wants the leaf first
+   _stack.clear();
+   _stackKey.clear();
+   for (size_t i = frames.size(); i-- > 0; )
+      {
+      bool isLeaf = i == frames.size() - 1;
+      unsigned long long id = internLocation(frames[i], isLeaf ? file : string(), isLeaf ? line : 0);
+      _stack.push_back(id);
+      putVarint(_stackKey, id);
+      }
+   auto inserted = _sampleIndex.emplace(_stackKey, _samples.size());
+   if (inserted.second)
+      _samples.push_back(Sample{_stack, 0, 0});
+   Sample& sample = _samples[inserted.first->second];
+   sample._virtualBytes += virtualBytes;
+   sample._rssBytes += rssBytes;
+   }
+
+void PprofBuilder::write(ostream& os) const
+   {
+   // message Profile
+   //    repeated ValueType sample_type = 1; repeated Sample sample = 2; repeated Location location = 4;
+   //    repeated Function function = 5; repeated string string_table = 6; int64 default_sample_type = 14;
+   string profile;
+   for (auto typeId : { _virtualId, _rssId })
+      {
+      string valueType; // message ValueType { int64 type = 1; int64 unit = 2; }
+      putUint(valueType, 1, typeId);
+      putUint(valueType, 2, _bytesId);
+      putBytes(profile, 1, valueType);
+      }
+   os.write(profile.data(), profile.size());
+
+   string msg;
+   for (const auto& sample : _samples)
+      {
+      // message Sample { repeated uint64 location_id = 1; repeated int64 value = 2; }
+      msg.clear();
+      putPackedUints(msg, 1, sample._locationIds);
+      putPackedUints(msg, 2, vector<unsigned long long>{ sample._virtualBytes, sample._rssBytes });
+      profile.clear();
+      putBytes(profile, 2, msg);
+      os.write(profile.data(), profile.size());
+      }
+   for (size_t i = 0; i < _locations.size(); i++)
+      {
+      // message Line { uint64 function_id = 1; int64 line = 2; }
+      string lineMsg;
+      putUint(lineMsg, 1, i + 1);
+      putUint(lineMsg, 2, _locations[i]._line);
+      // message Location { uint64 id = 1; repeated Line line = 4; }
+      msg.clear();
+      putUint(msg, 1, i + 1);
+      putBytes(msg, 4, lineMsg);
+      profile.clear();
+      putBytes(profile, 4, msg);
+      // message Function { uint64 id = 1; int64 name = 2; int64 system_name = 3; int64 filename = 4; }
+      msg.clear();
+      putUint(msg, 1, i + 1);
+      putUint(msg, 2, _locations[i]._nameId);
+      putUint(msg, 3, _locations[i]._nameId);
+      putUint(msg, 4, _locations[i]._fileId);
+      putBytes(profile, 5, msg);
+      os.write(profile.data(), profile.size());
+      }
+   for (const auto& str : _strings)
+      {
+      profile.clear();
+      putBytes(profile, 6, str);
+      os.write(profile.data(), profile.size());
+      }
+   profile.clear();
+   putUint(profile, 14, _rssId);
+   os.write(profile.data(), profile.size());
+   }
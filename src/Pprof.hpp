@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _PPROF_HPP__
+#define _PPROF_HPP__
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include "Attribution.hpp"
+
+// Builds a profile in the pprof format (profile.proto) where each sample is a piece of
+// memory with two values, virtual bytes and RSS bytes, and its "stack" is the attribution
+// hierarchy (see buildAttributionFrames). Strings, functions, locations and stacks are
+// interned in hashtables as samples are added, so the cost is linear in the input
+class PprofBuilder
+   {
+   std::vector<std::string> _strings; // string table; index 0 must be ""
+   std::unordered_map<std::string, unsigned long long> _stringIds;
+   struct Location
+      {
+      unsigned long long _nameId; // function name
+      unsigned long long _fileId;
+      unsigned long long _line;
+      };
+   std::vector<Location> _locations; // location i+1 has function i+1
+   std::unordered_map<std::string, unsigned long long> _locationIds; // key: name, file and line -> location id
+   struct Sample
+      {
+      std::vector<unsigned long long> _locationIds; // leaf first
+      unsigned long long _virtualBytes;
+      unsigned long long _rssBytes;
+      };
+   std::vector<Sample> _samples;
+   std::unordered_map<std::string, size_t> _sampleIndex; // key: location ids of the stack
+   std::vector<unsigned long long> _stack; // scratch space for addSample
+   std::string _stackKey;                  // scratch space for addSample
+   std::string _locationKey;               // scratch space for internLocation
+   unsigned long long _virtualId, _rssId, _bytesId; // names of the sample types
+
+   unsigned long long internString(const std::string& str);
+   unsigned long long internLocation(const std::string& name, const std::string& file, unsigned line);
+   public:
+      PprofBuilder();
+      // frames go from the root (category) to the leaf. For call-sites, file and line
+      // describe the leaf frame; otherwise file is empty
+      void addSample(const std::vector<std::string>& frames, const std::string& file, unsigned line,
+                     unsigned long long virtualBytes, unsigned long long rssBytes);
+      void write(std::ostream& os) const; // serialized, uncompressed profile
+   }; // PprofBuilder
+
+template <typename MAPENTRY>
+void writePprofResults(std::ostream& os, const std::vector<MAPENTRY>& maps, bool usePageMap)
+   {
+   PprofBuilder builder;
+   std::vector<std::string> frames;
+   const std::string noFile;
+   for (const auto& crtMap : maps)
+      {
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            buildAttributionFrames(crtMap, category, range, frames);
+            if (range && range->rangeType() == AddrRange::CALLSITE_RANGE)
+               {
+               const CallSite *callSite = static_cast<const CallSite*>(range);
+               builder.addSample(frames, callSite->getFilename(), callSite->getLineNo(), virtualBytes, rssBytes);
+               }
+            else
+               {
+               builder.addSample(frames, noFile, 0, virtualBytes, rssBytes);
+               }
+            });
+      }
+   builder.write(os);
+   }
+
+#endif // _PPROF_HPP__
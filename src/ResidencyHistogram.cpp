@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "ResidencyHistogram.hpp"
+
+using namespace std;
+
+static const char * const sizeBucketNames[ResidencyHistograms::NUM_SIZE_BUCKETS] = { "<64KB", "<1MB", "<16MB", "<256MB", "<4GB", ">=4GB" };
+static const char * const densityBucketNames[ResidencyHistograms::NUM_DENSITY_BUCKETS] = { "Empty", "<25%", "<50%", "<75%", "<100%", "Full" };
+static const char densityBucketChars[ResidencyHistograms::NUM_DENSITY_BUCKETS] = { ' ', '.', ':', '+', '*', '#' };
+
+int ResidencyHistograms::sizeBucket(unsigned long long bytes)
+   {
+   // Each bucket is 16 times larger than the previous one
+   int bucket = 0;
+   for (unsigned long long limit = 64 << 10; bucket < NUM_SIZE_BUCKETS - 1 && bytes >= limit; limit <<= 4)
+      bucket++;
+   return bucket;
+   }
+
+int ResidencyHistograms::densityBucket(unsigned long long residentBytes, unsigned long long bytes)
+   {
+   if (residentBytes == 0)
+      return 0;
+   if (residentBytes >= bytes)
+      return NUM_DENSITY_BUCKETS - 1;
+   return 1 + (int)(4 * residentBytes / bytes);
+   }
+
+void ResidencyHistograms::addPiece(AddrRange::RangeCategories category, unsigned long long virtualBytes, unsigned long long rssBytes)
+   {
+   _pieces[category][sizeBucket(virtualBytes)]++;
+   _virtualBytes[category] += virtualBytes;
+   _rssBytes[category] += rssBytes;
+   }
+
+void ResidencyHistograms::addChunk(AddrRange::RangeCategories category, unsigned long long chunkBytes, unsigned long long residentBytes)
+   {
+   _chunks[category][densityBucket(residentBytes, chunkBytes)]++;
+   }
+
+void ResidencyHistograms::print(ostream& os) const
+   {
+   ios_base::fmtflags flags = os.flags();
+   streamsize precision = os.precision();
+   os << "\nPieces of maps in each category by virtual size:\n";
+   os << dec << setfill(' ') << setw(11) << "Category";
+   for (int b = 0; b < NUM_SIZE_BUCKETS; b++)
+      os << setw(9) << sizeBucketNames[b];
+   os << setw(14) << "Virtual(KB)" << setw(10) << "RSS(KB)" << setw(9) << "Density" << endl;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      if (_virtualBytes[i] == 0)
+         continue;
+      os << setw(11) << AddrRange::RangeCategoryNames[i];
+      for (int b = 0; b < NUM_SIZE_BUCKETS; b++)
+         os << setw(9) << _pieces[i][b];
+      os << setw(14) << (_virtualBytes[i] >> 10) << setw(10) << (_rssBytes[i] >> 10)
+         << setw(8) << fixed << setprecision(1) << (100.0 * _rssBytes[i] / _virtualBytes[i]) << "%" << endl;
+      }
+
+   os << "\nChunks of " << (_chunkBytes >> 10) << " KB in each category by resident fraction"
+      << (_fromPageMap ? " (from the pagemap):\n" : " (estimated from the RSS of the maps):\n");
+   os << setw(11) << "Category";
+   for (int b = 0; b < NUM_DENSITY_BUCKETS; b++)
+      os << setw(9) << densityBucketNames[b];
+   os << endl;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      if (_virtualBytes[i] == 0)
+         continue;
+      os << setw(11) << AddrRange::RangeCategoryNames[i];
+      for (int b = 0; b < NUM_DENSITY_BUCKETS; b++)
+         os << setw(9) << _chunks[i][b];
+      os << endl;
+      }
+   os.flags(flags);
+   os.precision(precision);
+   }
+
+void printResidencyStrip(ostream& os, const vector<bool>& present, unsigned long long presentStartAddr,
+                         unsigned long long start, unsigned long long end, unsigned long long chunkBytes, const PageMapReader& pageMapReader)
+   {
+   const int CHUNKS_PER_LINE = 64;
+   int chunksOnLine = 0;
+   forEachChunk(start, end, chunkBytes, [&](unsigned long long chunkStart, unsigned long long chunkEnd)
+      {
+      if (chunksOnLine == 0)
+         os << "   " << hex << setfill('0') << setw(16) << chunkStart << setfill(' ') << dec << " |";
+      unsigned long long residentBytes = pageMapReader.countResidentBytes(present, presentStartAddr, chunkStart, chunkEnd);
+      os << densityBucketChars[ResidencyHistograms::densityBucket(residentBytes, chunkEnd - chunkStart)];
+      if (++chunksOnLine == CHUNKS_PER_LINE)
+         {
+         os << "|\n";
+         chunksOnLine = 0;
+         }
+      });
+   if (chunksOnLine != 0)
+      os << "|\n";
+   }
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _RESIDENCYHISTOGRAM_HPP__
+#define _RESIDENCYHISTOGRAM_HPP__
+#include <vector>
+#include <iostream>
+#include "Attribution.hpp"
+#include "PageMapSupport.hpp"
+
+// Histograms that tell a sparse 1 GB reservation from a fully touched one.
+// For each category there are two of them:
+//  - the number of pieces of maps charged to the category (see forEachMapAttribution)
+//    by virtual size
+//  - the number of fixed size chunks of those pieces by the fraction of their bytes
+//    that is resident. Chunks are aligned to multiples of the granularity, so the pieces
+//    at the ends of a map may produce smaller chunks.
+// With the pagemap the resident fraction of each chunk is exact; otherwise all the chunks
+// of a piece get the average density of the piece (its RSS divided by its virtual size)
+class ResidencyHistograms
+   {
+   public:
+   enum { NUM_SIZE_BUCKETS = 6 };    // <64KB, <1MB, <16MB, <256MB, <4GB, >=4GB
+   enum { NUM_DENSITY_BUCKETS = 6 }; // empty, <25%, <50%, <75%, <100%, full
+   private:
+   unsigned long long _chunkBytes;
+   bool _fromPageMap;
+   unsigned long long _pieces[AddrRange::NUM_CATEGORIES][NUM_SIZE_BUCKETS] = {};
+   unsigned long long _chunks[AddrRange::NUM_CATEGORIES][NUM_DENSITY_BUCKETS] = {};
+   unsigned long long _virtualBytes[AddrRange::NUM_CATEGORIES] = {};
+   unsigned long long _rssBytes[AddrRange::NUM_CATEGORIES] = {};
+   public:
+      ResidencyHistograms(unsigned long long chunkBytes, bool fromPageMap) : _chunkBytes(chunkBytes), _fromPageMap(fromPageMap) {}
+      unsigned long long getChunkBytes() const { return _chunkBytes; }
+      void addPiece(AddrRange::RangeCategories category, unsigned long long virtualBytes, unsigned long long rssBytes);
+      void addChunk(AddrRange::RangeCategories category, unsigned long long chunkBytes, unsigned long long residentBytes);
+      void print(std::ostream& os) const;
+      static int sizeBucket(unsigned long long bytes);
+      static int densityBucket(unsigned long long residentBytes, unsigned long long bytes);
+   }; // ResidencyHistograms
+
+// Call visit(chunkStart, chunkEnd) for the pieces of [start, end) delimited by multiples of chunkBytes
+template <typename VISITOR>
+void forEachChunk(unsigned long long start, unsigned long long end, unsigned long long chunkBytes, VISITOR&& visit)
+   {
+   while (start < end)
+      {
+      unsigned long long chunkEnd = (start / chunkBytes + 1) * chunkBytes;
+      if (chunkEnd > end || chunkEnd < start) // the latter for the chunk at the top of the address space
+         chunkEnd = end;
+      visit(start, chunkEnd);
+      start = chunkEnd;
+      }
+   }
+
+// Call visit(start, end) for the address intervals of crtMap that make up a piece visited by
+// forEachMapAttribution: the part of the map inside 'range', the whole map, or the parts
+// of the map not covered by any range
+template <typename MAPENTRY, typename VISITOR>
+void forEachPieceInterval(const MAPENTRY& crtMap, const AddrRange *range, unsigned long long virtualBytes, VISITOR&& visit)
+   {
+   if (range)
+      {
+      unsigned long long start = std::max(range->getStart(), crtMap.getStart());
+      unsigned long long end = std::min(range->getEnd(), crtMap.getEnd());
+      if (start < end)
+         visit(start, end);
+      }
+   else if (virtualBytes == crtMap.size() || crtMap._coveringRanges.empty())
+      {
+      visit(crtMap.getStart(), crtMap.getEnd());
+      }
+   else
+      {
+      // The covering ranges are sorted by start address, but they may overlap each other
+      unsigned long long cursor = crtMap.getStart();
+      for (auto seg : crtMap._coveringRanges)
+         {
+         if (seg->getStart() > cursor)
+            visit(cursor, std::min(seg->getStart(), crtMap.getEnd()));
+         cursor = std::max(cursor, seg->getEnd());
+         }
+      if (cursor < crtMap.getEnd())
+         visit(cursor, crtMap.getEnd());
+      }
+   }
+
+template <typename MAPENTRY>
+void computeResidencyHistograms(const std::vector<MAPENTRY>& maps, PageMapReader *pageMapReader, ResidencyHistograms& histograms)
+   {
+   const unsigned long long chunkBytes = histograms.getChunkBytes();
+   for (const auto& crtMap : maps)
+      {
+      forEachMapAttribution(crtMap, pageMapReader != nullptr,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            if (virtualBytes == 0)
+               return;
+            histograms.addPiece(category, virtualBytes, rssBytes);
+            forEachPieceInterval(crtMap, range, virtualBytes, [&](unsigned long long start, unsigned long long end)
+               {
+               forEachChunk(start, end, chunkBytes, [&](unsigned long long chunkStart, unsigned long long chunkEnd)
+                  {
+                  unsigned long long residentBytes;
+                  if (pageMapReader)
+                     {
+                     // The presence bits of the whole VMA are read once and shared by all its chunks
+                     const std::vector<bool>& present = pageMapReader->getPresentPagesForVma(crtMap.getStart(), crtMap.getEnd());
+                     residentBytes = pageMapReader->countResidentBytes(present, crtMap.getStart(), chunkStart, chunkEnd);
+                     }
+                  else
+                     {
+                     residentBytes = (unsigned long long)((long double)rssBytes * (chunkEnd - chunkStart) / virtualBytes);
+                     }
+                  histograms.addChunk(category, chunkEnd - chunkStart, residentBytes);
+                  });
+               });
+            });
+      }
+   }
+
+template <typename MAPENTRY>
+void printResidencyHistograms(const std::vector<MAPENTRY>& maps, PageMapReader *pageMapReader, unsigned long long chunkBytes)
+   {
+   ResidencyHistograms histograms(chunkBytes, pageMapReader != nullptr);
+   computeResidencyHistograms(maps, pageMapReader, histograms);
+   histograms.print(std::cout);
+   }
+
+// One character per chunk of the map that shows how much of it is resident
+void printResidencyStrip(std::ostream& os, const std::vector<bool>& present, unsigned long long presentStartAddr,
+                         unsigned long long start, unsigned long long end, unsigned long long chunkBytes, const PageMapReader& pageMapReader);
+
+// Where the resident pages are inside each map that spans at least two chunks
+template <typename MAPENTRY>
+void printResidencyStrips(const std::vector<MAPENTRY>& maps, PageMapReader *pageMapReader, unsigned long long chunkBytes)
+   {
+   std::cout << "\nResidency of the maps in chunks of " << std::dec << (chunkBytes >> 10)
+             << " KB (' ' empty, '.' <25%, ':' <50%, '+' <75%, '*' <100%, '#' full):\n";
+   for (const auto& crtMap : maps)
+      {
+      if (crtMap.size() < 2 * chunkBytes)
+         continue;
+      std::cout << crtMap << std::endl;
+      const std::vector<bool>& present = pageMapReader->getPresentPagesForVma(crtMap.getStart(), crtMap.getEnd());
+      printResidencyStrip(std::cout, present, crtMap.getStart(), crtMap.getStart(), crtMap.getEnd(), chunkBytes, *pageMapReader);
+      }
+   }
+
+#endif // _RESIDENCYHISTOGRAM_HPP__
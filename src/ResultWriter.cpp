@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include "ResultWriter.hpp"
+#include "Javacore.hpp"
+#include "CallSites.hpp"
+#include "PerfMap.hpp"
+
+using namespace std;
+
+OutputFormat parseOutputFormat(const char *formatName)
+   {
+   if (strcmp(formatName, "text") == 0)
+      return TEXT_OUTPUT;
+   if (strcmp(formatName, "json") == 0)
+      return JSON_OUTPUT;
+   if (strcmp(formatName, "csv") == 0)
+      return CSV_OUTPUT;
+   if (strcmp(formatName, "pprof") == 0)
+      return PPROF_OUTPUT;
+   if (strcmp(formatName, "folded") == 0)
+      return FOLDED_OUTPUT;
+   if (strcmp(formatName, "folded-virtual") == 0)
+      return FOLDED_VIRTUAL_OUTPUT;
+   if (strcmp(formatName, "openmetrics") == 0)
+      return OPENMETRICS_OUTPUT;
+   cerr << "Unknown output format " << formatName << "; expected text, json, csv, pprof, folded, folded-virtual or openmetrics\n";
+   exit(-1);
+   }
+
+//============================== JsonWriter ==================================
+void JsonWriter::separator()
+   {
+   if (_afterKey)
+      {
+      _afterKey = false;
+      return;
+      }
+   if (!_firstInScope.empty())
+      {
+      if (!_firstInScope.back())
+         _os << ',';
+      _firstInScope.back() = false;
+      _os << '\n' << string(_firstInScope.size(), ' ');
+      }
+   }
+
+void JsonWriter::writeString(const char *str, size_t len)
+   {
+   static const char hexDigits[] = "0123456789abcdef";
+   _os << '"';
+   size_t runStart = 0; // write unescaped characters in runs
+   for (size_t i = 0; i < len; i++)
+      {
+      unsigned char c = (unsigned char)str[i];
+      if (c >= 0x20 && c != '"' && c != '\\')
+         continue;
+      _os.write(str + runStart, i - runStart);
+      runStart = i + 1;
+      switch (c)
+         {
+         case '"':  _os << "\\\""; break;
+         case '\\': _os << "\\\\"; break;
+         case '\n': _os << "\\n"; break;
+         case '\r': _os << "\\r"; break;
+         case '\t': _os << "\\t"; break;
+         default:
+            {
+            char escaped[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xf] };
+            _os.write(escaped, sizeof(escaped));
+            }
+         }
+      }
+   _os.write(str + runStart, len - runStart);
+   _os << '"';
+   }
+
+void JsonWriter::beginObject()
+   {
+   separator();
+   _os << '{';
+   _firstInScope.push_back(true);
+   }
+
+void JsonWriter::endObject()
+   {
+   bool empty = _firstInScope.back();
+   _firstInScope.pop_back();
+   if (!empty)
+      _os << '\n' << string(_firstInScope.size(), ' ');
+   _os << '}';
+   }
+
+void JsonWriter::beginArray()
+   {
+   separator();
+   _os << '[';
+   _firstInScope.push_back(true);
+   }
+
+void JsonWriter::endArray()
+   {
+   bool empty = _firstInScope.back();
+   _firstInScope.pop_back();
+   if (!empty)
+      _os << '\n' << string(_firstInScope.size(), ' ');
+   _os << ']';
+   }
+
+void JsonWriter::key(const char *name)
+   {
+   separator();
+   writeString(name, strlen(name));
+   _os << ':';
+   _afterKey = true;
+   }
+
+void JsonWriter::value(const char *str)
+   {
+   separator();
+   writeString(str, strlen(str));
+   }
+
+void JsonWriter::value(unsigned long long number)
+   {
+   separator();
+   _os << dec << number;
+   }
+
+void JsonWriter::hexValue(unsigned long long number)
+   {
+   separator();
+   _os << "\"0x" << hex << number << dec << '"';
+   }
+
+//============================== CsvWriter ===================================
+void CsvWriter::separator()
+   {
+   if (!_firstField)
+      _os << ',';
+   _firstField = false;
+   }
+
+void CsvWriter::field(const string& str)
+   {
+   separator();
+   if (str.find_first_of(",\"\r\n") == string::npos)
+      {
+      _os << str;
+      return;
+      }
+   // Quote the field and double the embedded quotes
+   _os << '"';
+   for (char c : str)
+      {
+      if (c == '"')
+         _os << '"';
+      _os << c;
+      }
+   _os << '"';
+   }
+
+void CsvWriter::field(unsigned long long number)
+   {
+   separator();
+   _os << dec << number;
+   }
+
+void CsvWriter::hexField(unsigned long long number)
+   {
+   separator();
+   _os << "0x" << hex << number << dec;
+   }
+
+//=========================== Annotation naming ==============================
+const char *rangeKindName(const AddrRange& range)
+   {
+   switch (range.rangeType())
+      {
+      case AddrRange::J9SEGMENT_RANGE:   return "segment";
+      case AddrRange::CALLSITE_RANGE:    return "callsite";
+      case AddrRange::THREADSTACK_RANGE: return "thread";
+      case AddrRange::JITMETHOD_RANGE:   return "jitmethod";
+      default:                           return "range";
+      }
+   }
+
+string rangeDescription(const AddrRange& range)
+   {
+   switch (range.rangeType())
+      {
+      case AddrRange::J9SEGMENT_RANGE:
+         return static_cast<const J9Segment&>(range).getTypeName();
+      case AddrRange::CALLSITE_RANGE:
+         {
+         const CallSite& callSite = static_cast<const CallSite&>(range);
+         return callSite.getFilename() + ":" + to_string(callSite.getLineNo());
+         }
+      case AddrRange::THREADSTACK_RANGE:
+         return static_cast<const ThreadStack&>(range).getThreadName();
+      case AddrRange::JITMETHOD_RANGE:
+         return static_cast<const JittedMethod&>(range).getName();
+      default:
+         return string();
+      }
+   }
+
+//============================= OpenMetrics ==================================
+namespace
+   {
+   void appendLabel(string& labels, const char *name, const string& value)
+      {
+      if (!labels.empty())
+         labels.push_back(',');
+      labels.append(name);
+      labels.append("=\"");
+      for (char c : value)
+         {
+         switch (c)
+            {
+            case '\\': labels.append("\\\\"); break;
+            case '"':  labels.append("\\\""); break;
+            case '\n': labels.append("\\n"); break;
+            default:   labels.push_back(c);
+            }
+         }
+      labels.push_back('"');
+      }
+   } // anonymous namespace
+
+void OpenMetricsWriter::addCommonLabel(const char *name, const string& value)
+   {
+   appendLabel(_commonLabels, name, value);
+   }
+
+void OpenMetricsWriter::family(const char *name, const char *help)
+   {
+   _os << "# TYPE " << name << " gauge\n";
+   _os << "# UNIT " << name << " bytes\n";
+   _os << "# HELP " << name << ' ' << help << '\n';
+   }
+
+void OpenMetricsWriter::sample(const char *name, const char *labelName, const string& labelValue, unsigned long long value)
+   {
+   string labels = _commonLabels;
+   appendLabel(labels, labelName, labelValue);
+   _os << name << '{' << labels << "} " << dec << value << '\n';
+   }
+
+void OpenMetricsWriter::sample(const char *name, unsigned long long value)
+   {
+   _os << name << '{' << _commonLabels << "} " << dec << value << '\n';
+   }
@@ -0,0 +1,372 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _RESULTWRITER_HPP__
+#define _RESULTWRITER_HPP__
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include "AddrRange.hpp"
+#include "Attribution.hpp"
+#include "Javacore.hpp"
+
+enum OutputFormat
+   {
+   TEXT_OUTPUT = 0, // human readable report on cout
+   JSON_OUTPUT,
+   CSV_OUTPUT,
+   PPROF_OUTPUT,  // profile.proto, for the pprof tool
+   FOLDED_OUTPUT, // folded stacks with RSS bytes, for flame graphs
+   FOLDED_VIRTUAL_OUTPUT, // folded stacks with virtual bytes
+   OPENMETRICS_OUTPUT, // gauges for the Prometheus textfile collector
+   };
+OutputFormat parseOutputFormat(const char *formatName);
+
+// Writes JSON as it goes. Only the nesting state is kept, so the size of the
+// result is limited by the output stream, not by memory
+class JsonWriter
+   {
+   std::ostream& _os;
+   std::vector<bool> _firstInScope; // one entry for each open object/array
+   bool _afterKey = false;          // a value is expected next
+   void separator();
+   void writeString(const char *str, size_t len);
+   public:
+      JsonWriter(std::ostream& os) : _os(os) {}
+      void beginObject();
+      void endObject();
+      void beginArray();
+      void endArray();
+      void key(const char *name);
+      void value(const std::string& str) { separator(); writeString(str.data(), str.size()); }
+      void value(const char *str);
+      void value(unsigned long long number);
+      void hexValue(unsigned long long number); // written as a "0x..." string
+      template <typename T>
+      void member(const char *name, const T& val) { key(name); value(val); }
+      void hexMember(const char *name, unsigned long long number) { key(name); hexValue(number); }
+   }; // JsonWriter
+
+// Writes RFC 4180 CSV one field at a time
+class CsvWriter
+   {
+   std::ostream& _os;
+   bool _firstField = true;
+   void separator();
+   public:
+      CsvWriter(std::ostream& os) : _os(os) {}
+      void field(const std::string& str);
+      void field(const char *str) { field(std::string(str)); }
+      void field(unsigned long long number);
+      void hexField(unsigned long long number);
+      void emptyField() { separator(); }
+      void endRecord() { _os << '\n'; _firstField = true; }
+   }; // CsvWriter
+
+// Short kind ("segment", "callsite", "thread", "jitmethod", "range") and name of an annotation
+const char *rangeKindName(const AddrRange& range);
+std::string rangeDescription(const AddrRange& range);
+
+template <typename MAPENTRY>
+void writeMapJson(JsonWriter& json, const MAPENTRY& map, bool withAnnotations)
+   {
+   json.beginObject();
+   json.hexMember("start", map.getStart());
+   json.hexMember("end", map.getEnd());
+   json.member("virtual_bytes", map.size());
+   json.member("rss_bytes", map.getResidentSizeKB() << 10);
+   json.member("protection", map.getProtectionString());
+   json.member("details", map.getDetailsString());
+   if (withAnnotations)
+      {
+      const std::list<const AddrRange*> *annotations[2] = { &map._coveringRanges, &map._overlappingRanges };
+      const char *annotationNames[2] = { "covering", "overlapping" };
+      for (int i = 0; i < 2; i++)
+         {
+         json.key(annotationNames[i]);
+         json.beginArray();
+         for (auto range : *annotations[i])
+            {
+            json.beginObject();
+            json.member("kind", rangeKindName(*range));
+            json.member("category", AddrRange::RangeCategoryNames[range->getRangeCategory()]);
+            json.member("name", rangeDescription(*range));
+            json.hexMember("start", range->getStart());
+            json.hexMember("end", range->getEnd());
+            json.member("rss_bytes", range->getRSS());
+            json.endObject();
+            }
+         json.endArray();
+         }
+      }
+   json.endObject();
+   }
+
+// Serialize the footprint summary and, if withMaps is set, every map with its annotations
+template <typename MAPENTRY>
+void writeJsonResults(std::ostream& os, const FootprintSummary<MAPENTRY>& summary, const std::vector<MAPENTRY>& maps, bool withMaps)
+   {
+   JsonWriter json(os);
+   json.beginObject();
+
+   json.key("totals");
+   json.beginObject();
+   json.member("virtual_bytes", summary._totalVirtSize);
+   json.member("rss_bytes", summary._totalRssSize);
+   json.endObject();
+
+   json.key("categories");
+   json.beginArray();
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      json.beginObject();
+      json.member("name", AddrRange::RangeCategoryNames[i]);
+      json.member("virtual_bytes", summary._virtualSize[i]);
+      json.member("rss_bytes", summary._rssSize[i]);
+      json.endObject();
+      }
+   json.endArray();
+
+   json.key("dlls");
+   json.beginArray();
+   for (const auto& dll : summary._dllRss)
+      {
+      json.beginObject();
+      json.member("name", dll.first);
+      json.member("rss_bytes", dll.second);
+      json.endObject();
+      }
+   json.endArray();
+
+   json.key("top_dll_maps");
+   json.beginArray();
+   for (const MAPENTRY *map : summary._topDlls.getSortedElements())
+      writeMapJson(json, *map, false);
+   json.endArray();
+
+   json.key("top_not_covered_maps");
+   json.beginArray();
+   for (const MAPENTRY *map : summary._topNotCovered.getSortedElements())
+      writeMapJson(json, *map, false);
+   json.endArray();
+
+   if (withMaps)
+      {
+      json.key("maps");
+      json.beginArray();
+      for (const auto& map : maps)
+         writeMapJson(json, map, true);
+      json.endArray();
+      }
+   json.endObject();
+   os << '\n';
+   }
+
+template <typename MAPENTRY>
+void writeMapCsv(CsvWriter& csv, const char *record, const MAPENTRY& map)
+   {
+   csv.field(record);
+   csv.field("map");
+   csv.emptyField(); // category
+   csv.field(map.getDetailsString());
+   csv.hexField(map.getStart());
+   csv.hexField(map.getEnd());
+   csv.field(map.size());
+   csv.field(map.getResidentSizeKB() << 10);
+   csv.field(map.getProtectionString());
+   csv.emptyField(); // map_start
+   csv.endRecord();
+   }
+
+// One CSV table for all records; the 'record' column tells them apart.
+// The 'attribution' records (name is the folded stack) can be read back by the diff mode
+template <typename MAPENTRY>
+void writeCsvResults(std::ostream& os, const FootprintSummary<MAPENTRY>& summary, const std::vector<MAPENTRY>& maps, bool usePageMap, bool withMaps)
+   {
+   os << "record,kind,category,name,start,end,virtual_bytes,rss_bytes,protection,map_start\n";
+   CsvWriter csv(os);
+
+   csv.field("total"); csv.emptyField(); csv.emptyField(); csv.emptyField(); csv.emptyField(); csv.emptyField();
+   csv.field(summary._totalVirtSize); csv.field(summary._totalRssSize); csv.emptyField(); csv.emptyField();
+   csv.endRecord();
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      csv.field("category"); csv.emptyField(); csv.field(AddrRange::RangeCategoryNames[i]); csv.emptyField(); csv.emptyField(); csv.emptyField();
+      csv.field(summary._virtualSize[i]); csv.field(summary._rssSize[i]); csv.emptyField(); csv.emptyField();
+      csv.endRecord();
+      }
+   for (const auto& dll : summary._dllRss)
+      {
+      csv.field("dll"); csv.emptyField(); csv.field(AddrRange::RangeCategoryNames[AddrRange::DLL]); csv.field(dll.first); csv.emptyField(); csv.emptyField();
+      csv.emptyField(); csv.field(dll.second); csv.emptyField(); csv.emptyField();
+      csv.endRecord();
+      }
+   std::vector<AttributionRecord> records;
+   collectAttributionRecords(maps, usePageMap, records);
+   for (const auto& record : records)
+      {
+      csv.field("attribution"); csv.emptyField(); csv.field(record._stack.substr(0, record._stack.find(';'))); csv.field(record._stack);
+      csv.emptyField(); csv.emptyField(); csv.field(record._virtualBytes); csv.field(record._rssBytes); csv.emptyField(); csv.emptyField();
+      csv.endRecord();
+      }
+   for (const MAPENTRY *map : summary._topDlls.getSortedElements())
+      writeMapCsv(csv, "top_dll", *map);
+   for (const MAPENTRY *map : summary._topNotCovered.getSortedElements())
+      writeMapCsv(csv, "top_not_covered", *map);
+
+   if (withMaps)
+      {
+      for (const auto& map : maps)
+         {
+         writeMapCsv(csv, "map", map);
+         const std::list<const AddrRange*> *annotations[2] = { &map._coveringRanges, &map._overlappingRanges };
+         const char *annotationNames[2] = { "covering", "overlapping" };
+         for (int i = 0; i < 2; i++)
+            {
+            for (auto range : *annotations[i])
+               {
+               csv.field(annotationNames[i]);
+               csv.field(rangeKindName(*range));
+               csv.field(AddrRange::RangeCategoryNames[range->getRangeCategory()]);
+               csv.field(rangeDescription(*range));
+               csv.hexField(range->getStart());
+               csv.hexField(range->getEnd());
+               csv.field(range->size());
+               csv.field(range->getRSS());
+               csv.emptyField(); // protection
+               csv.hexField(map.getStart());
+               csv.endRecord();
+               }
+            }
+         }
+      }
+   }
+
+// One line for each distinct attribution stack (see collectAttributionRecords):
+//    category;segment-type-or-DLL-or-file-or-pool;file:line bytes
+// The lines are sorted by stack, so outputs diff well
+template <typename MAPENTRY>
+void writeFoldedResults(std::ostream& os, const std::vector<MAPENTRY>& maps, bool usePageMap, bool useRss)
+   {
+   std::vector<AttributionRecord> records;
+   collectAttributionRecords(maps, usePageMap, records);
+   for (const auto& record : records)
+      {
+      unsigned long long bytes = useRss ? record._rssBytes : record._virtualBytes;
+      if (bytes != 0) // flame graph tools ignore empty frames anyway
+         os << record._stack << ' ' << std::dec << bytes << '\n';
+      }
+   }
+
+// Writes OpenMetrics gauges that all carry the same identifying labels
+class OpenMetricsWriter
+   {
+   std::ostream& _os;
+   std::string _commonLabels; // e.g. pid="1234",java_version="JRE 17.0.9"
+   public:
+      OpenMetricsWriter(std::ostream& os) : _os(os) {}
+      void addCommonLabel(const char *name, const std::string& value);
+      void family(const char *name, const char *help); // gauge in bytes
+      void sample(const char *name, const char *labelName, const std::string& labelValue, unsigned long long value);
+      void sample(const char *name, unsigned long long value); // with the common labels only
+      void end() { _os << "# EOF\n"; }
+   }; // OpenMetricsWriter
+
+// Only the largest topK DLLs and thread pools get their own series; the rest are summed
+// up under "__other__", which keeps the number of series bounded no matter how many there are.
+// Label values that the writer makes up are reserved names, so that they cannot collide
+// with a real DLL or thread pool
+#define OPENMETRICS_OTHER_LABEL "__other__"
+#define OPENMETRICS_UNKNOWN_LABEL "__unknown__"
+template <typename MAPENTRY>
+void writeOpenMetricsResults(std::ostream& os, const FootprintSummary<MAPENTRY>& summary, const std::vector<MAPENTRY>& maps,
+                             bool usePageMap, unsigned long long pid, const JavacoreInfo& javacoreInfo, size_t topK)
+   {
+   OpenMetricsWriter metrics(os);
+   metrics.addCommonLabel("pid", std::to_string(pid));
+   metrics.addCommonLabel("java_version", javacoreInfo._javaVersion);
+   metrics.addCommonLabel("vm_version", javacoreInfo._vmVersion);
+
+   // The totals are families of their own, so that summing a family over its categories counts the process once
+   metrics.family("jvm_footprint_total_virtual_bytes", "Virtual memory of the process");
+   metrics.sample("jvm_footprint_total_virtual_bytes", summary._totalVirtSize);
+   metrics.family("jvm_footprint_total_rss_bytes", "Resident memory of the process");
+   metrics.sample("jvm_footprint_total_rss_bytes", summary._totalRssSize);
+
+   metrics.family("jvm_footprint_virtual_bytes", "Virtual memory of the process by category");
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      metrics.sample("jvm_footprint_virtual_bytes", "category", AddrRange::RangeCategoryNames[i], summary._virtualSize[i]);
+   metrics.family("jvm_footprint_rss_bytes", "Resident memory of the process by category");
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      metrics.sample("jvm_footprint_rss_bytes", "category", AddrRange::RangeCategoryNames[i], summary._rssSize[i]);
+
+   metrics.family("jvm_footprint_dll_rss_bytes", "Resident memory of the largest shared libraries");
+   unsigned long long otherDllRss = 0;
+   for (size_t i = 0; i < summary._dllRss.size(); i++)
+      {
+      if (i < topK)
+         metrics.sample("jvm_footprint_dll_rss_bytes", "dll", summary._dllRss[i].first, summary._dllRss[i].second);
+      else
+         otherDllRss += summary._dllRss[i].second;
+      }
+   if (summary._dllRss.size() > topK)
+      metrics.sample("jvm_footprint_dll_rss_bytes", "dll", OPENMETRICS_OTHER_LABEL, otherDllRss);
+
+   // Thread stacks, summed up by thread pool
+   std::unordered_map<std::string, std::pair<unsigned long long, unsigned long long>> poolBytes; // pool -> virtual, RSS
+   for (const auto& crtMap : maps)
+      {
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories category, const AddrRange *range, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            if (category != AddrRange::STACK)
+               return;
+            auto& bytes = poolBytes[range && range->rangeType() == AddrRange::THREADSTACK_RANGE ?
+                                    threadPoolName(static_cast<const ThreadStack*>(range)->getThreadName()) : std::string(OPENMETRICS_UNKNOWN_LABEL)];
+            bytes.first += virtualBytes;
+            bytes.second += rssBytes;
+            });
+      }
+   using PoolEntry = std::pair<std::string, std::pair<unsigned long long, unsigned long long>>;
+   std::vector<PoolEntry> pools(poolBytes.begin(), poolBytes.end());
+   std::sort(pools.begin(), pools.end(), [](const PoolEntry& p1, const PoolEntry& p2) { return p1.second.second > p2.second.second; });
+   if (pools.size() > topK)
+      {
+      PoolEntry other(OPENMETRICS_OTHER_LABEL, std::make_pair(0ULL, 0ULL));
+      for (size_t i = topK; i < pools.size(); i++)
+         {
+         other.second.first += pools[i].second.first;
+         other.second.second += pools[i].second.second;
+         }
+      pools.resize(topK);
+      pools.push_back(other);
+      }
+   metrics.family("jvm_footprint_thread_stack_virtual_bytes", "Virtual memory of thread stacks by thread pool");
+   for (const auto& pool : pools)
+      metrics.sample("jvm_footprint_thread_stack_virtual_bytes", "pool", pool.first, pool.second.first);
+   metrics.family("jvm_footprint_thread_stack_rss_bytes", "Resident memory of thread stacks by thread pool");
+   for (const auto& pool : pools)
+      metrics.sample("jvm_footprint_thread_stack_rss_bytes", "pool", pool.first, pool.second.second);
+   metrics.end();
+   }
+
+#endif // _RESULTWRITER_HPP__
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <algorithm> // for max
+#include "RssReconciliation.hpp"
+
+using namespace std;
+
+void RssReconciliation::addMap(const MapRssDiscrepancy& discrepancy)
+   {
+   _totalAbsDiff += discrepancy.absDiff();
+   _totalMaxRss += max(discrepancy._smapsRss, discrepancy._pagemapRss);
+   if (discrepancy.absDiff() != 0)
+      {
+      _numMapsDiffering++;
+      _worstMaps.processElement(discrepancy);
+      }
+   }
+
+void RssReconciliation::addCategoryShare(AddrRange::RangeCategories category, double share, const MapRssDiscrepancy& discrepancy)
+   {
+   _smapsRss[category] += (unsigned long long)(share * discrepancy._smapsRss);
+   _pagemapRss[category] += (unsigned long long)(share * discrepancy._pagemapRss);
+   _absDiff[category] += share * discrepancy.absDiff();
+   _maxRss[category] += share * max(discrepancy._smapsRss, discrepancy._pagemapRss);
+   }
+
+void RssReconciliation::print(ostream& os, double maxSkewPercent) const
+   {
+   ios_base::fmtflags flags = os.flags();
+   streamsize precision = os.precision();
+   os << "\nReconciliation of the smaps RSS with the pagemap (KB):\n";
+   os << dec << setfill(' ') << fixed << setprecision(1);
+   os << setw(11) << "Category" << setw(12) << "smaps" << setw(12) << "pagemap" << setw(12) << "|diff|" << setw(9) << "Skew" << endl;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      if (_maxRss[i] == 0)
+         continue;
+      os << setw(11) << AddrRange::RangeCategoryNames[i] << setw(12) << (_smapsRss[i] >> 10) << setw(12) << (_pagemapRss[i] >> 10)
+         << setw(12) << (unsigned long long)(_absDiff[i] / 1024) << setw(8) << (100.0 * _absDiff[i] / _maxRss[i]) << "%" << endl;
+      }
+   os << _numMapsDiffering << " maps differ; skew score " << skewPercent() << "% (threshold " << maxSkewPercent << "%)\n";
+
+   vector<MapRssDiscrepancy> worst = _worstMaps.getSortedElements();
+   if (!worst.empty())
+      {
+      os << "Maps with the largest discrepancies:\n";
+      for (const auto& discrepancy : worst)
+         os << "   smaps=" << setw(8) << (discrepancy._smapsRss >> 10) << " KB pagemap=" << setw(8) << (discrepancy._pagemapRss >> 10)
+            << " KB " << *discrepancy._map << endl;
+      }
+   if (skewPercent() > maxSkewPercent)
+      os << "WARNING: the smaps file and the pagemap disagree by more than " << maxSkewPercent
+         << "%; the process changed while the inputs were captured and the attribution may be wrong\n";
+   os.flags(flags);
+   os.precision(precision);
+   }
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _RSSRECONCILIATION_HPP__
+#define _RSSRECONCILIATION_HPP__
+#include <vector>
+#include <iostream>
+#include "Attribution.hpp"
+#include "PageMapSupport.hpp"
+#include "Util.hpp"
+
+// RSS of one map according to smaps and according to the pagemap
+struct MapRssDiscrepancy
+   {
+   const MemoryEntry *_map;
+   unsigned long long _smapsRss;   // bytes
+   unsigned long long _pagemapRss; // bytes
+   unsigned long long absDiff() const { return _smapsRss > _pagemapRss ? _smapsRss - _pagemapRss : _pagemapRss - _smapsRss; }
+   };
+
+struct MapRssDiscrepancyLessThan
+   {
+   bool operator() (const MapRssDiscrepancy& d1, const MapRssDiscrepancy& d2) const
+      {
+      return d1.absDiff() < d2.absDiff();
+      }
+   };
+
+// Cross-check of the RSS in smaps with a recount of the same VMAs from the pagemap.
+// smaps, the javacore and the pagemap are captured at different times; if the process
+// changed in between, the attribution mixes two different states of it.
+// The skew score is the sum of |smaps RSS - pagemap RSS| over all maps divided by the
+// sum of the larger of the two, in percent: 0 when they agree, 100 when they have
+// nothing in common. The discrepancy of a map is charged to categories in the same
+// proportions as its RSS (see forEachMapAttribution)
+class RssReconciliation
+   {
+   unsigned long long _smapsRss[AddrRange::NUM_CATEGORIES] = {};
+   unsigned long long _pagemapRss[AddrRange::NUM_CATEGORIES] = {};
+   double _absDiff[AddrRange::NUM_CATEGORIES] = {};
+   double _maxRss[AddrRange::NUM_CATEGORIES] = {};
+   unsigned long long _totalAbsDiff = 0;
+   unsigned long long _totalMaxRss = 0;
+   unsigned _numMapsDiffering = 0;
+   TopK<MapRssDiscrepancy, MapRssDiscrepancyLessThan> _worstMaps;
+   public:
+      RssReconciliation(size_t topK) : _worstMaps(topK) {}
+      void addMap(const MapRssDiscrepancy& discrepancy);
+      void addCategoryShare(AddrRange::RangeCategories category, double share, const MapRssDiscrepancy& discrepancy);
+      double skewPercent() const { return _totalMaxRss ? 100.0 * _totalAbsDiff / _totalMaxRss : 0.0; }
+      void print(std::ostream& os, double maxSkewPercent) const;
+   }; // RssReconciliation
+
+// Recount the RSS of every map from the pagemap. The presence bits are those cached
+// per VMA by the PageMapReader, so no VMA is scanned more than once
+template <typename MAPENTRY>
+void reconcileRssWithPageMap(const std::vector<MAPENTRY>& maps, PageMapReader *pageMapReader, RssReconciliation& reconciliation)
+   {
+   struct Piece { AddrRange::RangeCategories _category; unsigned long long _virtualBytes, _rssBytes; };
+   std::vector<Piece> pieces;
+   for (const auto& crtMap : maps)
+      {
+      const std::vector<bool>& present = pageMapReader->getPresentPagesForVma(crtMap.getStart(), crtMap.getEnd());
+      MapRssDiscrepancy discrepancy{&crtMap, crtMap.getResidentSizeKB() << 10,
+                                    pageMapReader->countResidentBytes(present, crtMap.getStart(), crtMap.getStart(), crtMap.getEnd())};
+      reconciliation.addMap(discrepancy);
+
+      // Split between categories by the smaps RSS of each piece (or its virtual size if there is no RSS)
+      pieces.clear();
+      unsigned long long totalVirtual = 0, totalRss = 0;
+      forEachMapAttribution(crtMap, false,
+         [&](AddrRange::RangeCategories category, const AddrRange *, unsigned long long virtualBytes, unsigned long long rssBytes)
+            {
+            pieces.push_back(Piece{category, virtualBytes, rssBytes});
+            totalVirtual += virtualBytes;
+            totalRss += rssBytes;
+            });
+      for (const auto& piece : pieces)
+         {
+         double share = totalRss ? (double)piece._rssBytes / totalRss : totalVirtual ? (double)piece._virtualBytes / totalVirtual : 0.0;
+         reconciliation.addCategoryShare(piece._category, share, discrepancy);
+         }
+      }
+   }
+
+#endif // _RSSRECONCILIATION_HPP__
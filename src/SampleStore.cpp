@@ -0,0 +1,695 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <ctime>      // for localtime_r, strftime
+#include <fcntl.h>    // for open
+#include <unistd.h>   // for pread, write, ftruncate, fdatasync
+#include <sys/stat.h> // for mkdir, fstat
+#include "SampleStore.hpp"
+#include "TimeSeries.hpp"
+
+using namespace std;
+
+//------------------------------ encoding ------------------------------------
+static void putVarint(string& out, unsigned long long value)
+   {
+   while (value >= 0x80)
+      {
+      out.push_back((char)(value | 0x80));
+      value >>= 7;
+      }
+   out.push_back((char)value);
+   }
+
+static bool getVarint(const string& in, size_t& pos, unsigned long long& value)
+   {
+   value = 0;
+   for (int shift = 0; pos < in.size() && shift < 64; shift += 7)
+      {
+      unsigned char byte = (unsigned char)in[pos++];
+      value |= (unsigned long long)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return true;
+      }
+   return false;
+   }
+
+// Small negative deltas must stay small
+static unsigned long long zigzag(unsigned long long from, unsigned long long to)
+   {
+   long long delta = (long long)(to - from);
+   return ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63);
+   }
+
+static unsigned long long unzigzag(unsigned long long base, unsigned long long encoded)
+   {
+   long long delta = (long long)(encoded >> 1) ^ -(long long)(encoded & 1);
+   return base + (unsigned long long)delta;
+   }
+
+static unsigned crc32(const string& data)
+   {
+   static unsigned table[256];
+   static bool initialized = [&]()
+      {
+      for (unsigned i = 0; i < 256; i++)
+         {
+         unsigned c = i;
+         for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+         table[i] = c;
+         }
+      return true;
+      }();
+   (void)initialized;
+   unsigned crc = 0xFFFFFFFFu;
+   for (unsigned char byte : data)
+      crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+   return crc ^ 0xFFFFFFFFu;
+   }
+
+//------------------------------ files ---------------------------------------
+// A frame is [payload length: 4 bytes][CRC32 of the payload: 4 bytes][payload]
+static const size_t FRAME_HEADER_SIZE = 8;
+
+static void writeFully(int fd, const string& data, const string& what)
+   {
+   size_t written = 0;
+   while (written < data.size())
+      {
+      ssize_t n = write(fd, data.data() + written, data.size() - written);
+      if (n <= 0)
+         throw runtime_error("cannot write " + what + ": " + strerror(errno));
+      written += n;
+      }
+   }
+
+static void appendFrame(int fd, const string& payload, const string& what)
+   {
+   string frame(FRAME_HEADER_SIZE, '\0');
+   unsigned length = payload.size(), crc = crc32(payload);
+   memcpy(&frame[0], &length, 4);
+   memcpy(&frame[4], &crc, 4);
+   frame += payload;
+   writeFully(fd, frame, what);
+   }
+
+static void truncateFile(int fd, unsigned long long size, const string& what)
+   {
+   if (ftruncate(fd, size) != 0)
+      throw runtime_error("cannot truncate " + what + ": " + strerror(errno));
+   }
+
+static string readWholeFile(int fd)
+   {
+   struct stat st;
+   string contents;
+   if (fstat(fd, &st) != 0)
+      return contents;
+   contents.resize(st.st_size);
+   size_t done = 0;
+   while (done < contents.size())
+      {
+      ssize_t n = pread(fd, &contents[done], contents.size() - done, done);
+      if (n <= 0)
+         break;
+      done += n;
+      }
+   contents.resize(done);
+   return contents;
+   }
+
+// Read the frame at 'pos' of 'contents'; false if it is incomplete or corrupt
+static bool parseFrame(const string& contents, size_t pos, string& payload)
+   {
+   if (contents.size() - pos < FRAME_HEADER_SIZE)
+      return false;
+   unsigned length, crc;
+   memcpy(&length, contents.data() + pos, 4);
+   memcpy(&crc, contents.data() + pos + 4, 4);
+   if (contents.size() - pos - FRAME_HEADER_SIZE < length)
+      return false;
+   payload.assign(contents, pos + FRAME_HEADER_SIZE, length);
+   return crc32(payload) == crc;
+   }
+
+static bool readFrameAt(int fd, unsigned long long offset, string& payload)
+   {
+   char header[FRAME_HEADER_SIZE];
+   if (pread(fd, header, FRAME_HEADER_SIZE, offset) != (ssize_t)FRAME_HEADER_SIZE)
+      return false;
+   unsigned length, crc;
+   memcpy(&length, header, 4);
+   memcpy(&crc, header + 4, 4);
+   payload.resize(length);
+   if (pread(fd, &payload[0], length, offset + FRAME_HEADER_SIZE) != (ssize_t)length)
+      return false;
+   return crc32(payload) == crc;
+   }
+
+//------------------------------ SampleStore ---------------------------------
+SampleStore::SampleStore(const string& dirName, bool writable) : _dirName(dirName), _writable(writable)
+   {
+   if (writable && mkdir(dirName.c_str(), 0755) != 0 && errno != EEXIST)
+      throw runtime_error("Cannot create sample store " + dirName + ": " + strerror(errno));
+   int flags = writable ? O_RDWR | O_CREAT | O_APPEND : O_RDONLY;
+   _dictFd = open((dirName + "/series.dict").c_str(), flags, 0644);
+   _blocksFd = open((dirName + "/blocks.dat").c_str(), flags, 0644);
+   _indexFd = open((dirName + "/blocks.idx").c_str(), flags, 0644);
+   _journalFd = open((dirName + "/journal.dat").c_str(), flags, 0644);
+   // The destructor does not run when the constructor throws
+   try
+      {
+      if (_dictFd < 0 || _blocksFd < 0 || _indexFd < 0 || _journalFd < 0)
+         throw runtime_error("Cannot open sample store " + dirName + ": " + strerror(errno));
+      recover();
+      }
+   catch (...)
+      {
+      closeFiles();
+      throw;
+      }
+   }
+
+SampleStore::~SampleStore()
+   {
+   if (_writable)
+      {
+      try { flush(); }
+      catch (const runtime_error& e) { cerr << e.what() << endl; }
+      }
+   closeFiles();
+   }
+
+void SampleStore::closeFiles()
+   {
+   for (int fd : {_dictFd, _blocksFd, _indexFd, _journalFd})
+      if (fd >= 0)
+         close(fd);
+   }
+
+// Bring the files back to a consistent state after a crash: drop torn frames, index the
+// blocks that were written but not indexed and keep only the journal rows not yet in a block
+void SampleStore::recover()
+   {
+   readDictionary();
+   readIndex();
+   readJournal();
+   }
+
+void SampleStore::readDictionary()
+   {
+   string contents = readWholeFile(_dictFd), payload;
+   size_t pos = 0;
+   while (parseFrame(contents, pos, payload))
+      {
+      size_t p = 0;
+      unsigned long long id, length;
+      while (getVarint(payload, p, id) && getVarint(payload, p, length) && p + length <= payload.size())
+         {
+         if (id != _seriesNames.size())
+            break; // ids are given in order
+         _seriesNames.push_back(payload.substr(p, length));
+         _seriesIds[_seriesNames.back()] = id;
+         p += length;
+         }
+      pos += FRAME_HEADER_SIZE + payload.size();
+      }
+   if (_writable && pos != contents.size())
+      truncateFile(_dictFd, pos, "series dictionary");
+   }
+
+// An index entry is a frame with the first and last timestamp and the offset of a block
+static string encodeIndexEntry(unsigned long long firstTimestampMs, unsigned long long lastTimestampMs, unsigned long long offset)
+   {
+   string payload;
+   putVarint(payload, firstTimestampMs);
+   putVarint(payload, lastTimestampMs);
+   putVarint(payload, offset);
+   return payload;
+   }
+
+void SampleStore::readIndex()
+   {
+   string contents = readWholeFile(_indexFd), payload;
+   struct stat st;
+   fstat(_blocksFd, &st);
+   unsigned long long blocksSize = st.st_size;
+   // Every entry must be a sound frame for a block that starts after the previous one and
+   // inside blocks.dat; the index stops at the first entry that is not
+   size_t pos = 0;
+   while (parseFrame(contents, pos, payload))
+      {
+      size_t p = 0;
+      IndexEntry entry;
+      if (!getVarint(payload, p, entry._firstTimestampMs) || !getVarint(payload, p, entry._lastTimestampMs) ||
+          !getVarint(payload, p, entry._offset) || p != payload.size())
+         break;
+      if (entry._lastTimestampMs < entry._firstTimestampMs || entry._offset + FRAME_HEADER_SIZE > blocksSize)
+         break;
+      if (!_index.empty() && (entry._offset <= _index.back()._offset || entry._firstTimestampMs < _index.back()._lastTimestampMs))
+         break;
+      _index.push_back(entry);
+      pos += FRAME_HEADER_SIZE + payload.size();
+      }
+   size_t numEntries = _index.size();
+   // The blocks are appended and only the tail of blocks.dat can be torn, so the entries in
+   // offset order are sound if the block of the last one is
+   while (!_index.empty() && !readFrameAt(_blocksFd, _index.back()._offset, payload))
+      _index.pop_back();
+   bool indexChanged = _index.size() != numEntries || pos != contents.size();
+
+   // Blocks written after the last indexed one (the index is written after the block)
+   unsigned long long offset = 0;
+   if (!_index.empty())
+      offset = _index.back()._offset + FRAME_HEADER_SIZE + payload.size();
+   vector<Row> rows;
+   if (!_index.empty())
+      {
+      decodeBlock(payload, rows);
+      _nextSeqNo = rows.empty() ? 0 : rows.back()._seqNo + 1;
+      }
+   while (offset < blocksSize && readFrameAt(_blocksFd, offset, payload))
+      {
+      decodeBlock(payload, rows);
+      if (!rows.empty())
+         {
+         _index.push_back(IndexEntry{rows.front()._timestampMs, rows.back()._timestampMs, offset});
+         _nextSeqNo = rows.back()._seqNo + 1;
+         indexChanged = true;
+         }
+      offset += FRAME_HEADER_SIZE + payload.size();
+      }
+   if (_writable)
+      {
+      if (offset != blocksSize)
+         truncateFile(_blocksFd, offset, "sample blocks"); // torn block
+      if (indexChanged)
+         {
+         truncateFile(_indexFd, 0, "block index");
+         for (const auto& entry : _index)
+            appendFrame(_indexFd, encodeIndexEntry(entry._firstTimestampMs, entry._lastTimestampMs, entry._offset), "block index");
+         }
+      }
+   }
+
+void SampleStore::readJournal()
+   {
+   string contents = readWholeFile(_journalFd), payload;
+   size_t pos = 0;
+   vector<pair<unsigned long long, unsigned long long>> values; // current values of the delta chain
+   bool stale = false;
+   while (parseFrame(contents, pos, payload))
+      {
+      pos += FRAME_HEADER_SIZE + payload.size();
+      size_t p = 0;
+      unsigned long long seqNo, timestampMs, numChanged, id, virtualDelta, rssDelta;
+      if (!getVarint(payload, p, seqNo) || !getVarint(payload, p, timestampMs) || !getVarint(payload, p, numChanged))
+         break;
+      for (unsigned long long i = 0; i < numChanged && getVarint(payload, p, id) && getVarint(payload, p, virtualDelta) && getVarint(payload, p, rssDelta); i++)
+         {
+         if (id >= values.size())
+            values.resize(id + 1);
+         values[id].first = unzigzag(values[id].first, virtualDelta);
+         values[id].second = unzigzag(values[id].second, rssDelta);
+         }
+      if (seqNo < _nextSeqNo)
+         {
+         stale = true; // already sealed in a block; the crash happened before the journal was cleared
+         continue;
+         }
+      _openBlock.push_back(Row{seqNo, timestampMs, values});
+      _nextSeqNo = seqNo + 1;
+      }
+   if (_writable && (stale || pos != contents.size()))
+      {
+      // Rewrite the journal with the rows that are still needed
+      vector<Row> rows;
+      rows.swap(_openBlock);
+      truncateFile(_journalFd, 0, "journal");
+      for (const auto& row : rows)
+         {
+         _nextSeqNo = row._seqNo;
+         Sample sample;
+         toSample(row, sample);
+         append(row._timestampMs, sample._records);
+         }
+      }
+   }
+
+unsigned long long SampleStore::seriesId(const string& name)
+   {
+   auto it = _seriesIds.find(name);
+   if (it != _seriesIds.end())
+      return it->second;
+   unsigned long long id = _seriesNames.size();
+   _seriesNames.push_back(name);
+   _seriesIds[name] = id;
+   // The name is in the dictionary before any row refers to it
+   _scratch.clear();
+   putVarint(_scratch, id);
+   putVarint(_scratch, name.size());
+   _scratch += name;
+   appendFrame(_dictFd, _scratch, "series dictionary");
+   return id;
+   }
+
+void SampleStore::append(unsigned long long timestampMs, const vector<AttributionRecord>& records)
+   {
+   Row row{_nextSeqNo++, timestampMs, {}};
+   row._values.resize(_seriesNames.size());
+   for (const auto& record : records)
+      {
+      unsigned long long id = seriesId(record._stack);
+      if (id >= row._values.size())
+         row._values.resize(id + 1);
+      row._values[id] = make_pair(record._virtualBytes, record._rssBytes);
+      }
+
+   // Journal row: only the series that changed since the previous row of the block
+   static const vector<pair<unsigned long long, unsigned long long>> noValues;
+   const vector<pair<unsigned long long, unsigned long long>>& previous = _openBlock.empty() ? noValues : _openBlock.back()._values;
+   string changes;
+   unsigned long long numChanged = 0;
+   for (size_t id = 0; id < row._values.size(); id++)
+      {
+      pair<unsigned long long, unsigned long long> before = id < previous.size() ? previous[id] : make_pair(0ULL, 0ULL);
+      if (before == row._values[id])
+         continue;
+      numChanged++;
+      putVarint(changes, id);
+      putVarint(changes, zigzag(before.first, row._values[id].first));
+      putVarint(changes, zigzag(before.second, row._values[id].second));
+      }
+   _scratch.clear();
+   putVarint(_scratch, row._seqNo);
+   putVarint(_scratch, row._timestampMs);
+   putVarint(_scratch, numChanged);
+   _scratch += changes;
+   appendFrame(_journalFd, _scratch, "journal");
+   _openBlock.push_back(move(row));
+   if (_openBlock.size() >= BLOCK_SAMPLES)
+      sealBlock();
+   }
+
+void SampleStore::flush()
+   {
+   if (_writable && !_openBlock.empty())
+      sealBlock();
+   }
+
+// Move the samples of the journal into a columnar block
+void SampleStore::sealBlock()
+   {
+   const size_t count = _openBlock.size();
+   string block;
+   putVarint(block, _openBlock.front()._seqNo);
+   putVarint(block, count);
+   putVarint(block, _openBlock.front()._timestampMs);
+   for (size_t i = 1; i < count; i++)
+      putVarint(block, _openBlock[i]._timestampMs - _openBlock[i-1]._timestampMs);
+   size_t numSeries = _seriesNames.size();
+   string columns;
+   unsigned long long numColumns = 0;
+   for (size_t id = 0; id < numSeries; id++)
+      {
+      bool used = false;
+      for (const auto& row : _openBlock)
+         if (id < row._values.size() && row._values[id] != make_pair(0ULL, 0ULL))
+            used = true;
+      if (!used)
+         continue;
+      numColumns++;
+      putVarint(columns, id);
+      unsigned long long previousVirtual = 0, previousRss = 0;
+      for (const auto& row : _openBlock)
+         {
+         unsigned long long value = id < row._values.size() ? row._values[id].first : 0;
+         putVarint(columns, zigzag(previousVirtual, value));
+         previousVirtual = value;
+         }
+      for (const auto& row : _openBlock)
+         {
+         unsigned long long value = id < row._values.size() ? row._values[id].second : 0;
+         putVarint(columns, zigzag(previousRss, value));
+         previousRss = value;
+         }
+      }
+   putVarint(block, numColumns);
+   block += columns;
+
+   struct stat st;
+   fstat(_blocksFd, &st);
+   IndexEntry entry{_openBlock.front()._timestampMs, _openBlock.back()._timestampMs, (unsigned long long)st.st_size};
+   appendFrame(_blocksFd, block, "sample block");
+   // The block must be durable before its rows leave the journal
+   if (fdatasync(_dictFd) != 0 || fdatasync(_blocksFd) != 0)
+      throw runtime_error(string("cannot sync the sample store: ") + strerror(errno));
+   appendFrame(_indexFd, encodeIndexEntry(entry._firstTimestampMs, entry._lastTimestampMs, entry._offset), "block index");
+   _index.push_back(entry);
+   truncateFile(_journalFd, 0, "journal");
+   _openBlock.clear();
+   }
+
+void SampleStore::decodeBlock(const string& payload, vector<Row>& rows) const
+   {
+   rows.clear();
+   size_t p = 0;
+   unsigned long long firstSeqNo, count, timestampMs, delta, numColumns, id, encoded;
+   if (!getVarint(payload, p, firstSeqNo) || !getVarint(payload, p, count) || !getVarint(payload, p, timestampMs))
+      return;
+   rows.resize(count);
+   for (unsigned long long i = 0; i < count; i++)
+      {
+      if (i > 0 && getVarint(payload, p, delta))
+         timestampMs += delta;
+      rows[i]._seqNo = firstSeqNo + i;
+      rows[i]._timestampMs = timestampMs;
+      }
+   if (!getVarint(payload, p, numColumns))
+      return;
+   for (unsigned long long c = 0; c < numColumns && getVarint(payload, p, id); c++)
+      {
+      for (int rss = 0; rss < 2; rss++)
+         {
+         unsigned long long value = 0;
+         for (auto& row : rows)
+            {
+            if (!getVarint(payload, p, encoded))
+               return;
+            value = unzigzag(value, encoded);
+            if (id >= row._values.size())
+               row._values.resize(id + 1);
+            (rss ? row._values[id].second : row._values[id].first) = value;
+            }
+         }
+      }
+   }
+
+void SampleStore::toSample(const Row& row, Sample& sample) const
+   {
+   sample._timestampMs = row._timestampMs;
+   sample._records.clear();
+   for (size_t id = 0; id < row._values.size() && id < _seriesNames.size(); id++)
+      {
+      if (row._values[id] == make_pair(0ULL, 0ULL))
+         continue;
+      sample._records.emplace_back();
+      sample._records.back()._stack = _seriesNames[id];
+      sample._records.back()._virtualBytes = row._values[id].first;
+      sample._records.back()._rssBytes = row._values[id].second;
+      }
+   sort(sample._records.begin(), sample._records.end());
+   }
+
+unsigned long long SampleStore::firstTimestampMs() const
+   {
+   return !_index.empty() ? _index.front()._firstTimestampMs : !_openBlock.empty() ? _openBlock.front()._timestampMs : 0;
+   }
+
+unsigned long long SampleStore::lastTimestampMs() const
+   {
+   return !_openBlock.empty() ? _openBlock.back()._timestampMs : !_index.empty() ? _index.back()._lastTimestampMs : 0;
+   }
+
+void SampleStore::readRange(unsigned long long fromMs, unsigned long long toMs, const function<void(const Sample&)>& visit) const
+   {
+   // First block that ends at or after fromMs
+   auto block = lower_bound(_index.begin(), _index.end(), fromMs,
+                            [](const IndexEntry& entry, unsigned long long t) { return entry._lastTimestampMs < t; });
+   string payload;
+   vector<Row> rows;
+   Sample sample;
+   for (; block != _index.end() && block->_firstTimestampMs <= toMs; ++block)
+      {
+      if (!readFrameAt(_blocksFd, block->_offset, payload))
+         {
+         cerr << "Skipping corrupt block at offset " << block->_offset << " of " << _dirName << "/blocks.dat\n";
+         continue;
+         }
+      decodeBlock(payload, rows);
+      for (const auto& row : rows)
+         {
+         if (row._timestampMs < fromMs || row._timestampMs > toMs)
+            continue;
+         toSample(row, sample);
+         visit(sample);
+         }
+      }
+   for (const auto& row : _openBlock)
+      {
+      if (row._timestampMs < fromMs || row._timestampMs > toMs)
+         continue;
+      toSample(row, sample);
+      visit(sample);
+      }
+   }
+
+bool SampleStore::readSampleAt(unsigned long long timestampMs, Sample& sample) const
+   {
+   if (empty())
+      return false;
+   timestampMs = max(timestampMs, firstTimestampMs());
+   // Only the block that contains the sample (or the journal) has to be read
+   unsigned long long fromMs = 0;
+   auto block = upper_bound(_index.begin(), _index.end(), timestampMs,
+                            [](unsigned long long t, const IndexEntry& entry) { return t < entry._firstTimestampMs; });
+   if (block != _index.begin())
+      fromMs = (block - 1)->_firstTimestampMs;
+   else if (!_openBlock.empty())
+      fromMs = _openBlock.front()._timestampMs;
+   bool found = false;
+   readRange(fromMs, timestampMs, [&](const Sample& s) { sample = s; found = true; });
+   return found;
+   }
+
+//------------------------------ readers for the other modes -----------------
+bool isSampleStore(const char *dirName)
+   {
+   struct stat st;
+   return stat((string(dirName) + "/series.dict").c_str(), &st) == 0;
+   }
+
+bool isSampleStoreSpec(const char *spec)
+   {
+   const char *at = strrchr(spec, '@');
+   return at && isSampleStore(string(spec, at - spec).c_str());
+   }
+
+void readSampleStoreRecords(const char *spec, vector<AttributionRecord>& records)
+   {
+   const char *at = strrchr(spec, '@');
+   string dirName(spec, at - spec);
+   cout << "Reading sample store: " << dirName << endl;
+   SampleStore store(dirName, false);
+   unsigned long long timestampMs;
+   if (strcmp(at + 1, "first") == 0)
+      timestampMs = store.firstTimestampMs();
+   else if (strcmp(at + 1, "last") == 0)
+      timestampMs = store.lastTimestampMs();
+   else
+      timestampMs = strtoull(at + 1, nullptr, 10) * 1000;
+   SampleStore::Sample sample;
+   if (!store.readSampleAt(timestampMs, sample))
+      throw runtime_error("No samples in " + dirName);
+   records.clear();
+   for (auto& record : sample._records)
+      if (record._stack[0] != '#')
+         records.push_back(record);
+   }
+
+static string formatTimestamp(unsigned long long timestampMs)
+   {
+   time_t seconds = timestampMs / 1000;
+   struct tm tm;
+   char buffer[32];
+   localtime_r(&seconds, &tm);
+   strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+   return buffer;
+   }
+
+void readSampleStoreSnapshots(const char *dirName, unsigned long long fromMs, unsigned long long toMs, unsigned long long downsampleMs,
+                              vector<FootprintSnapshot>& snapshots)
+   {
+   cout << "Reading sample store: " << dirName << endl;
+   SampleStore store(dirName, false);
+   unordered_map<string, int> categoryIds;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      categoryIds[AddrRange::RangeCategoryNames[i]] = i;
+   unsigned long long bucket = ~0ULL;
+   FootprintSnapshot point;
+   store.readRange(fromMs, toMs, [&](const SampleStore::Sample& sample)
+      {
+      FootprintSnapshot snapshot;
+      snapshot._timestampMs = sample._timestampMs;
+      for (const auto& record : sample._records)
+         {
+         if (record._stack == "#total")
+            {
+            snapshot._totalVirtSize = record._virtualBytes;
+            snapshot._totalRssSize = record._rssBytes;
+            continue;
+            }
+         if (record._stack == "#probed")
+            {
+            snapshot._probedRssSize = record._rssBytes;
+            continue;
+            }
+         auto category = categoryIds.find(record._stack.substr(0, record._stack.find(';')));
+         if (category == categoryIds.end())
+            continue;
+         snapshot._virtualSize[category->second] += record._virtualBytes;
+         snapshot._rssSize[category->second] += record._rssBytes;
+         }
+      if (downsampleMs == 0)
+         {
+         snapshot._key = formatTimestamp(snapshot._timestampMs);
+         snapshots.push_back(snapshot);
+         return;
+         }
+      // Keep the peak of every value in each interval
+      if (sample._timestampMs / downsampleMs != bucket)
+         {
+         if (bucket != ~0ULL)
+            snapshots.push_back(point);
+         bucket = sample._timestampMs / downsampleMs;
+         point = FootprintSnapshot();
+         point._timestampMs = bucket * downsampleMs;
+         point._key = formatTimestamp(point._timestampMs);
+         }
+      point._totalVirtSize = max(point._totalVirtSize, snapshot._totalVirtSize);
+      point._totalRssSize = max(point._totalRssSize, snapshot._totalRssSize);
+      point._probedRssSize = max(point._probedRssSize, snapshot._probedRssSize);
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         {
+         point._virtualSize[i] = max(point._virtualSize[i], snapshot._virtualSize[i]);
+         point._rssSize[i] = max(point._rssSize[i], snapshot._rssSize[i]);
+         }
+      });
+   if (bucket != ~0ULL)
+      snapshots.push_back(point);
+   }
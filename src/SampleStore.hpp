@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _SAMPLESTORE_HPP__
+#define _SAMPLESTORE_HPP__
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "Attribution.hpp"
+
+// Append-only store for the samples taken by the sampling mode. A sample is the set of
+// attribution records of the process at one moment (one series per attribution stack,
+// with a virtual and an RSS value), plus metadata series whose names start with '#'.
+// The store is a directory with four files:
+//    series.dict  names of the series; a series gets the next id the first time it is seen
+//    blocks.dat   sealed blocks of up to BLOCK_SAMPLES samples stored column by column:
+//                 the timestamps, then the virtual and RSS values of each series, all
+//                 delta and zigzag/varint encoded. Values rarely change between samples,
+//                 so most of them take one byte
+//    blocks.idx   first and last timestamp and file offset of every block, for range queries
+//    journal.dat  the samples of the block being filled, one delta-encoded row per sample
+// Every record of every file is a frame with a length and a CRC32, so a write torn by a
+// crash is detected and dropped. A block is synced before its rows are removed from the
+// journal and the index can be rebuilt from blocks.dat, so samples that were written are not lost
+class SampleStore
+   {
+   public:
+   static const unsigned BLOCK_SAMPLES = 64;
+   struct Sample
+      {
+      unsigned long long _timestampMs = 0;
+      std::vector<AttributionRecord> _records; // sorted by stack; the metadata series come first
+      };
+
+   private:
+   struct IndexEntry
+      {
+      unsigned long long _firstTimestampMs;
+      unsigned long long _lastTimestampMs;
+      unsigned long long _offset; // of the block frame in blocks.dat
+      };
+   struct Row // one sample of the open block: values of the series, by id
+      {
+      unsigned long long _seqNo;
+      unsigned long long _timestampMs;
+      std::vector<std::pair<unsigned long long, unsigned long long>> _values; // (virtual, rss); index is the series id
+      };
+   std::string _dirName;
+   bool _writable;
+   int _dictFd = -1, _blocksFd = -1, _indexFd = -1, _journalFd = -1;
+   std::vector<std::string> _seriesNames; // index is the series id
+   std::unordered_map<std::string, unsigned long long> _seriesIds;
+   std::vector<IndexEntry> _index;
+   unsigned long long _nextSeqNo = 0;  // of the next sample appended
+   std::vector<Row> _openBlock;        // samples in the journal
+   std::string _scratch;
+
+   void recover();
+   void closeFiles();
+   void readDictionary();
+   void readIndex();
+   void readJournal();
+   unsigned long long seriesId(const std::string& name);
+   void sealBlock();
+   void decodeBlock(const std::string& payload, std::vector<Row>& rows) const;
+   void toSample(const Row& row, Sample& sample) const;
+
+   public:
+      // A writable store is created if it does not exist; a read-only store must exist.
+      // Throws std::runtime_error if the store cannot be created, opened or recovered
+      SampleStore(const std::string& dirName, bool writable);
+      ~SampleStore();
+      // Samples must be appended in time order
+      void append(unsigned long long timestampMs, const std::vector<AttributionRecord>& records);
+      // Seal the open block (done when BLOCK_SAMPLES samples are in the journal, and on close)
+      void flush();
+      bool empty() const { return _index.empty() && _openBlock.empty(); }
+      unsigned long long firstTimestampMs() const;
+      unsigned long long lastTimestampMs() const;
+      // Visit the samples with fromMs <= timestamp <= toMs in time order. Only the blocks
+      // that overlap the range are read
+      void readRange(unsigned long long fromMs, unsigned long long toMs, const std::function<void(const Sample&)>& visit) const;
+      // The last sample taken at or before timestampMs (the first sample if there is none); false if the store is empty
+      bool readSampleAt(unsigned long long timestampMs, Sample& sample) const;
+   }; // SampleStore
+
+bool isSampleStore(const char *dirName);
+
+// "storeDir@when" where 'when' is "first", "last" or seconds since the epoch; the attribution
+// records of the selected sample, without the metadata series
+bool isSampleStoreSpec(const char *spec);
+void readSampleStoreRecords(const char *spec, std::vector<AttributionRecord>& records);
+
+// Per-category time series of the samples in [fromMs, toMs]; with downsampleMs > 0 the samples
+// are grouped in intervals of that length and the largest value of each category is kept
+struct FootprintSnapshot;
+void readSampleStoreSnapshots(const char *dirName, unsigned long long fromMs, unsigned long long toMs, unsigned long long downsampleMs,
+                              std::vector<FootprintSnapshot>& snapshots);
+
+#endif // _SAMPLESTORE_HPP__
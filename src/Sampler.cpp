@@ -0,0 +1,453 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <list>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <memory>    // for unique_ptr
+#include <algorithm> // for max
+#include <cstring>   // for strlen, strncasecmp
+#include <cerrno>
+#include <stdexcept> // for runtime_error
+#include <csignal>   // for kill
+#include <dirent.h>  // for opendir/readdir
+#include <sys/stat.h>
+#include <sys/resource.h> // for getrusage
+#include "Sampler.hpp"
+#include "smap.hpp"
+#include "Javacore.hpp"
+#include "CallSites.hpp"
+#include "Attribution.hpp"
+#include "TimeSeries.hpp"
+#include "PageMapSupport.hpp"
+#include "SampleStore.hpp"
+#include "HeadroomForecast.hpp"
+
+using namespace std;
+
+bool parseRssAlert(const char *spec, RssAlert& alert)
+   {
+   const char *colon = strrchr(spec, ':');
+   if (!colon || colon == spec || !colon[1])
+      return false;
+   size_t nameLength = colon - spec;
+   alert._category = -1;
+   if (nameLength == strlen("Total") && strncasecmp(spec, "Total", nameLength) == 0)
+      alert._category = AddrRange::NUM_CATEGORIES;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      if (nameLength == strlen(AddrRange::RangeCategoryNames[i]) && strncasecmp(spec, AddrRange::RangeCategoryNames[i], nameLength) == 0)
+         alert._category = i;
+   if (alert._category < 0)
+      return false;
+   char *end;
+   alert._limitKB = strtoull(colon + 1, &end, 10);
+   return *end == '\0';
+   }
+
+// An input file of the sampler that is read again only when it changes
+struct TrackedFile
+   {
+   string _path;
+   time_t _mtime = 0;
+   off_t _size = 0;
+   // Returns true if 'path' is not the file read last time or if it was modified since
+   bool changed(const string& path)
+      {
+      struct stat st;
+      if (stat(path.c_str(), &st) != 0)
+         return false;
+      if (path == _path && st.st_mtime == _mtime && st.st_size == _size)
+         return false;
+      _path = path;
+      _mtime = st.st_mtime;
+      _size = st.st_size;
+      return true;
+      }
+   };
+
+// The javacore to use: the file itself, or the most recent javacore*.txt of a directory.
+// Returns an empty string if there is none
+static string latestJavacore(const char *javacorePath)
+   {
+   struct stat st;
+   if (stat(javacorePath, &st) != 0)
+      return string();
+   if (!S_ISDIR(st.st_mode))
+      return string(javacorePath);
+   DIR *dir = opendir(javacorePath);
+   if (!dir)
+      return string();
+   string dirPath(javacorePath);
+   if (dirPath.back() != '/')
+      dirPath.push_back('/');
+   string latest;
+   time_t latestMtime = 0;
+   while (struct dirent *dirEntry = readdir(dir))
+      {
+      string name(dirEntry->d_name);
+      if (name.compare(0, 8, "javacore") != 0 || name.size() < 4 || name.compare(name.size() - 4, 4, ".txt") != 0)
+         continue;
+      if (stat((dirPath + name).c_str(), &st) == 0 && (latest.empty() || st.st_mtime > latestMtime || (st.st_mtime == latestMtime && dirPath + name > latest)))
+         {
+         latest = dirPath + name;
+         latestMtime = st.st_mtime;
+         }
+      }
+   closedir(dir);
+   return latest;
+   }
+
+static bool processExists(int pid)
+   {
+   return kill(pid, 0) == 0 || errno == EPERM;
+   }
+
+static double cpuSecondsUsed()
+   {
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+   }
+
+// Bytes read by this process so far (rchar of /proc/self/io, which includes the reads from /proc)
+static unsigned long long bytesRead()
+   {
+   ifstream io("/proc/self/io");
+   string key;
+   unsigned long long value;
+   while (io >> key >> value)
+      if (key == "rchar:")
+         return value;
+   return 0;
+   }
+
+static void printHeader(ostream& out, const SamplerOptions& options)
+   {
+   out << "RSS (KB) of PID " << options._pid << " every " << options._intervalMs << " ms ("
+       << (options._useMapsTier ? "maps" : "smaps") << " and pagemap):\n";
+   out << setw(10) << "Elapsed(s)" << setw(10) << "Total";
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      out << setw(12) << AddrRange::RangeCategoryNames[i];
+   out << setw(9) << "CPU(ms)" << setw(10) << "Read(KB)" << setw(9) << "Changed";
+   if (options._useMapsTier)
+      out << setw(11) << "Probed(KB)";
+   if (options._limitKB)
+      out << "  ToLimit [95% bounds] fastest";
+   out << endl;
+   }
+
+static void checkAlerts(ostream& out, vector<RssAlert>& alerts, const FootprintSnapshot& snapshot, unsigned long long elapsedSec)
+   {
+   for (auto& alert : alerts)
+      {
+      unsigned long long rssKB = (alert._category == AddrRange::NUM_CATEGORIES ? snapshot._totalRssSize : snapshot._rssSize[alert._category]) >> 10;
+      const char *name = alert._category == AddrRange::NUM_CATEGORIES ? "Total" : AddrRange::RangeCategoryNames[alert._category];
+      if (!alert._raised && rssKB > alert._limitKB)
+         {
+         alert._raised = true;
+         out << "ALERT at " << elapsedSec << "s: " << name << " RSS " << rssKB << " KB is above " << alert._limitKB << " KB\n";
+         }
+      else if (alert._raised && rssKB <= alert._limitKB)
+         {
+         alert._raised = false;
+         out << "CLEARED at " << elapsedSec << "s: " << name << " RSS " << rssKB << " KB is back under " << alert._limitKB << " KB\n";
+         }
+      }
+   }
+
+// Annotated maps of the previous sample. Most VMAs do not change between samples, so only
+// the maps that are new are annotated and only the ranges in VMAs whose pages changed are
+// counted again from the pagemap
+struct SamplerState
+   {
+   static const size_t MAX_STACK_BATCHES = 32; // start over when the stack copies pile up
+   vector<SmapEntry> _maps;                    // sorted by address
+   list<vector<ThreadStack>> _stackBatches;    // copy of the javacore stacks for each annotation of new maps
+   list<ThreadStack> _stackGuards;
+   bool _valid = false;                        // false when the segments or call-sites were read again
+   size_t _numChangedMaps = 0;                 // new maps and maps whose pages changed in the last sample
+   unsigned long long _round = 0;              // selects the chunks probed by refreshVma
+   };
+
+// The same VMA as in the previous sample: same addresses, protection and mapped file
+static bool sameVma(const SmapEntry& before, const SmapEntry& now)
+   {
+   return before.getStart() == now.getStart() && before.getEnd() == now.getEnd() && before._protection == now._protection &&
+          before._offset == now._offset && before._inode == now._inode && before._details == now._details;
+   }
+
+// Unchanged smaps counters are taken to mean unchanged pages
+static bool sameCounters(const SmapEntry& before, const SmapEntry& now)
+   {
+   return before._rss == now._rss && before._pss == now._pss && before._swap == now._swap &&
+          before._sharedClean == now._sharedClean && before._sharedDirty == now._sharedDirty &&
+          before._privateClean == now._privateClean && before._privateDirty == now._privateDirty;
+   }
+
+static void copyCounters(const SmapEntry& from, SmapEntry& to)
+   {
+   to._rss = from._rss;
+   to._pss = from._pss;
+   to._swap = from._swap;
+   to._sharedClean = from._sharedClean;
+   to._sharedDirty = from._sharedDirty;
+   to._privateClean = from._privateClean;
+   to._privateDirty = from._privateDirty;
+   }
+
+// Read the maps of the process, recount the RSS of the ranges and reduce them to per-category totals
+// and, if 'records' is given, to attribution records plus a "#total" series with the map totals.
+// With maps, a "#probed" series has the size and RSS of the VMAs whose presence bits were only
+// probed: their RSS may be up to REFRESH_PROBE_STRIDE - 1 samples old, so the sample is approximate
+static void sampleProcess(const SamplerOptions& options, const string& mapsFilename, PageMapReader& pageMapReader, vector<J9Segment>& segments,
+                          const vector<ThreadStack>& threadStacks, vector<CallSite>& callSites, SamplerState& state,
+                          FootprintSnapshot& snapshot, vector<AttributionRecord> *records, ostream& progress)
+   {
+   vector<SmapEntry> maps;
+   if (options._useMapsTier)
+      readMapsFile(mapsFilename.c_str(), maps, progress);
+   else
+      readSmapsFile(mapsFilename.c_str(), maps, progress);
+   if (!state._valid || state._stackBatches.size() > SamplerState::MAX_STACK_BATCHES)
+      {
+      state._maps.clear();
+      state._stackBatches.clear();
+      state._stackGuards.clear();
+      state._valid = true;
+      }
+
+   // Keep the annotated entries of the VMAs that were there last time
+   vector<pair<unsigned long long, unsigned long long>> vmas;
+   vector<bool> dirty(maps.size(), true); // pages may have changed: the pagemap must be read again
+   vector<SmapEntry> newMaps;             // to annotate
+   vector<size_t> newMapPositions;
+   vmas.reserve(maps.size());
+   auto before = state._maps.begin();
+   for (size_t i = 0; i < maps.size(); i++)
+      {
+      vmas.emplace_back(maps[i].getStart(), maps[i].getEnd());
+      while (before != state._maps.end() && before->getStart() < maps[i].getStart())
+         ++before;
+      if (before != state._maps.end() && sameVma(*before, maps[i]))
+         {
+         dirty[i] = !options._useMapsTier && !sameCounters(*before, maps[i]);
+         copyCounters(maps[i], *before);
+         maps[i] = std::move(*before);
+         }
+      else
+         {
+         newMaps.push_back(std::move(maps[i]));
+         newMapPositions.push_back(i);
+         }
+      }
+   pageMapReader.updateVmas(vmas, dirty);
+
+   if (!newMaps.empty())
+      {
+      // The stacks as adjusted by the previous annotations: a stack whose guard page was
+      // annotated before must not cover the guard again
+      state._stackBatches.push_back(state._stackBatches.empty() ? threadStacks : state._stackBatches.back());
+      annotateMapWithSegments(newMaps, segments, progress);
+      annotateMapWithThreadStacks(newMaps, state._stackBatches.back(), &state._stackGuards, progress);
+      annotateMapWithSegments(newMaps, callSites, progress);
+      for (size_t i = 0; i < newMaps.size(); i++)
+         maps[newMapPositions[i]] = std::move(newMaps[i]);
+      }
+
+   // Intervals whose pages changed. With smaps, the VMAs with different counters; with maps
+   // there are no counters, so a rotating eighth of the chunks of every VMA is probed, the VMAs
+   // with a changed probe are read again and only the chunks whose presence bits changed count
+   // as changed. The probes still cost a pagemap read in every large VMA, and a change in a
+   // chunk that was not probed is missed until its turn comes
+   vector<pair<unsigned long long, unsigned long long>> changed;
+   unsigned long long probedVirtualBytes = 0, probedRssBytes = 0;
+   state._numChangedMaps = 0;
+   for (size_t i = 0; i < maps.size(); i++)
+      {
+      if (options._useMapsTier)
+         {
+         if (maps[i].isReservedOnly())
+            continue;
+         bool probedOnly;
+         if (pageMapReader.refreshVma(vmas[i].first, vmas[i].second, state._round, changed, probedOnly))
+            state._numChangedMaps++;
+         maps[i]._rss = pageMapReader.computeRssForAddrRange(vmas[i].first, vmas[i].second) >> 10;
+         if (probedOnly)
+            {
+            probedVirtualBytes += maps[i].size();
+            probedRssBytes += maps[i]._rss << 10;
+            }
+         }
+      else if (dirty[i])
+         {
+         state._numChangedMaps++;
+         if (!changed.empty() && changed.back().second == vmas[i].first)
+            changed.back().second = vmas[i].second;
+         else
+            changed.push_back(vmas[i]);
+         }
+      }
+
+   computeRangesRss(segments, pageMapReader, &changed);
+   computeRangesRss(callSites, pageMapReader, &changed);
+   for (auto& stacks : state._stackBatches)
+      computeRangesRss(stacks, pageMapReader, &changed);
+   state._maps.swap(maps);
+   state._round++;
+
+   summarizeSnapshot(state._maps, segments, true /*usePageMap*/, snapshot, progress);
+   snapshot._probedRssSize = probedRssBytes;
+   if (records)
+      {
+      collectAttributionRecords(state._maps, true /*usePageMap*/, *records);
+      AttributionRecord total;
+      total._stack = "#total";
+      total._virtualBytes = snapshot._totalVirtSize;
+      total._rssBytes = snapshot._totalRssSize;
+      records->push_back(total);
+      if (probedVirtualBytes != 0)
+         {
+         AttributionRecord probed;
+         probed._stack = "#probed";
+         probed._virtualBytes = probedVirtualBytes;
+         probed._rssBytes = probedRssBytes;
+         records->push_back(probed);
+         }
+      }
+   }
+
+void runSampler(const SamplerOptions& options, ostream& out)
+   {
+   PageMapReader pageMapReader(options._pid);
+   const string procDir = "/proc/" + to_string(options._pid);
+   const string mapsFilename = procDir + (options._useMapsTier ? "/maps" : "/smaps");
+
+   TrackedFile javacoreFile, callsitesFile;
+   vector<J9Segment> segments;
+   vector<ThreadStack> threadStacks; // as read from the javacore; annotation modifies a copy
+   vector<CallSite> callSites;
+   vector<RssAlert> alerts = options._alerts;
+   SamplerState state;
+   unique_ptr<SampleStore> store;
+   if (options._storeDirname)
+      store.reset(new SampleStore(options._storeDirname, true));
+   HeadroomForecast forecast(options._limitKB);
+   ostream noProgress(nullptr); // the progress messages of the readers would be repeated every sample
+
+   printHeader(out, options);
+   auto start = chrono::steady_clock::now();
+   for (unsigned long long sample = 0; options._numSamples == 0 || sample < options._numSamples; sample++)
+      {
+      if (!processExists(options._pid))
+         {
+         out << "Process " << options._pid << " is gone\n";
+         break;
+         }
+      auto sampleStart = chrono::steady_clock::now();
+      double cpuAtStart = cpuSecondsUsed();
+      unsigned long long readAtStart = bytesRead();
+      // A javacore or call-sites file that cannot be read (e.g. it is still being written)
+      // is reported and the previous one is kept; it is read again when it changes
+      string javacoreFilename = latestJavacore(options._javacorePath);
+      if (!javacoreFilename.empty() && javacoreFile.changed(javacoreFilename))
+         {
+         vector<J9Segment> newSegments;
+         vector<ThreadStack> newThreadStacks;
+         try
+            {
+            readJavacore(javacoreFilename.c_str(), newSegments, newThreadStacks, nullptr, nullptr, noProgress);
+            segments.swap(newSegments);
+            threadStacks.swap(newThreadStacks);
+            state._valid = false; // the maps point to the old segments
+            cerr << "Sampling with the segments of " << javacoreFilename << endl;
+            }
+         catch (const runtime_error& e)
+            {
+            cerr << "Keeping the previous segments: " << e.what() << endl;
+            }
+         }
+      if (options._callsitesFilename && callsitesFile.changed(options._callsitesFilename))
+         {
+         vector<CallSite> newCallSites;
+         try
+            {
+            readCallSitesFile(options._callsitesFilename, newCallSites, nullptr, noProgress);
+            callSites.swap(newCallSites);
+            state._valid = false;
+            }
+         catch (const runtime_error& e)
+            {
+            cerr << "Keeping the previous call-sites: " << e.what() << endl;
+            }
+         }
+
+      FootprintSnapshot snapshot;
+      vector<AttributionRecord> records;
+      try
+         {
+         sampleProcess(options, mapsFilename, pageMapReader, segments, threadStacks, callSites, state, snapshot, store ? &records : nullptr, noProgress);
+         if (store)
+            store->append(chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count(), records);
+         }
+      catch (const runtime_error& e)
+         {
+         // Most likely the process exited (or exec'ed) while it was being sampled
+         out << "Cannot sample process " << options._pid << ": " << e.what() << endl;
+         break;
+         }
+
+      auto now = chrono::steady_clock::now();
+      double cpuSec = cpuSecondsUsed() - cpuAtStart;
+      unsigned long long readBytes = bytesRead() - readAtStart;
+      unsigned long long elapsedSec = chrono::duration_cast<chrono::seconds>(now - start).count();
+      out << setw(10) << elapsedSec << setw(10) << (snapshot._totalRssSize >> 10);
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         out << setw(12) << (snapshot._rssSize[i] >> 10);
+      out << setw(9) << (unsigned long long)(cpuSec * 1000) << setw(10) << (readBytes >> 10) << setw(9) << state._numChangedMaps;
+      if (options._useMapsTier)
+         out << setw(11) << (snapshot._probedRssSize >> 10);
+      if (options._limitKB)
+         {
+         forecast.add(chrono::duration<double>(now - start).count(), snapshot);
+         out << "  " << forecast.summary();
+         }
+      out << endl;
+      checkAlerts(out, alerts, snapshot, elapsedSec);
+
+      if (options._numSamples != 0 && sample + 1 == options._numSamples)
+         break;
+      // Stretch the period when the sample used more than its share of CPU or I/O
+      double periodSec = options._intervalMs / 1000.0;
+      if (options._maxCpuPercent > 0)
+         periodSec = max(periodSec, cpuSec * 100.0 / options._maxCpuPercent);
+      if (options._maxReadKBPerSec > 0)
+         periodSec = max(periodSec, (double)readBytes / (options._maxReadKBPerSec << 10));
+      auto nextSample = sampleStart + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(periodSec));
+      if (periodSec > options._intervalMs / 1000.0)
+         cerr << "Sampling cost above the budget; next sample in " << (unsigned long long)(periodSec * 1000) << " ms\n";
+      this_thread::sleep_until(nextSample);
+      }
+   }
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _SAMPLER_HPP__
+#define _SAMPLER_HPP__
+#include <vector>
+#include <iostream>
+#include "AddrRange.hpp"
+
+// Raise an alert when the RSS of a category (or the total RSS) goes above a limit
+struct RssAlert
+   {
+   int _category;               // AddrRange::NUM_CATEGORIES stands for the total RSS
+   unsigned long long _limitKB;
+   bool _raised = false;        // alerts are reported when they are raised and when they clear
+   };
+
+// "category:limitKB", e.g. "DLL:200000" or "Total:4000000"; the category name is not case sensitive
+bool parseRssAlert(const char *spec, RssAlert& alert);
+
+// Continuous sampling of a live JVM.
+// Every interval the maps of the process are read, annotated with the segments of the
+// latest javacore (and call-sites) and reduced to per-category RSS, which is written as
+// one row of a time series. Two tiers are available:
+//  - smaps: /proc/PID/smaps gives the RSS of the maps; the pagemap gives the RSS of segments,
+//    call-sites and stacks
+//  - maps:  /proc/PID/maps and the pagemap only. The kernel does not walk the page tables to
+//    format the maps, and VMAs without access ("---p") are not read from the pagemap at all
+// The annotated maps are kept from one sample to the next: only new VMAs are annotated and only
+// the ranges in VMAs whose pages changed (by their smaps counters, or with maps by checksums of
+// their presence bits) are counted again, so the steady-state cost follows what changed.
+// The maps tier has no counters to tell which VMAs changed, so every sample still reads the
+// pagemap of one chunk in eight of every accessible VMA (all of it for VMAs under 16 MB with
+// 4 KB pages) and reads a VMA entirely when one of its probed chunks changed. A change confined
+// to chunks that were not probed is seen up to 7 samples later.
+// The CPU time and the bytes read by each sample are measured. When a sample costs more than
+// the budget allows, the next one is delayed so that the average stays within the budget
+struct SamplerOptions
+   {
+   int _pid = 0;
+   const char *_javacorePath = nullptr;   // a javacore file or a directory; the newest javacore*.txt is used
+   const char *_callsitesFilename = nullptr;
+   unsigned long long _intervalMs = 10000;
+   bool _useMapsTier = false;
+   double _maxCpuPercent = 1.0;            // of one CPU
+   unsigned long long _maxReadKBPerSec = 0; // 0 for no limit
+   unsigned long long _numSamples = 0;     // 0 to sample until the process exits
+   std::vector<RssAlert> _alerts;
+   const char *_storeDirname = nullptr;    // SampleStore that receives the attribution records of every sample
+   unsigned long long _limitKB = 0;        // container memory limit; every row forecasts the time to reach it
+   };
+
+void runSampler(const SamplerOptions& options, std::ostream& out);
+
+#endif // _SAMPLER_HPP__
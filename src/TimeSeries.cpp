@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <algorithm> // for sort
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <exception>
+#include <cstring> // for strlen
+#include <dirent.h> // for opendir/readdir
+#include "TimeSeries.hpp"
+#include "smap.hpp"
+#include "Javacore.hpp"
+#include "Attribution.hpp"
+#include "InputFormat.hpp"
+
+using namespace std;
+
+static bool startsWith(const string& str, const char *prefix)
+   {
+   return str.compare(0, strlen(prefix), prefix) == 0;
+   }
+
+// The key is what remains after removing the prefix and the separator that follows it
+static string snapshotKey(const string& fileName, const char *prefix)
+   {
+   size_t keyStart = strlen(prefix);
+   if (keyStart < fileName.size() && (fileName[keyStart] == '.' || fileName[keyStart] == '_'))
+      keyStart++;
+   return fileName.substr(keyStart);
+   }
+
+/**
+ * Scan a directory for javacore/smaps pairs.
+ * A javacore named javacore.<key>.txt is paired with the smaps file named smaps.<key>
+ * Files without a partner are ignored.
+*/
+void findSnapshotFiles(const char *dirName, vector<SnapshotFiles>& snapshotFiles)
+   {
+   DIR *dir = opendir(dirName);
+   if (!dir)
+      {
+      cerr << "Cannot open directory " << dirName << endl;
+      exit(-1);
+      }
+   map<string, SnapshotFiles> filesByKey; // sorted by key
+   string dirPath(dirName);
+   if (dirPath.back() != '/')
+      dirPath.push_back('/');
+   while (struct dirent *dirEntry = readdir(dir))
+      {
+      string name(dirEntry->d_name);
+      if (startsWith(name, "javacore"))
+         {
+         string key = snapshotKey(name, "javacore");
+         if (key.size() >= 4 && key.compare(key.size() - 4, 4, ".txt") == 0)
+            key.resize(key.size() - 4);
+         filesByKey[key]._javacoreFilename = dirPath + name;
+         }
+      else if (startsWith(name, "smaps"))
+         {
+         string key = snapshotKey(name, "smaps");
+         filesByKey[key]._smapsFilename = dirPath + name;
+         }
+      }
+   closedir(dir);
+
+   for (auto& entry : filesByKey)
+      {
+      if (entry.second._javacoreFilename.empty() || entry.second._smapsFilename.empty())
+         {
+         cerr << "Warning: ignoring unpaired snapshot file(s) with key '" << entry.first << "'\n";
+         continue;
+         }
+      entry.second._key = entry.first;
+      snapshotFiles.push_back(entry.second);
+      }
+   }
+
+// Parse one javacore/smaps pair and reduce it to per-category totals.
+// Throws std::runtime_error if one of the files cannot be read
+static void readSnapshot(const SnapshotFiles& files, FootprintSnapshot& snapshot, ostream& progress)
+   {
+   vector<J9Segment> segments;
+   vector<ThreadStack> threadStacks;
+   JavacoreInfo javacoreInfo;
+   readJavacore(files._javacoreFilename.c_str(), segments, threadStacks, nullptr, &javacoreInfo, progress);
+
+   snapshot._key = files._key;
+   snapshot._timestampMs = javacoreInfo._dumpTimeMs;
+   snapshot._jvmStartTimeMs = javacoreInfo._jvmStartTimeMs;
+   analyzeMapsFile(files._smapsFilename.c_str(), [&](auto& maps)
+      {
+      annotateMapWithSegments(maps, segments, progress);
+      annotateMapWithThreadStacks(maps, threadStacks, nullptr, progress);
+      summarizeSnapshot(maps, segments, false /*usePageMap*/, snapshot, progress);
+      }, progress);
+   }
+
+/**
+ * Read all the snapshots in parallel. Every snapshot is independent, so worker
+ * threads simply pick the next unprocessed snapshot until none is left.
+ * Each snapshot buffers its own progress messages, which are printed in snapshot
+ * order once all the workers are done. A snapshot that cannot be read is reported
+ * and left out, so one bad pair does not end the analysis of the others.
+ * On return, the snapshots are sorted by timestamp.
+*/
+void readSnapshots(const vector<SnapshotFiles>& snapshotFiles, vector<FootprintSnapshot>& snapshots)
+   {
+   snapshots.resize(snapshotFiles.size());
+   vector<ostringstream> progress(snapshotFiles.size());
+   vector<string> errors(snapshotFiles.size());
+   atomic<size_t> nextSnapshot(0);
+   auto worker = [&]()
+      {
+      for (size_t i = nextSnapshot++; i < snapshotFiles.size(); i = nextSnapshot++)
+         {
+         try
+            {
+            readSnapshot(snapshotFiles[i], snapshots[i], progress[i]);
+            }
+         catch (const exception& e)
+            {
+            errors[i] = e.what();
+            if (errors[i].empty())
+               errors[i] = "unknown error";
+            }
+         }
+      };
+   unsigned numThreads = min<size_t>(max(1u, thread::hardware_concurrency()), snapshotFiles.size());
+   vector<thread> threads;
+   for (unsigned t = 1; t < numThreads; t++)
+      threads.emplace_back(worker);
+   worker(); // the main thread works too
+   for (auto& t : threads)
+      t.join();
+
+   size_t numRead = 0;
+   for (size_t i = 0; i < snapshotFiles.size(); i++)
+      {
+      cout << progress[i].str();
+      if (!errors[i].empty())
+         {
+         cerr << "Skipping snapshot '" << snapshotFiles[i]._key << "': " << errors[i] << endl;
+         continue;
+         }
+      if (numRead != i)
+         snapshots[numRead] = move(snapshots[i]);
+      numRead++;
+      }
+   snapshots.resize(numRead);
+
+   stable_sort(snapshots.begin(), snapshots.end(),
+               [](const FootprintSnapshot& s1, const FootprintSnapshot& s2) { return s1._timestampMs < s2._timestampMs; });
+   }
+
+// Print one table (virtual or RSS) with one row per snapshot and one column per category.
+// Categories that are empty in all snapshots are omitted to keep the output compact
+static void printCategoryTable(const vector<FootprintSnapshot>& snapshots, bool printRss)
+   {
+   bool usedCategory[AddrRange::NUM_CATEGORIES] = {false};
+   for (auto& snapshot : snapshots)
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         if ((printRss ? snapshot._rssSize[i] : snapshot._virtualSize[i]) != 0)
+            usedCategory[i] = true;
+
+   cout << "\n" << (printRss ? "RSS" : "Virtual") << " (KB) over time:\n";
+   // Samples taken with maps count part of the RSS from presence bits that were only probed
+   bool printProbed = printRss && any_of(snapshots.begin(), snapshots.end(), [](const FootprintSnapshot& s) { return s._probedRssSize != 0; });
+   cout << setw(10) << "Elapsed(s)" << setw(12) << "Total";
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      if (usedCategory[i])
+         cout << setw(12) << AddrRange::RangeCategoryNames[i];
+   if (printProbed)
+      cout << setw(12) << "Probed";
+   cout << "  Snapshot\n";
+
+   unsigned long long startMs = snapshots.front()._timestampMs;
+   for (auto& snapshot : snapshots)
+      {
+      cout << setw(10) << (snapshot._timestampMs >= startMs ? (snapshot._timestampMs - startMs) / 1000 : 0) <<
+              setw(12) << ((printRss ? snapshot._totalRssSize : snapshot._totalVirtSize) >> 10);
+      for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+         if (usedCategory[i])
+            cout << setw(12) << ((printRss ? snapshot._rssSize[i] : snapshot._virtualSize[i]) >> 10);
+      if (printProbed)
+         cout << setw(12) << (snapshot._probedRssSize >> 10);
+      cout << "  " << snapshot._key << "\n";
+      }
+   }
+
+// Follow segments by id between consecutive snapshots and report, for each
+// snapshot, how many segments were allocated/freed and how many bytes moved
+static void printSegmentChurn(const vector<FootprintSnapshot>& snapshots)
+   {
+   cout << "\nSegment churn between consecutive snapshots (tracked by segment id):\n";
+   cout << setw(10) << "Elapsed(s)" << setw(8) << "Segs" << setw(8) << "New" << setw(8) << "Freed" <<
+           setw(12) << "NewKB" << setw(12) << "FreedKB" << setw(12) << "ResizedKB" << "  Largest growth\n";
+   unsigned long long startMs = snapshots.front()._timestampMs;
+   for (size_t s = 1; s < snapshots.size(); s++)
+      {
+      const vector<SegmentSample>& prev = snapshots[s-1]._segments;
+      const vector<SegmentSample>& crt = snapshots[s]._segments;
+      long long growth[AddrRange::NUM_CATEGORIES] = {0};
+      unsigned long long numNew = 0, numFreed = 0, newBytes = 0, freedBytes = 0;
+      long long resizedBytes = 0;
+      // Both vectors are sorted by id, so a merge finds the common segments in linear time
+      auto p = prev.cbegin(), c = crt.cbegin();
+      while (p != prev.cend() || c != crt.cend())
+         {
+         if (c == crt.cend() || (p != prev.cend() && p->_id < c->_id))
+            {
+            numFreed++;
+            freedBytes += p->_size;
+            growth[p->_category] -= p->_size;
+            ++p;
+            }
+         else if (p == prev.cend() || c->_id < p->_id)
+            {
+            numNew++;
+            newBytes += c->_size;
+            growth[c->_category] += c->_size;
+            ++c;
+            }
+         else
+            {
+            long long delta = (long long)c->_size - (long long)p->_size;
+            resizedBytes += delta;
+            growth[c->_category] += delta;
+            ++p; ++c;
+            }
+         }
+      int largest = 0;
+      for (int i = 1; i < AddrRange::NUM_CATEGORIES; i++)
+         if (growth[i] > growth[largest])
+            largest = i;
+      const FootprintSnapshot& snapshot = snapshots[s];
+      cout << setw(10) << (snapshot._timestampMs >= startMs ? (snapshot._timestampMs - startMs) / 1000 : 0) <<
+              setw(8) << crt.size() << setw(8) << numNew << setw(8) << numFreed <<
+              setw(12) << (newBytes >> 10) << setw(12) << (freedBytes >> 10) << setw(12) << (resizedBytes / 1024);
+      if (growth[largest] > 0)
+         cout << "  " << AddrRange::RangeCategoryNames[largest] << " +" << (growth[largest] >> 10) << " KB";
+      cout << "\n";
+      }
+   }
+
+void printTimeSeries(const vector<FootprintSnapshot>& snapshots)
+   {
+   if (snapshots.empty())
+      {
+      cout << "No javacore/smaps pairs or samples found\n";
+      return;
+      }
+   printCategoryTable(snapshots, false /*printRss*/);
+   printCategoryTable(snapshots, true /*printRss*/);
+   // Snapshots read from a sample store do not have segments
+   bool haveSegments = any_of(snapshots.begin(), snapshots.end(), [](const FootprintSnapshot& s) { return !s._segments.empty(); });
+   if (snapshots.size() > 1 && haveSegments)
+      printSegmentChurn(snapshots);
+   }
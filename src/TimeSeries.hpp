@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _TIMESERIES_HPP__
+#define _TIMESERIES_HPP__
+#include <string>
+#include <vector>
+#include <algorithm> // for sort
+#include "AddrRange.hpp"
+#include "Javacore.hpp"
+#include "Attribution.hpp"
+
+// The names of the smaps and javacore files collected at the same moment
+// share a key, e.g. smaps.20220331.150804.1234.0001 and javacore.20220331.150804.1234.0001.txt
+struct SnapshotFiles
+   {
+   std::string _key;
+   std::string _smapsFilename;
+   std::string _javacoreFilename;
+   };
+
+// Minimal information about a J9 segment needed to follow it across snapshots
+struct SegmentSample
+   {
+   unsigned long long _id; // 1STSEGMENT/1STHEAPREGION id
+   unsigned long long _size;
+   AddrRange::RangeCategories _category;
+   bool operator <(const SegmentSample& other) const { return _id < other._id; }
+   };
+
+// Per-category totals extracted from one javacore/smaps pair.
+// Only the summary is kept so that memory does not grow with the number of maps
+struct FootprintSnapshot
+   {
+   std::string _key;
+   unsigned long long _timestampMs = 0; // 0 if the javacore does not have a 1TIDATETIME line
+   unsigned long long _jvmStartTimeMs = 0; // 0 if the javacore does not have a 1CISTARTTIME line
+   unsigned long long _totalVirtSize = 0;
+   unsigned long long _totalRssSize = 0;
+   unsigned long long _virtualSize[AddrRange::NUM_CATEGORIES] = {0}; // bytes
+   unsigned long long _rssSize[AddrRange::NUM_CATEGORIES] = {0}; // bytes
+   unsigned long long _probedRssSize = 0; // part of the RSS that may be stale (sampler with maps, see sampleProcess)
+   std::vector<SegmentSample> _segments; // sorted by id
+   };
+
+// Reduce a set of annotated maps to per-category totals
+template <typename MAPENTRY>
+void summarizeSnapshot(const std::vector<MAPENTRY>& sMaps, const std::vector<J9Segment>& segments, bool usePageMap, FootprintSnapshot& snapshot,
+                       std::ostream& warnings = std::cerr)
+   {
+   for (auto crtMap = sMaps.cbegin(); crtMap != sMaps.cend(); ++crtMap)
+      {
+      snapshot._totalVirtSize += crtMap->size();
+      snapshot._totalRssSize += crtMap->getResidentSizeKB() << 10;
+      }
+   computeCategoryTotals(sMaps, usePageMap, snapshot._virtualSize, snapshot._rssSize, warnings);
+
+   snapshot._segments.reserve(segments.size());
+   for (auto seg = segments.cbegin(); seg != segments.cend(); ++seg)
+      snapshot._segments.push_back(SegmentSample{seg->getId(), seg->size(), seg->getRangeCategory()});
+   std::sort(snapshot._segments.begin(), snapshot._segments.end());
+   }
+
+void findSnapshotFiles(const char *dirName, std::vector<SnapshotFiles>& snapshotFiles);
+void readSnapshots(const std::vector<SnapshotFiles>& snapshotFiles, std::vector<FootprintSnapshot>& snapshots);
+void printTimeSeries(const std::vector<FootprintSnapshot>& snapshots);
+
+#endif // _TIMESERIES_HPP__
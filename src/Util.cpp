@@ -26,6 +26,7 @@
 #include <cstdlib> // for exit
 #include "Util.hpp"
 #include <stdexcept>
+#include <cctype> // for isdigit
 
 using namespace std;
 
@@ -63,7 +64,7 @@ void tokenize(const std::string& str, std::vector<std::string>& tokens, const ch
    }
 
 
-unsigned long long hex2ull(const std::string& hexNumber)
+unsigned long long hex2ull(std::string_view hexNumber)
    {
    unsigned long long res = 0;
    unsigned int start = 0;
@@ -71,7 +72,7 @@ unsigned long long hex2ull(const std::string& hexNumber)
       start += 2; // jump over 0x
    for (unsigned int i = start; i < hexNumber.size(); i++)
       {
-      unsigned char digit = hexNumber.at(i);
+      unsigned char digit = hexNumber[i];
       if (digit >= '0' && digit <= '9')
          res = (res << 4) + digit - '0';
       else if (digit >= 'A' && digit <= 'F')
@@ -87,12 +88,13 @@ unsigned long long hex2ull(const std::string& hexNumber)
    return res;
    }
 
-unsigned long long a2ull(const std::string& decimalNumber)
+// Thousands separators are skipped, so that "1,024" is 1024
+unsigned long long a2ull(std::string_view decimalNumber)
    {
    unsigned long long val = 0;
    for (unsigned int i = 0; i < decimalNumber.size(); i++)
       {
-      unsigned char digit = decimalNumber.at(i);
+      unsigned char digit = decimalNumber[i];
       if (digit == ',')
          continue;
       if (digit >= '0' && digit <= '9')
@@ -108,4 +110,48 @@ unsigned long long a2ull(const std::string& decimalNumber)
    return val;
    }
 
+// Convert a calendar date/time into milliseconds since 1970-01-01 00:00:00.
+// No time zone conversion is done, so all timestamps that are compared
+// with each other must come from the same time zone.
+unsigned long long civilTimeToMs(int year, int month, int day, int hour, int minute, int second, int millis)
+   {
+   // Days from civil algorithm: shift the year to start in March so that the leap day is last
+   year -= month <= 2;
+   const long long era = (year >= 0 ? year : year - 399) / 400;
+   const unsigned yearOfEra = (unsigned)(year - era * 400);
+   const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+   const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+   const long long days = era * 146097 + (long long)dayOfEra - 719468;
+   return (unsigned long long)((((days * 24 + hour) * 60 + minute) * 60 + second) * 1000 + millis);
+   }
 
+// Parse a timestamp that contains year, month, day, hour, minute, second and optionally
+// milliseconds, in this order, separated by non-digit characters. Examples:
+//    1TIDATETIME    Date: 2022/03/31 at 15:08:04:123
+//    2022-03-31T15:08:04.123
+// Returns 0 if the string does not contain a timestamp
+unsigned long long parseDateTimeMs(const std::string& dateTime)
+   {
+   int fields[7] = {0};
+   int numFields = 0;
+   size_t pos = 0;
+   while (numFields < 7)
+      {
+      pos = dateTime.find_first_of("0123456789", pos);
+      if (pos == string::npos)
+         break;
+      size_t startPos = pos;
+      int value = 0;
+      for (; pos < dateTime.size() && isdigit((unsigned char)dateTime[pos]); pos++)
+         value = value * 10 + (dateTime[pos] - '0');
+      // Skip digits that are part of a word (e.g. 1TIDATETIME), but not the
+      // date/time separator in 2022-03-31T15:08:04
+      if ((startPos > 1 && isalpha((unsigned char)dateTime[startPos-1]) && isalpha((unsigned char)dateTime[startPos-2])) ||
+          (pos + 1 < dateTime.size() && isalpha((unsigned char)dateTime[pos]) && isalpha((unsigned char)dateTime[pos+1])))
+         continue;
+      fields[numFields++] = value;
+      }
+   if (numFields < 6)
+      return 0;
+   return civilTimeToMs(fields[0], fields[1], fields[2], fields[3], fields[4], fields[5], fields[6]);
+   }
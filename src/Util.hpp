@@ -22,61 +22,109 @@
 #ifndef _UTIL_HPP__
 #define _UTIL_HPP__
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 #include <iostream>
+#include <algorithm> // for push_heap
+#include <type_traits> // for is_pointer_v
 
 static const unsigned long long HEX_CONVERT_ERROR = 0xffffffffffffffff;
 static const unsigned long long INT_CONVERT_ERROR = 0xffffffffffffffff;
 
 void error(const char * msg);
 void tokenize(const std::string& str, std::vector<std::string>& tokens, const char* delim = " \t\n");
-unsigned long long hex2ull(const std::string& hexNumber);
-unsigned long long a2ull(const std::string& decimalNumber);
+unsigned long long hex2ull(std::string_view hexNumber);
+unsigned long long a2ull(std::string_view decimalNumber);
+inline unsigned long long hex2ull(const std::string& hexNumber) { return hex2ull(std::string_view(hexNumber)); }
+inline unsigned long long a2ull(const std::string& decimalNumber) { return a2ull(std::string_view(decimalNumber)); }
+unsigned long long civilTimeToMs(int year, int month, int day, int hour, int minute, int second, int millis);
+unsigned long long parseDateTimeMs(const std::string& dateTime);
 
+// Adapts a "less than" comparator of T to pointers to T
+template<typename C>
+struct PointeeLess
+   {
+   C _comparator;
+   template<typename T>
+   bool operator() (const T* p1, const T* p2) const { return _comparator(*p1, *p2); }
+   };
+
+// Keeps the K largest elements seen so far according to the "less than" comparator C.
+// The elements live in a bounded min-heap, so processing an element is O(log K) and
+// only elements that make it into the heap are copied. For large objects instantiate
+// with pointers (and PointeeLess) so that only the pointers are kept.
+// Among equal elements the ones processed first are preferred.
 template<typename T, typename C>
-class TopTen
+class TopK
    {
-   std::list<T> _sortedList;
+   struct Entry
+      {
+      T _elem;
+      unsigned long long _seqNo; // order of arrival; breaks ties
+      };
+   std::vector<Entry> _heap; // the smallest of the top K is at the front
+   size_t _k;
+   unsigned long long _numProcessed = 0;
    C _comparator;
-public:
-   TopTen() {}
-   void processElement(const T& newElem)
+
+   // true if e1 ranks before e2 in the final, descending, order
+   bool ranksBefore(const Entry& e1, const Entry& e2) const
       {
-      if (_sortedList.size() == 10)
+      if (_comparator(e2._elem, e1._elem))
+         return true;
+      if (_comparator(e1._elem, e2._elem))
+         return false;
+      return e1._seqNo < e2._seqNo;
+      }
+   void insert(const T& elem, unsigned long long seqNo)
+      {
+      auto heapOrder = [this](const Entry& e1, const Entry& e2) { return ranksBefore(e1, e2); };
+      Entry entry{elem, seqNo};
+      if (_heap.size() < _k)
          {
-         if (_comparator(_sortedList.back(), newElem)) // need some specialized comparison
-            {
-            // Take the last element out
-            _sortedList.pop_back();
-            }
+         _heap.push_back(entry);
+         std::push_heap(_heap.begin(), _heap.end(), heapOrder);
          }
-      if (_sortedList.size() < 10)
+      else if (_k > 0 && ranksBefore(entry, _heap.front()))
          {
-         // Insert new element
-         bool inserted = false;
-         for (typename std::list<T>::iterator it = _sortedList.begin(); it != _sortedList.end(); ++it)
-            {
-            // Must go past the 
-            if (_comparator(*it, newElem))
-               {
-               _sortedList.insert(it, newElem);
-               inserted = true;
-               break;
-               }
-            } // end for
-         if (!inserted)
-            {
-            _sortedList.push_back(newElem);
-            }
+         std::pop_heap(_heap.begin(), _heap.end(), heapOrder);
+         _heap.back() = entry;
+         std::push_heap(_heap.begin(), _heap.end(), heapOrder);
          }
-      } // processElement
-
-   void print()
+      }
+public:
+   explicit TopK(size_t k = 10) : _k(k) { _heap.reserve(k); }
+   size_t getK() const { return _k; }
+   void processElement(const T& newElem) { insert(newElem, _numProcessed++); }
+   // Add the elements of a partial result, e.g. computed by another thread.
+   // Elements of 'other' rank after equal elements already processed by this object
+   void merge(const TopK& other)
       {
-      std::cout << "Top ten:\n";
-      for (typename std::list<T>::const_iterator it = _sortedList.cbegin(); it != _sortedList.cend(); ++it)
-         std::cout << *it << std::endl;
+      for (const Entry& entry : other._heap)
+         insert(entry._elem, _numProcessed + entry._seqNo);
+      _numProcessed += other._numProcessed;
       }
-   };
+   std::vector<T> getSortedElements() const // largest first
+      {
+      std::vector<Entry> sorted(_heap);
+      std::sort(sorted.begin(), sorted.end(), [this](const Entry& e1, const Entry& e2) { return ranksBefore(e1, e2); });
+      std::vector<T> elements;
+      elements.reserve(sorted.size());
+      for (const Entry& entry : sorted)
+         elements.push_back(entry._elem);
+      return elements;
+      }
+   void print() const
+      {
+      std::cout << "Top " << _k << ":\n";
+      for (const T& elem : getSortedElements())
+         {
+         if constexpr (std::is_pointer_v<T>)
+            std::cout << *elem << std::endl;
+         else
+            std::cout << elem << std::endl;
+         }
+      }
+   }; // TopK
 #endif
\ No newline at end of file
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring> // for memchr
+#include <stdexcept> // runtime_error
+#include "VerboseGC.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+// Minimal streaming reader for XML tags. Verbose GC logs can be several GB,
+// so the file is read in fixed size chunks and only the text of the current
+// tag (everything between '<' and '>') is kept in memory
+class XmlTagReader
+   {
+   ifstream     _file;
+   vector<char> _buffer;
+   size_t       _pos = 0; // next unprocessed character in _buffer
+   size_t       _end = 0; // number of valid characters in _buffer
+
+   bool fill()
+      {
+      if (!_file.good())
+         return false;
+      _file.read(_buffer.data(), _buffer.size());
+      _end = _file.gcount();
+      _pos = 0;
+      return _end != 0;
+      }
+   // Advance past the next occurrence of 'c', copying the skipped characters into 'text' if not null
+   bool skipPast(char c, string *text)
+      {
+      while (true)
+         {
+         if (_pos == _end && !fill())
+            return false;
+         const char *start = _buffer.data() + _pos;
+         const char *found = (const char *)memchr(start, c, _end - _pos);
+         size_t len = found ? found - start : _end - _pos;
+         if (text)
+            text->append(start, len);
+         _pos += len;
+         if (found)
+            {
+            _pos++; // jump over 'c'
+            return true;
+            }
+         }
+      }
+   public:
+   XmlTagReader(const char *filename) : _file(filename, ios::in | ios::binary), _buffer(1 << 20) {}
+   bool isOpen() const { return _file.is_open(); }
+   // Returns the text of the next tag without the angle brackets, or false at end of file
+   bool nextTag(string& tag)
+      {
+      tag.clear();
+      return skipPast('<', nullptr) && skipPast('>', &tag);
+      }
+   };
+
+// Returns true if the tag is an opening (or empty element) tag with the given name
+static bool isStartTag(const string& tag, const char *name)
+   {
+   size_t len = strlen(name);
+   return tag.compare(0, len, name) == 0 && (tag.size() == len || tag[len] == ' ' || tag[len] == '/' || tag[len] == '\n');
+   }
+
+// Extract the value of an attribute from the text of a tag, e.g. free="4194304"
+static bool getAttribute(const string& tag, const char *attrName, string& value)
+   {
+   string pattern = string(" ") + attrName + "=\"";
+   size_t pos = tag.find(pattern);
+   if (pos == string::npos)
+      return false;
+   pos += pattern.size();
+   size_t endPos = tag.find('"', pos);
+   if (endPos == string::npos)
+      return false;
+   value.assign(tag, pos, endPos - pos);
+   return true;
+   }
+
+/**
+ * Stream through a verbose GC log and, for every snapshot, remember the heap
+ * occupancy reported by the last GC that ended before the snapshot was taken.
+ * Snapshots must be sorted by timestamp. Memory usage does not depend on the
+ * size of the log. On return gcSamples has one entry for each snapshot.
+*/
+void correlateVerboseGCLog(const char *verboseGCFilename, const vector<FootprintSnapshot>& snapshots, vector<GCHeapSample>& gcSamples)
+   {
+   cout << "Reading verbose GC file: " << verboseGCFilename << endl;
+   XmlTagReader reader(verboseGCFilename);
+   if (!reader.isOpen())
+      {
+      throw runtime_error("Cannot open " + string(verboseGCFilename));
+      }
+   gcSamples.assign(snapshots.size(), GCHeapSample());
+
+   string tag, value;
+   GCHeapSample lastGC, crtGC;
+   bool inGCEnd = false;
+   bool memInfoFound = false;
+   unsigned long long numGCs = 0;
+   size_t crtSnapshot = 0;
+   while (reader.nextTag(tag) && crtSnapshot < snapshots.size())
+      {
+      if (isStartTag(tag, "gc-end"))
+         {
+         inGCEnd = true;
+         memInfoFound = false;
+         crtGC = GCHeapSample();
+         if (getAttribute(tag, "timestamp", value))
+            crtGC._timestampMs = parseDateTimeMs(value);
+         if (getAttribute(tag, "type", value))
+            crtGC._gcType = value;
+         }
+      else if (inGCEnd && !memInfoFound && isStartTag(tag, "mem-info"))
+         {
+         // Only the first mem-info in gc-end describes the entire heap
+         memInfoFound = true;
+         if (getAttribute(tag, "free", value))
+            crtGC._freeBytes = a2ull(value);
+         if (getAttribute(tag, "total", value))
+            crtGC._totalBytes = a2ull(value);
+         }
+      else if (inGCEnd && tag.compare(0, 7, "/gc-end") == 0)
+         {
+         inGCEnd = false;
+         if (!memInfoFound || !crtGC.valid())
+            continue;
+         // Snapshots taken before this GC ended are described by the previous GC
+         while (crtSnapshot < snapshots.size() && snapshots[crtSnapshot]._timestampMs < crtGC._timestampMs)
+            {
+            gcSamples[crtSnapshot] = lastGC;
+            gcSamples[crtSnapshot]._numGCsSincePrevious = numGCs;
+            numGCs = 0;
+            crtSnapshot++;
+            }
+         lastGC = crtGC;
+         numGCs++;
+         }
+      }
+   // Snapshots taken after the last GC in the log
+   for (; crtSnapshot < snapshots.size(); crtSnapshot++)
+      {
+      gcSamples[crtSnapshot] = lastGC;
+      gcSamples[crtSnapshot]._numGCsSincePrevious = numGCs;
+      numGCs = 0;
+      }
+   }
+
+/**
+ * Compare the RSS of the Java heap with the occupancy after the last GC.
+ * Resident memory that is committed to the heap but held no live objects at the
+ * last GC is the footprint that -Xsoftmx and idle tuning can give back to the OS.
+*/
+void printHeapOccupancy(const vector<FootprintSnapshot>& snapshots, const vector<GCHeapSample>& gcSamples)
+   {
+   cout << "\nJava heap RSS compared to the occupancy after the last GC (KB):\n";
+   cout << setw(10) << "Elapsed(s)" << setw(12) << "HeapVirt" << setw(12) << "HeapRSS" << setw(12) << "Committed" <<
+           setw(12) << "Live" << setw(12) << "Free" << setw(12) << "RSSnotLive" << setw(8) << "GCs" << setw(10) << "GCage(s)" << "  LastGC\n";
+   unsigned long long startMs = snapshots.empty() ? 0 : snapshots.front()._timestampMs;
+   for (size_t i = 0; i < snapshots.size(); i++)
+      {
+      const FootprintSnapshot& snapshot = snapshots[i];
+      const GCHeapSample& gc = gcSamples[i];
+      unsigned long long heapRss = snapshot._rssSize[AddrRange::JAVAHEAP];
+      cout << setw(10) << (snapshot._timestampMs >= startMs ? (snapshot._timestampMs - startMs) / 1000 : 0) <<
+              setw(12) << (snapshot._virtualSize[AddrRange::JAVAHEAP] >> 10) << setw(12) << (heapRss >> 10);
+      if (!gc.valid())
+         {
+         cout << "  no GC before this snapshot\n";
+         continue;
+         }
+      // Resident heap memory in excess of the live data is committed but free
+      unsigned long long rssNotLive = heapRss > gc.liveBytes() ? heapRss - gc.liveBytes() : 0;
+      cout << setw(12) << (gc._totalBytes >> 10) << setw(12) << (gc.liveBytes() >> 10) << setw(12) << (gc._freeBytes >> 10) <<
+              setw(12) << (rssNotLive >> 10) << setw(8) << gc._numGCsSincePrevious <<
+              setw(10) << (snapshot._timestampMs >= gc._timestampMs ? (snapshot._timestampMs - gc._timestampMs) / 1000 : 0) <<
+              "  " << gc._gcType << "\n";
+      }
+   cout << "RSSnotLive is resident heap memory that held no live objects at the last GC\n";
+   }
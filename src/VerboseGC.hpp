@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+#ifndef _VERBOSEGC_HPP__
+#define _VERBOSEGC_HPP__
+#include <string>
+#include <vector>
+#include "TimeSeries.hpp"
+
+/*
+Heap occupancy reported by the last GC that ended before a snapshot was taken.
+The information comes from the <mem-info> element of <gc-end> in -Xverbosegclog:
+<gc-end id="10" type="scavenge" contextid="4" durationms="1.234" ... timestamp="2022-03-31T15:08:04.123">
+  <mem-info id="11" free="4194304" total="8388608" percent="50">
+*/
+struct GCHeapSample
+   {
+   unsigned long long _timestampMs = 0; // 0 if no GC ended before the snapshot
+   unsigned long long _freeBytes = 0;
+   unsigned long long _totalBytes = 0; // committed heap
+   unsigned long long _numGCsSincePrevious = 0; // GCs between the previous snapshot and this one
+   std::string        _gcType;
+   bool valid() const { return _timestampMs != 0; }
+   unsigned long long liveBytes() const { return _totalBytes - _freeBytes; }
+   };
+
+// Throws std::runtime_error if the file cannot be read
+void correlateVerboseGCLog(const char *verboseGCFilename, const std::vector<FootprintSnapshot>& snapshots, std::vector<GCHeapSample>& gcSamples);
+void printHeapOccupancy(const std::vector<FootprintSnapshot>& snapshots, const std::vector<GCHeapSample>& gcSamples);
+
+#endif // _VERBOSEGC_HPP__
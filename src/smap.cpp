@@ -26,26 +26,14 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
-//#include <ctype> // isdigit
+#include <cctype> // isdigit
+#include <stdexcept> // runtime_error
 #include "smap.hpp"
 #include "Util.hpp"
+#include "ClassificationRules.hpp"
 
 using namespace std;
 
-void SmapEntry::setPurpose(SmapPurpose purpose)
-   {
-   if (_purpose == UNKNOWN)
-      {
-      _purpose = purpose;
-      }
-   else if (_purpose != purpose)
-      {
-      cerr << "Error: Setting _purpose to '" << _purposeNames[purpose] << "' but purpose already set to '" << _purposeNames[_purpose] << "' for " << *this << endl;
-      cerr << "Exiting" << endl;
-      exit(EXIT_FAILURE);
-      }
-   }
-
 /* The entry in a maps file is short version of the smaps entry
    Example
    000c0000-000c1000 ---p 000c0000 00:00 0
@@ -53,6 +41,7 @@ void SmapEntry::setPurpose(SmapPurpose purpose)
    00400000-00401000 r-xp 00000000 00:17 61571540                           /jtctest/sdk_installs/ESPRESSO/PKG/pxz3170_27/pxz3170_27-20131030_03/ibm-java-s390-71/jre/bin/java
    00401000-00402000 rw-p 00000000 00:17 61571540                           /jtctest/sdk_installs/ESPRESSO/PKG/pxz3170_27/pxz3170_27-20131030_03/ibm-java-s390-71/jre/bin/java
 */
+int parseSmapsMainLine(string line, SmapEntry &entry);
 bool readMapsEntry(ifstream& smap, SmapEntry &entry)
    {
    string line;
@@ -64,39 +53,23 @@ bool readMapsEntry(ifstream& smap, SmapEntry &entry)
       if (line.find_first_not_of(" \t\n") == string::npos)
          continue;
 
-      // Line starts with an address range and ends with MMUPageSize: heading
-      std::cmatch result; //start    -  end        protection     offset      device major:minor   inode     file
-      std::regex pattern("([0-9a-f]+)-([0-9a-f]+) (\\S\\S\\S\\S) ([0-9a-f]+) ([0-9a-f]+:[0-9a-f]+) (\\d+)\\s*(\\S*)");
-      if (std::regex_search(line.c_str(), result, pattern))
-         {
-         //cerr << "Match found: start=" << result[1] << " end=" << result[2] << endl;
-         entry.setStart(hex2ull(result[1]));
-         entry.setEnd(hex2ull(result[2]));
-         entry._details.assign(result[7]);
+      // The maps line has the same format as the main line of an smaps entry
+      if (parseSmapsMainLine(line, entry) == 0)
          return true;
-         }
-      else
-         {
-         cerr << "No match for:" << line << endl;
-         return false;
-         }
+      cerr << "No match for:" << line << endl;
+      return false;
       }
    return false;
    }
 
-void readMapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps)
+void readMapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps, ostream& progress)
    {
-#ifdef DEBUG
-   cout << "Reading file: " << string(smapsFilename) << endl;
-#endif
+   progress << "Reading maps file: " << string(smapsFilename) << endl;
    // Open the file
    ifstream myfile(smapsFilename);
    // check if successfull
    if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << smapsFilename << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot open " + string(smapsFilename));
 
    SmapEntry entry;
    bool result;
@@ -106,6 +79,7 @@ void readMapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps)
       if (result)
          smaps.push_back(entry);
       } while (result);
+   progress << "maps files have no RSS information; use the page map (-p) to compute it" << endl;
    }
 
 
@@ -171,11 +145,16 @@ VmFlags: rd ex mr mw me dw    ==> This is a new field that doesn't have the form
 //---------------------------------------------------------------
 int parseSmapsMainLine(string line, SmapEntry &entry)
    {
+   // Every line is tried as a main line; the detail lines ("Rss:", "AnonHugePages:") never
+   // start with a lower case hex digit, so most of them are rejected without the regex
+   if (line.empty() || !(isdigit((unsigned char)line[0]) || (line[0] >= 'a' && line[0] <= 'f')))
+      return -1;
    try
       {
       // Line starts with an address range
       std::cmatch result; //start    -  end        protection     offset      device major:minor   inode     file
-      std::regex pattern("([0-9a-f]+)-([0-9a-f]+) (\\S\\S\\S\\S) ([0-9a-f]+) ([0-9a-f]+:[0-9a-f]+) (\\d+)\\s*(\\S*)");
+      // Compiled once; the sampler reads smaps again and again
+      static const std::regex pattern("([0-9a-f]+)-([0-9a-f]+) (\\S\\S\\S\\S) ([0-9a-f]+) ([0-9a-f]+:[0-9a-f]+) (\\d+)\\s*(\\S*)");
 
       if (std::regex_search(line.c_str(), result, pattern))
          {
@@ -183,15 +162,11 @@ int parseSmapsMainLine(string line, SmapEntry &entry)
          entry.setStart(hex2ull(result[1]));
          entry.setEnd(hex2ull(result[2]));
          entry._protection.assign(result[3]);
+         entry._offset = hex2ull(result[4]);
+         entry._inode = a2ull(result[6]);
          entry._details.assign(result[7]);
-         if (entry.isMapForSharedLibrary())
-            entry.setPurpose(SmapEntry::DLL);
-         if (entry.isMapForThreadStack())
-            entry.setPurpose(SmapEntry::STACK);
-         if (entry.getDetailsString().find("javasharedresources") != string::npos || // found
-             entry.getDetailsString().find("classCache") != string::npos ||
-             entry.getDetailsString().find(".scc") != string::npos)
-            entry.setPurpose(SmapEntry::SCC);
+         // Shared libraries, thread stacks, the shared class cache and custom categories
+         classifyMap(entry);
          return 0;
          }
       else
@@ -226,9 +201,7 @@ int parseSmapsDetailedEntry(string line, SmapEntry &entry)
       return -1;
       }
    if (tokens[2] != "kB")
-      {
-      cerr << "smap line must use kB as units. Line: " << line << endl; exit(-1);
-      }
+      throw runtime_error("smap line must use kB as units. Line: " + line);
    // Decode the entry type
    if (tokens[0] == "Size")
       {
@@ -250,6 +223,26 @@ int parseSmapsDetailedEntry(string line, SmapEntry &entry)
       {
       entry._pss = atoi(tokens[1].c_str());
       }
+   else if (tokens[0] == "Shared_Clean")
+      {
+      entry._sharedClean = atoi(tokens[1].c_str());
+      }
+   else if (tokens[0] == "Shared_Dirty")
+      {
+      entry._sharedDirty = atoi(tokens[1].c_str());
+      }
+   else if (tokens[0] == "Private_Clean")
+      {
+      entry._privateClean = atoi(tokens[1].c_str());
+      }
+   else if (tokens[0] == "Private_Dirty")
+      {
+      entry._privateDirty = atoi(tokens[1].c_str());
+      }
+   else if (tokens[0] == "Swap")
+      {
+      entry._swap = atoi(tokens[1].c_str());
+      }
    else if (tokens[0] == "KernelPageSize")
       {
       entry._kernelPageSize = atoi(tokens[1].c_str());
@@ -262,17 +255,14 @@ int parseSmapsDetailedEntry(string line, SmapEntry &entry)
    }
 
 //-----------------------------------------------------------------
-void readSmapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps)
+void readSmapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps, ostream& progress)
    {
-   cout << "Reading smaps file: " << string(smapsFilename) << endl;
+   progress << "Reading smaps file: " << string(smapsFilename) << endl;
    // Open the file
    ifstream myfile(smapsFilename);
    // check if successfull
    if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << smapsFilename << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot open " + string(smapsFilename));
 
    SmapEntry entry, tmpEntry;
    string line;
@@ -310,18 +300,14 @@ void readSmapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps)
          if (mainLineInEffect)
             {
             if (parseSmapsDetailedEntry(line, entry) < 0)
-               {
-               cerr << "Error parsing line " << lineNo << ": " << line << endl;
-               cerr << "We expected a line of the form: String Number String. Example: Private_Dirty:        0 kB";
-               exit(-1);
-               }
+               throw runtime_error("Error parsing line " + to_string(lineNo) + ": " + line +
+                                   "\nWe expected a line of the form: String Number String. Example: Private_Dirty:        0 kB");
             continue; // read next line
             }
          else // This must some error; we cannot start processing a detailed entry without having a main entry first
             {
-            cerr << "Error with line " << lineNo << ": " << line << endl;
-            cerr << "Details line without any main line (should start with a digit). Exiting\n";
-            exit(-1);
+            throw runtime_error("Error with line " + to_string(lineNo) + ": " + line +
+                                "\nDetails line without any main line (should start with a digit)");
             }
          }
       } // while (smap.good())
@@ -337,7 +323,7 @@ void printLargestUnallocatedBlocks(const vector<SmapEntry> &smaps)
    unsigned long long virtSize = 0;
    unsigned long long rssSize = 0;
    unsigned long long totalGapSize = 0;
-   TopTen<AddrRange, AddrRangeSizeLessThan> topTen;
+   TopK<AddrRange, AddrRangeSizeLessThan> topTen;
 
    auto crtMap = smaps.cbegin();
    if (crtMap != smaps.cend())
@@ -380,7 +366,7 @@ unsigned long long computeReservedSpaceKB(const vector<SmapEntry> &smaps)
          exit(1);
          }
       // Reserved lines start with ---
-      if (protection[0] == '-' && protection[1] == '-' && protection[2] == '-')
+      if (crtMap->isReservedOnly())
          {
          reservedSpaceKB += crtMap->sizeKB();
          //cout << "Found reserved block: " << *crtMap << " Protection=" << protection << endl;
@@ -392,56 +378,14 @@ unsigned long long computeReservedSpaceKB(const vector<SmapEntry> &smaps)
 //-------------------------------------------------------------
 void printTopTenReservedSpaceKB(const vector<SmapEntry> &smaps)
    {
-   TopTen<SmapEntry, MemoryEntrySizeLessThan> topTen;
+   TopK<const SmapEntry*, PointeeLess<MemoryEntrySizeLessThan>> topTen;
    // Reserved space does not have read, write or execute access
    for (vector<SmapEntry>::const_iterator crtMap = smaps.begin(); crtMap != smaps.end(); ++crtMap)
       {
-      const string& protection = crtMap->getProtectionString();
       // Reserved lines start with ---
-      if (protection[0] == '-' && protection[1] == '-' && protection[2] == '-')
-         topTen.processElement(*crtMap);
+      if (crtMap->isReservedOnly())
+         topTen.processElement(&*crtMap);
       }
    topTen.print();
    }
 
-//-----------------------------------------------------------
-bool SmapEntry::isMapForSharedLibrary() const
-   {
-   // A shared library has .so in its name
-   // Note that the name does not necessarily end with .so  Example: /usr/lib/libXext.so.6.4.0
-   // Also note that there for each DLL there are 4 smaps: one with protection "rx-p",
-   // one with protection "---p", one with protection "r--p" and one with protection "rw-p"
-   const std::string details = getDetailsString();
-   size_t soPosition = details.find(".so");
-   if (soPosition != string::npos) // found
-      {
-      // We should add more checks here: the ".so" fragment must be followed by a space, a dot, a newline or simply end the string
-      soPosition += 3; // jump over the .so characters
-      if (details.size() <= soPosition ||  // line ends with ".so" but no endl
-         details.at(soPosition) == '.' ||  // e.g. /usr/lib/libXext.so.6.4.0
-         details.at(soPosition) == ' ' ||
-         details.at(soPosition) == '\t' ||
-         details.at(soPosition) == '\n' ||
-         details.at(soPosition) == '\r')
-         return true;
-      }
-   return false;
-   }
-
-//---------------------------------------------------------------
-// The details field may contain something like [stack:28189]
-bool SmapEntry::isMapForThreadStack() const
-   {
-   return (getDetailsString().find("[stack") == 0); // check if it starts with [stack
-   }
-
-//--------------------------------------------------------
-void SmapEntry::print(std::ostream& os) const
-   {
-   os << std::hex << "Start=" << setfill('0') << setw(16) << getStart() <<
-      " End=" << setfill('0') << setw(16) << getEnd() << std::dec <<
-      " Size=" << setfill(' ') << setw(6) << sizeKB() << " rss=" << setfill(' ') << setw(6) << _rss << " Prot=" << getProtectionString();
-   if (_details.length() > 0)
-      os << " " << _details;
-   }
-
@@ -49,32 +49,9 @@ class SmapEntry : public MemoryEntry
       int _swap;
       int _kernelPageSize;
       int _mmuPageSize;
+      unsigned long long _offset; // offset in the mapped file
+      unsigned long long _inode;  // inode of the mapped file; 0 for anonymous memory
 
-   // Some smaps contain allocations for a single purpose, such as the java heap, stack, or code cache.
-   // If an smap is for a single purpose, we can use this enum to identify the purpose.
-   // Otherwise, the purpose is GENERIC.
-   // For smaps with a single purpose we can get RSS directly from the smap and don't have to read the page map
-   enum SmapPurpose {
-      UNKNOWN = 0,
-      GENERIC,
-      JAVAHEAP,
-      DLL,
-      STACK,
-      CODECACHE,
-      SCC
-   };
-   static constexpr const char * const _purposeNames[] = {
-      "UNKNOWN",
-      "GENERIC",
-      "JAVAHEAP",
-      "DLL",
-      "STACK",
-      "CODECACHE",
-      "SCC"
-   };
-   private:
-      SmapPurpose _purpose;
-      //bool _mapForJavaHeap; // may turn to 'true' when we discover the smap is used for Java heap
    public:
       SmapEntry() { clear(); }
       virtual void clear()
@@ -82,14 +59,18 @@ class SmapEntry : public MemoryEntry
          MemoryEntry::clear();
          _pss = 0; _sharedClean = 0; _sharedDirty = 0;
          _privateClean = 0; _privateDirty = 0; _swap = 0; _kernelPageSize = 0; _mmuPageSize = 0;
-         _purpose = UNKNOWN;
+         _offset = 0; _inode = 0;
          }
-      SmapPurpose getPurpose() const { return _purpose; }
-      void setPurpose(SmapPurpose purpose);
-      bool isMapForSharedLibrary() const;
-      bool isMapForThreadStack() const;
-   protected:
-      virtual void print(std::ostream& os) const;
+      // Decided by the classification rules when the map is read
+      bool isMapForSharedLibrary() const { return getPurpose() == DLL; }
+      bool isMapForThreadStack() const { return getPurpose() == STACK; }
+      // Rss split by whether the pages are mapped by this process only
+      unsigned long long privateResidentKB() const { return _privateClean + _privateDirty; }
+      unsigned long long sharedResidentKB() const { return _sharedClean + _sharedDirty; }
+      // Address space reserved with PROT_NONE ("---p") has no read, write or execute access and is not committed
+      bool isReservedOnly() const { return _protection.size() >= 3 && _protection.compare(0, 3, "---") == 0; }
+      unsigned long long reservedKB() const { return sizeKB(); }
+      unsigned long long committedKB() const { return isReservedOnly() ? 0 : sizeKB(); }
    private:
       inline static bool endsWith(const std::string & str, const std::string & suffix)
          {
@@ -98,8 +79,10 @@ class SmapEntry : public MemoryEntry
    };
 
 
-void readSmapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps);
-void readMapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps);
+// The readers throw std::runtime_error if the file cannot be read or parsed. The progress
+// messages go to 'progress', so that a reader running on its own thread can buffer them
+void readSmapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps, std::ostream& progress = std::cout);
+void readMapsFile(const char *smapsFilename, std::vector<SmapEntry>& smaps, std::ostream& progress = std::cout);
 void printLargestUnallocatedBlocks(const std::vector<SmapEntry> &smaps);
 unsigned long long printSpaceKBTakenBySharedLibraries(const std::vector<SmapEntry> &smaps);
 unsigned long long computeReservedSpaceKB(const std::vector<SmapEntry> &smaps);
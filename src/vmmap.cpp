@@ -21,36 +21,56 @@
  *******************************************************************************/
 #include <vector>
 #include <string>
+#include <string_view>
+#include <map>
 #include <regex>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <cassert>
+#include <stdexcept> // runtime_error
 //#include <ctype> // isdigit
 #include "vmmap.hpp"
+#include "InputFormat.hpp"
+#include "MappedFile.hpp"
+#include "Attribution.hpp"
+#include "ClassificationRules.hpp"
 #include "CallSites.hpp"
 #include "Util.hpp"
 
 using namespace std;
 //#define DEBUG
 
-bool tokenizeVmmapLine(const string& line, vector<string>& tokens)
+// Images and thread stacks are typed by vmmap itself; the shared class cache
+// and custom categories are recognized by name, like for smaps
+static void setPurposeFromType(VmmapEntry& entry)
    {
+   if (entry.isMapForSharedLibrary())
+      entry.setPurpose(VmmapEntry::DLL);
+   else if (entry.isMapForThreadStack())
+      entry.setPurpose(VmmapEntry::STACK);
+   else
+      classifyMap(entry);
+   }
+
+bool tokenizeVmmapLine(string_view line, vector<string_view>& tokens)
+   {
+   tokens.clear();
    size_t lastPos = 0;
    size_t lineSize = line.size();
    while(lastPos < lineSize)
       {
       // Find the starting quote
-      size_t startOfToken = line.find_first_of('"', lastPos);
-      if (startOfToken == string::npos)
+      size_t startOfToken = line.find('"', lastPos);
+      if (startOfToken == string_view::npos)
          {
          cerr << "Cannot find starting quote" << endl;
          return false;
          }
       startOfToken++; // move past the quote
       // Find the ending quote
-      size_t endOfToken = line.find_first_of('"', startOfToken);
-      if (endOfToken == string::npos)
+      size_t endOfToken = line.find('"', startOfToken);
+      if (endOfToken == string_view::npos)
          {
          cerr << "Cannot find ending quote while searching from position" << startOfToken << endl;
          return false;
@@ -66,8 +86,9 @@ bool tokenizeVmmapLine(const string& line, vector<string>& tokens)
 // This is used for vmmap files in text format where fields start at fixed positions
 // The positions of these fields can be given by the postion of the headings
 // We use an array of these postions as input
-bool tokenizeVmmapTextLine(const string& line, vector<string>& tokens, const vector<size_t>& fieldPositions)
+bool tokenizeVmmapTextLine(string_view line, vector<string_view>& tokens, const vector<size_t>& fieldPositions)
    {
+   tokens.clear();
    size_t lineSize = line.size();
 #ifdef DEBUG
    cout << "tokenizeVmmapTextLine(" << lineSize << "):" << line << endl;
@@ -76,176 +97,111 @@ bool tokenizeVmmapTextLine(const string& line, vector<string>& tokens, const vec
    size_t numFields = fieldPositions.size();
    for (size_t fieldNo = 0; fieldNo < numFields-1; fieldNo++) // going up to numFields-1 because the last one is a dummy one
       {
-#ifdef DEBUG
-      cout << "fieldNo=" << fieldNo << endl;
-#endif
-      size_t startPosInLine = fieldPositions.at(fieldNo);
-      size_t endPosInLine = fieldPositions.at(fieldNo + 1); // No overflow due to how fieldPositions is constructed (one extra element which could be npos)
-#ifdef DEBUG
-      cout << "  startPosInLine=" << startPosInLine << endl;
-      cout << "  endPosInLine=" << endPosInLine << endl;
-#endif
+      size_t startPosInLine = fieldPositions[fieldNo];
+      size_t endPosInLine = fieldPositions[fieldNo + 1]; // No overflow due to how fieldPositions is constructed (one extra element which could be npos)
       // The last field (Description) could be completely missing
       if (startPosInLine > lineSize)
          {
-         tokens.push_back("");
-#ifdef DEBUG
-         cout << "    Field=" << "" << endl;
-#endif
+         tokens.push_back(string_view());
          continue;
          }
 
-      // Read field by extracting substring bewteen startPos and endPos
-      // and strip leading and trailing spaces
-      string token = line.substr(startPosInLine, endPosInLine - startPosInLine);
-#ifdef DEBUG
-      cout << "    Field(" << token.size() << ")=" << token << endl;
-#endif
-
+      // Read field between startPos and endPos and strip leading and trailing spaces
+      string_view token = line.substr(startPosInLine, endPosInLine - startPosInLine);
       size_t startToken = token.find_first_not_of(" \t\n\r");
-      if (startToken != string::npos) // if my string has some non-white chars
+      if (startToken != string_view::npos) // if my string has some non-white chars
          {
          size_t endToken = token.find_last_not_of(" \t\n\r");
-         //assert(endToken != string::npos);
          tokens.push_back(token.substr(startToken, endToken - startToken + 1));
          }
       else
          {
-#ifdef DEBUG
-         cout << "Pushing empty string\n";
-#endif
-         tokens.push_back("");
+         tokens.push_back(string_view());
          }
       }
    // TODO should return false, if the line is too short or too long than assumed
+   return true;
+   }
+
+// Fill 'entry' from the fields of a main (not sub-block) vmmap line:
+// "Address","Type","Size","Committed","Private","Total WS","Private WS","Shareable WS","Shared WS","Locked WS","Blocks","Protection","Details",
+static void parseVmmapFields(const vector<string_view>& tokens, string_view line, VmmapEntry& entry)
+   {
+   unsigned long long start = hex2ull(tokens[0]);
+   if (start == HEX_CONVERT_ERROR)
+      throw runtime_error("Error with start address on line: " + string(line));
 #ifdef DEBUG
-   cout << "tokenizeVmmapTextLine ending" << line << endl;
+   cout << "Tokens: ";
+   for (auto it = tokens.cbegin(); it != tokens.cend(); ++it)
+      cout << *it << " ";
+   cout << endl;
 #endif
-   return true;
+   entry.clear();
+   entry.setStart(start);
+   entry._type = tokens[1];
+   unsigned long long size = a2ull(tokens[2]);
+   entry.setEnd(start + (size << 10));
+   entry._committed = a2ull(tokens[3]);
+   entry._rss = a2ull(tokens[5]);
+   entry._privateWS = a2ull(tokens[6]);
+   entry._shareableWS = a2ull(tokens[7]);
+   entry._sharedWS = a2ull(tokens[8]);
+   entry._lockedWS = a2ull(tokens[9]);
+   entry._numBlocks = a2ull(tokens[10]);
+   entry._protection = tokens[11];
+   entry._details = tokens[12];
+   setPurposeFromType(entry);
    }
 
-void readVmmapTextFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps)
+void readVmmapTextFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& progress)
    {
    unsigned long long virtSize = 0;
    unsigned long long rssSize = 0;
-   cout << "Reading map file: " << string(vmmapFilename) << endl;
-   // Open the file
-   ifstream myfile(vmmapFilename);
-   // check if successfull
-   if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << vmmapFilename << endl;
-      exit(-1);
-      }
+   progress << "Reading map file: " << string(vmmapFilename) << endl;
+   MappedFile myfile;
+   if (!myfile.open(vmmapFilename))
+      throw runtime_error("Cannot open " + string(vmmapFilename));
    // First we need to get to the header that looks like this
-   // "Address","Type","Size","Committed","Private","Total WS","Private WS","Shareable WS","Shared WS","Locked WS","Blocks","Protection","Details",
    //Address    Type                  Size        Committed  Private    Total WS   Private WS  Shareable WS  Shared WS  Locked WS  Blocks  Protection           Details
+   // The fields of the following lines start at the same position as their headings
+   static const char * const headings[] = { "Address", "Type", "Size", "Committed", "Private", "Total WS", "Private WS",
+                                            "Shareable WS", "Shared WS", "Locked WS", "Blocks", "Protection", "Details" };
+   LineReader lines(myfile.contents());
    int lineNo = 0;
-   string line;
+   string_view line;
    bool headerFound = false;
    vector<size_t> fieldPositions;
-   while (myfile.good())
+   while (lines.nextLine(line))
       {
-      getline(myfile, line); lineNo++;
+      lineNo++;
 #ifdef DEBUG
       cout << "readVmmapFile looking at :" << line << endl;
 #endif
-      size_t startPos = line.find("Address");
-
-      if (std::string::npos != startPos)
+      if (line.find(headings[0]) == string_view::npos)
+         continue;
+      for (auto heading : headings)
          {
-         fieldPositions.push_back(startPos);
-         // Now find all the other fields memorizing their start position
-         startPos = line.find("Type");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Size");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Committed");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Private");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Total WS");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Private WS");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Shareable WS");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Shared WS");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Locked WS");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Blocks");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
+         size_t startPos = line.find(heading);
+         if (startPos == string_view::npos)
             break; // will signal error
-
-         startPos = line.find("Protection");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         startPos = line.find("Details");
-         if (std::string::npos != startPos)
-            fieldPositions.push_back(startPos);
-         else
-            break; // will signal error
-
-         //fieldPositions.push_back(line.find_last_not_of(" \t\n\r")); // could be npos
+         fieldPositions.push_back(startPos);
+         }
+      if (fieldPositions.size() == sizeof(headings) / sizeof(headings[0]))
+         {
          fieldPositions.push_back(string::npos);
-
          headerFound = true;
-         break;
          }
+      break;
       }
    if (!headerFound)
-      {
-      cerr << "Cannot find header line in expected format\n" << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot find header line in expected format");
 
    // Now read all entries
    VmmapEntry entry;
-   while (myfile.good())
+   vector<string_view> tokens;
+   while (lines.nextLine(line))
       {
-      getline(myfile, line); lineNo++;
+      lineNo++;
       // skip empty lines or lines that do not start with some character (subblock start with ampty space)
       if (line.find_first_not_of(" \t\n\r") != 0)
          continue;
@@ -253,213 +209,191 @@ void readVmmapTextFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps)
 #ifdef DEBUG
       cout << "readVmmapEntry looking at line " << lineNo << " with " << line.size() << " characters: " << line << endl;
 #endif
-
-      std::vector<std::string> tokens; // we should do tokens(13)
-
       if (!tokenizeVmmapTextLine(line, tokens, fieldPositions))
-         exit(-1); // some error occurred
+         throw runtime_error("Cannot tokenize vmmap line: " + string(line));
       // We must find exactly 13 items
       if (tokens.size() != 13)
-         {
-         cerr << "Must find exactly 13 tokens for vmmap line: " << line << endl;
-         exit(-1);
-         }
-
-      // If the start address starts with a number it's a main entry, otherwise it's a subblock
-      if (tokens[0].at(0) == ' ')
-         {
-         // sub-block
-         continue;
-         }
+         throw runtime_error("Must find exactly 13 tokens for vmmap line: " + string(line));
       // TODO: process sub-blocks as well
-
-      unsigned long long start = hex2ull(tokens[0]);
-      if (start == HEX_CONVERT_ERROR)
-         {
-         cerr << "Error with start address on line: " << line << endl;
-         exit(-1);
-         }
-      else
-         {
-#ifdef DEBUG
-         cout << "Tokens: ";
-         for (vector<string>::iterator it = tokens.begin(); it != tokens.end(); ++it)
-            {
-            cout << *it << " ";
-            }
-         cout << endl;
-#endif
-         }
-      // "Address","Type","Size","Committed","Private","Total WS","Private WS","Shareable WS","Shared WS","Locked WS","Blocks","Protection","Details",
-      entry.clear();
-      entry.setStart(start);
-      entry._type = tokens[1];
-      unsigned long long size = a2ull(tokens[2]);
-      entry.setEnd(start + (size << 10));
-      entry._committed = a2ull(tokens[3]);
-      entry._rss = a2ull(tokens[5]);
-      entry._privateWS = a2ull(tokens[6]);
-      entry._shareableWS = a2ull(tokens[7]);
-      entry._sharedWS = a2ull(tokens[8]);
-      entry._lockedWS = a2ull(tokens[9]);
-      entry._numBlocks = a2ull(tokens[10]);
-      entry._protection = tokens[11];
-      entry._details = tokens[12];
-
+      parseVmmapFields(tokens, line, entry);
       vmmaps.push_back(entry);
 
       virtSize += entry.sizeKB();
       rssSize += entry.getResidentSizeKB();
       }
-   myfile.close();
-   cout << std::dec << "Total virtual size: " << virtSize << " kB. Total rss:" << rssSize << " kB." << endl;
+   progress << std::dec << "Total virtual size: " << virtSize << " kB. Total rss:" << rssSize << " kB." << endl;
    }
 
-
-
-void readVmmapCsvFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps)
+void readVmmapCsvFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& progress)
    {
    unsigned long long virtSize = 0;
    unsigned long long rssSize = 0;
-   cout << "Reading map file: " << string(vmmapFilename) << endl;
-   // Open the file
-   ifstream myfile(vmmapFilename);
-   // check if successfull
-   if (!myfile.is_open())
-      {
-      cerr << "Cannot open " << vmmapFilename << endl;
-      exit(-1);
-      }
+   progress << "Reading map file: " << string(vmmapFilename) << endl;
+   MappedFile myfile;
+   if (!myfile.open(vmmapFilename))
+      throw runtime_error("Cannot open " + string(vmmapFilename));
    // First we need to get to the header that looks like this
    // "Address","Type","Size","Committed","Private","Total WS","Private WS","Shareable WS","Shared WS","Locked WS","Blocks","Protection","Details",
+   LineReader lines(myfile.contents());
    int lineNo = 0;
-   string line;
+   string_view line;
    bool headerFound = false;
-   while (myfile.good())
+   while (lines.nextLine(line))
       {
-      getline(myfile, line); lineNo++;
+      lineNo++;
 #ifdef DEBUG
       cout << "readVmmapFile looking at :" << line << endl;
 #endif
-      if (std::string::npos != line.find("\"Address\",\"Type\",\"Size\",\"Committed\",\"Private\",\"Total WS\",\"Private WS\",\"Shareable WS\",\"Shared WS\",\"Locked WS\",\"Blocks\",\"Protection\",\"Details\","))
+      if (string_view::npos != line.find("\"Address\",\"Type\",\"Size\",\"Committed\",\"Private\",\"Total WS\",\"Private WS\",\"Shareable WS\",\"Shared WS\",\"Locked WS\",\"Blocks\",\"Protection\",\"Details\","))
          {
          headerFound = true;
          break;
          }
       }
    if (!headerFound)
-      {
-      cerr << "Cannot find header line in expected format\n" << endl;
-      exit(-1);
-      }
+      throw runtime_error("Cannot find header line in expected format");
 
    // Now read all entries
    VmmapEntry entry;
-   while (myfile.good())
+   vector<string_view> tokens;
+   while (lines.nextLine(line))
       {
-      getline(myfile, line); lineNo++;
+      lineNo++;
       // skip empty lines
-      if (line.find_first_not_of(" \t\n\r") == string::npos)
+      if (line.find_first_not_of(" \t\n\r") == string_view::npos)
          continue;
 #ifdef DEBUG
       cout << "readVmmapEntry looking at line " << lineNo << " with " << line.size() << " characters: " << line << endl;
 #endif
-      // All tokens are separated by ',' and sorounded by quotes
-      vector<string> tokens; // we should do tokens(13)
       if (!tokenizeVmmapLine(line, tokens))
-         exit(-1); // some error occurred
+         throw runtime_error("Cannot tokenize vmmap line: " + string(line));
       // We must find exactly 13 items
       if (tokens.size() != 13)
-         {
-         cerr << "Must find exactly 13 tokens for vmmap line: " << line << endl;
-         exit(-1);
-         }
+         throw runtime_error("Must find exactly 13 tokens for vmmap line: " + string(line));
 
       // If the start address starts with a number it's a main entry, otherwise it's a subblock
-      if (tokens[0].at(0) == ' ')
+      if (tokens[0].empty() || tokens[0][0] == ' ')
          {
          // sub-block
          continue;
          }
       // TODO: process sub-blocks as well
-
-      unsigned long long start = hex2ull(tokens[0]);
-      if (start == HEX_CONVERT_ERROR)
-         {
-         cerr << "Error with start address on line: " << line << endl;
-         exit(-1);
-         }
-      else
-         {
-#ifdef DEBUG
-         cout << "Tokens: ";
-         for (vector<string>::iterator it = tokens.begin(); it != tokens.end(); ++it)
-            {
-            cout << *it << " ";
-            }
-         cout << endl;
-#endif
-         }
-      // "Address","Type","Size","Committed","Private","Total WS","Private WS","Shareable WS","Shared WS","Locked WS","Blocks","Protection","Details",
-      entry.clear();
-      entry.setStart(start);
-      entry._type = tokens[1];
-      unsigned long long size = a2ull(tokens[2]);
-      entry.setEnd(start + (size << 10));
-      entry._committed = a2ull(tokens[3]);
-      entry._rss = a2ull(tokens[5]);
-      entry._privateWS = a2ull(tokens[6]);
-      entry._shareableWS = a2ull(tokens[7]);
-      entry._sharedWS = a2ull(tokens[8]);
-      entry._lockedWS = a2ull(tokens[9]);
-      entry._numBlocks = a2ull(tokens[10]);
-      entry._protection = tokens[11];
-      entry._details = tokens[12];
-
+      parseVmmapFields(tokens, line, entry);
       vmmaps.push_back(entry);
 
       virtSize += entry.sizeKB();
       rssSize += entry.getResidentSizeKB();
       }
-   myfile.close();
-   cout << std::dec << "Total virtual size: " << virtSize << " kB. Total rss:" << rssSize << " kB." << endl;
+   progress << std::dec << "Total virtual size: " << virtSize << " kB. Total rss:" << rssSize << " kB." << endl;
    }
 
-void readVmmapFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps)
+void readVmmapFile(const char *vmmapFilename, vector<VmmapEntry>& vmmaps, ostream& progress)
    {
-//#ifdef DEBUG
-   cout << "Determining if vmmapFile is text or csv\n";
-//#endif
-   // Determine whether the file is of type csv or txt
-   string filename(vmmapFilename);
-   // TODO: make sure the filename ends with .csv or .txt
-   bool isCsv = filename.find(".csv") != string::npos; // It's  csv
-   bool isTxt = filename.find(".txt") != string::npos; // It's  txt
-
-   if (isCsv)
-      {
-      readVmmapCsvFile(vmmapFilename, vmmaps);
-      }
-   else if (isTxt)
+   // Determine whether the file is of type csv or txt by looking at the header
+   switch (detectInputFormat(vmmapFilename))
       {
-      readVmmapTextFile(vmmapFilename, vmmaps);
+      case VMMAP_CSV_INPUT:
+         readVmmapCsvFile(vmmapFilename, vmmaps, progress);
+         break;
+      case VMMAP_TEXT_INPUT:
+         readVmmapTextFile(vmmapFilename, vmmaps, progress);
+         break;
+      default:
+         throw runtime_error("Cannot find a vmmap header in " + string(vmmapFilename));
       }
-   else
+   }
+
+long long VmmapEntry::getHeapId() const
+   {
+   // "Heap ID: 1 [LOW FRAGMENTATION]"
+   static const string heapIdPrefix("Heap ID: ");
+   if (_details.compare(0, heapIdPrefix.size(), heapIdPrefix) != 0)
+      return -1;
+   size_t endPos = _details.find_first_not_of("0123456789", heapIdPrefix.size());
+   if (endPos == heapIdPrefix.size())
+      return -1;
+   return (long long)a2ull(string_view(_details).substr(heapIdPrefix.size(), endPos - heapIdPrefix.size()));
+   }
+
+// Sizes of a group of vmmap entries, in KB, and the RSS that the J9 attribution charges to each category
+struct VmmapWorkingSet
+   {
+   unsigned long long _sizeKB = 0;
+   unsigned long long _committedKB = 0;
+   unsigned long long _totalWSKB = 0;
+   unsigned long long _privateWSKB = 0;
+   unsigned long long _shareableWSKB = 0;
+   unsigned long long _sharedWSKB = 0;
+   unsigned long long _rssByCategory[AddrRange::NUM_CATEGORIES] = {0}; // bytes
+   void add(const VmmapEntry& entry, bool usePageMap)
       {
-      cerr << "vmmap file must be have the extension cvs or txt\n";
-      exit(-1);
+      _sizeKB += entry.sizeKB();
+      _committedKB += entry._committed;
+      _totalWSKB += entry.getResidentSizeKB();
+      _privateWSKB += entry._privateWS;
+      _shareableWSKB += entry._shareableWS;
+      _sharedWSKB += entry._sharedWS;
+      forEachMapAttribution(entry, usePageMap,
+         [this](AddrRange::RangeCategories category, const AddrRange *, unsigned long long, unsigned long long rssBytes)
+            { _rssByCategory[category] += rssBytes; });
       }
+   };
 
+static void printVmmapWorkingSetHeader(const char *groupName)
+   {
+   cout << setw(24) << left << groupName << right << setw(10) << "Size" << setw(11) << "Committed" << setw(10) << "TotalWS"
+        << setw(11) << "PrivateWS" << setw(13) << "ShareableWS" << setw(10) << "SharedWS" << "  J9 attribution of TotalWS\n";
    }
 
-void VmmapEntry::print(std::ostream& os) const
+static void printVmmapWorkingSetLine(const string& groupName, const VmmapWorkingSet& ws)
    {
-   os << std::hex << "Start=" << setfill('0') << setw(16) << getStart() <<
-      " End=" << setfill('0') << setw(16) << getEnd() << std::dec <<
-      " Size=" << setfill(' ') << setw(6) << sizeKB() << " rss=" << setfill(' ') << setw(6) << _rss << " Prot=" << getProtectionString();
-   if (_details.length() > 0)
-      os << " " << _details;
+   cout << setw(24) << left << groupName << right << setw(10) << ws._sizeKB << setw(11) << ws._committedKB << setw(10) << ws._totalWSKB
+        << setw(11) << ws._privateWSKB << setw(13) << ws._shareableWSKB << setw(10) << ws._sharedWSKB << " ";
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      if (ws._rssByCategory[i] >> 10)
+         cout << " " << AddrRange::RangeCategoryNames[i] << "=" << (ws._rssByCategory[i] >> 10);
+   cout << endl;
    }
 
-
-
+//------------------------- printVmmapWorkingSetBreakdown -----------------------
+// Committed memory and working set of the vmmap entries grouped by vmmap type
+// (Heap, Thread Stack, Image, Shareable, ...) and by Windows heap, with the J9
+// categories that the working set of each group is attributed to.
+// The "Heap (Private Data)" and "Heap (Shareable)" types are both reported as "Heap"
+//-------------------------------------------------------------------------------
+void printVmmapWorkingSetBreakdown(const vector<VmmapEntry>& vmmaps, bool usePageMap)
+   {
+   std::map<string, VmmapWorkingSet> byType;
+   std::map<long long, VmmapWorkingSet> byHeapId;
+   std::map<long long, string> heapDescriptions;
+   VmmapWorkingSet total;
+   for (const auto& entry : vmmaps)
+      {
+      const string& type = entry.getTypeString();
+      byType[type.substr(0, type.find(" ("))].add(entry, usePageMap);
+      long long heapId = entry.getHeapId();
+      if (heapId >= 0)
+         {
+         byHeapId[heapId].add(entry, usePageMap);
+         size_t flagsPos = entry.getDetailsString().find('[');
+         if (flagsPos != string::npos)
+            heapDescriptions.emplace(heapId, entry.getDetailsString().substr(flagsPos));
+         }
+      total.add(entry, usePageMap);
+      }
+   cout << dec << setfill(' ') << "\nCommitted memory and working set by vmmap type (KB):\n";
+   printVmmapWorkingSetHeader("Type");
+   for (const auto& type : byType)
+      printVmmapWorkingSetLine(type.first, type.second);
+   printVmmapWorkingSetLine("Total", total);
+
+   if (byHeapId.empty())
+      return;
+   cout << "\nCommitted memory and working set by Windows heap (KB):\n";
+   printVmmapWorkingSetHeader("Heap ID");
+   for (const auto& heap : byHeapId)
+      {
+      auto description = heapDescriptions.find(heap.first);
+      printVmmapWorkingSetLine(to_string(heap.first) + (description != heapDescriptions.end() ? " " + description->second : ""), heap.second);
+      }
+   }
@@ -69,14 +69,21 @@ class VmmapEntry : public MemoryEntry
       const std::string& getTypeString() const { return _type; }
       bool isMapForSharedLibrary() const { return (getTypeString().find("Image") == 0); } // The type must start with Image
       bool isMapForThreadStack() const { return getTypeString().find("Thread Stack") == 0; } // Must start with Thread Stack}
-   protected:
-      virtual void print(std::ostream& os) const;
+      // Total WS split like the Rss of an smap; Shared WS is the part of Shareable WS that other processes also use
+      unsigned long long privateResidentKB() const { return _privateWS; }
+      unsigned long long sharedResidentKB() const { return _shareableWS; }
+      // Free blocks are listed by vmmap, but they are not part of the address space of the process
+      unsigned long long reservedKB() const { return getTypeString().find("Free") == 0 ? 0 : sizeKB(); }
+      unsigned long long committedKB() const { return _committed; }
+      long long getHeapId() const; // -1 if the details do not start with "Heap ID: N"
    }; // VmmapEntry
 
 
 
 
-void readVmmapFile(const char *vmmapFilename, std::vector<VmmapEntry>& vmmap);
+// Throws std::runtime_error if the file cannot be read or parsed
+void readVmmapFile(const char *vmmapFilename, std::vector<VmmapEntry>& vmmap, std::ostream& progress = std::cout);
+void printVmmapWorkingSetBreakdown(const std::vector<VmmapEntry>& vmmaps, bool usePageMap);
 //void printLargestUnallocatedBlocks(const std::vector<SmapEntry> &smaps);
 //unsigned long long computeReservedSpaceKB(const std::vector<SmapEntry> &smaps);
 //void printTopTenReservedSpaceKB(const std::vector<SmapEntry> &smaps);
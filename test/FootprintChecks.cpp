@@ -0,0 +1,442 @@
+/*******************************************************************************
+ * Copyright (c) 2022, 2022 IBM Corp. and others
+ *
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License 2.0 which accompanies this
+ * distribution and is available at https://www.eclipse.org/legal/epl-2.0/
+ * or the Apache License, Version 2.0 which accompanies this distribution and
+ * is available at https://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied: GNU
+ * General Public License, version 2 with the GNU Classpath
+ * Exception [1] and GNU General Public License, version 2 with the
+ * OpenJDK Assembly Exception [2].
+ *
+ * [1] https://www.gnu.org/software/classpath/license.html
+ * [2] http://openjdk.java.net/legal/assembly-exception.html
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR Apache-2.0 OR GPL-2.0 WITH Classpath-exception-2.0 OR LicenseRef-GPL-2.0 WITH Assembly-exception
+ *******************************************************************************/
+// Checks of the invariants the reports rely on, driven by the files in test/fixtures:
+// the classification rules pick the first rule that matches, the attribution of every
+// map adds up to the map, and a sample store written by a process that died at any
+// point reads back the samples that were appended.
+//    make check   (or ./footprintChecks <fixturesDir>)
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib> // for mkdtemp
+#include <unistd.h> // for getpid, truncate
+#include <sys/mman.h> // for mmap
+#include "smap.hpp"
+#include "Javacore.hpp"
+#include "CallSites.hpp"
+#include "Attribution.hpp"
+#include "ClassificationRules.hpp"
+#include "PageMapSupport.hpp"
+#include "SampleStore.hpp"
+
+using namespace std;
+
+static int numFailures = 0;
+
+static void check(bool condition, const string& what)
+   {
+   if (!condition)
+      {
+      cerr << "FAILED: " << what << endl;
+      numFailures++;
+      }
+   }
+
+//------------------------------ classification rules ------------------------
+// Purpose or custom category of the rule that classifies 'path'; empty if none does
+static string classification(const MapClassifier& classifier, const string& path)
+   {
+   const ClassificationRule *rule = classifier.classify(path);
+   if (!rule)
+      return "";
+   return rule->_category.empty() ? MemoryEntry::_purposeNames[rule->_purpose] : rule->_category;
+   }
+
+static void checkClassification(const MapClassifier& classifier, const char * const cases[][2], size_t numCases, const string& what)
+   {
+   for (size_t i = 0; i < numCases; i++)
+      {
+      string found = classification(classifier, cases[i][0]);
+      check(found == cases[i][1], what + ": '" + cases[i][0] + "' is classified as '" + found + "' instead of '" + cases[i][1] + "'");
+      }
+   }
+
+static void checkClassificationRules(const string& fixturesDir)
+   {
+   static const char * const defaultCases[][2] = {
+      { "/usr/lib/x86_64-linux-gnu/libX11.so",        "DLL" },
+      { "/usr/lib/x86_64-linux-gnu/libXext.so.6.4.0", "DLL" },
+      { "/usr/lib/libsox",                            "" },   // .so neither at the end nor followed by '.'
+      { "/tmp/x.sox",                                 "" },
+      { "[stack]",                                    "STACK" },
+      { "[stack:1234]",                               "STACK" },
+      { "/tmp/[stack]",                               "" },   // ^[stack is anchored at the start
+      { "/tmp/javasharedresources/C290M17F1A64P_sharedcc_root_G43", "SCC" },
+      { "/opt/cache/classCache1",                     "SCC" },
+      { "/opt/cache/app.scc",                         "SCC" },
+      { "[heap]",                                     "" },
+      { "",                                           "" },
+   };
+   MapClassifier defaultClassifier;
+   checkClassification(defaultClassifier, defaultCases, sizeof(defaultCases) / sizeof(defaultCases[0]), "default rules");
+
+   static const char * const fileCases[][2] = {
+      { "/usr/lib/libjemalloc.so.2",     "jemalloc" }, // the file rule comes before .so.
+      { "/opt/app/lib/native.so",        "appdata" },
+      { "/var/opt/app/data",             "" },         // ^/opt/app/ is anchored at the start
+      { "/opt/app/",                     "appdata" },
+      { "/lib/app.jar",                  "jars" },
+      { "/lib/app.jar.bak",              "" },         // .jar$ is anchored at the end
+      { "/xqrsx",                        "first" },    // qr ends first, but qrs comes first in the file
+      { "/xqrx",                         "second" },
+      { "/usr/lib/jvm/bin/java",         "launcher" },
+      { "/usr/lib/jvm/bin/javac",        "" },
+      { "/x/usr/lib/jvm/bin/java",       "" },
+      { "[stack]",                       "STACK" },    // the default rules still apply
+      { "/usr/lib/libc.so.6",            "DLL" },
+      { "/dev/zero",                     "" },
+   };
+   MapClassifier fileClassifier;
+   fileClassifier.readRulesFile((fixturesDir + "/rules.txt").c_str());
+   checkClassification(fileClassifier, fileCases, sizeof(fileCases) / sizeof(fileCases[0]), "rules file");
+   }
+
+//------------------------------ attribution totals --------------------------
+// Every map is charged in full: the pieces of forEachMapAttribution add up to the
+// size of the map, and to its RSS unless the ranges counted from the pagemap hold more
+template <typename MAPENTRY>
+static void checkMapPieces(const vector<MAPENTRY>& maps, bool usePageMap, const string& what)
+   {
+   for (const auto& crtMap : maps)
+      {
+      unsigned long long virtualBytes = 0, rssBytes = 0, rangesRss = 0;
+      forEachMapAttribution(crtMap, usePageMap,
+         [&](AddrRange::RangeCategories, const AddrRange *range, unsigned long long v, unsigned long long r)
+            {
+            virtualBytes += v;
+            rssBytes += r;
+            if (range)
+               rangesRss += r;
+            });
+      unsigned long long mapRss = crtMap.getResidentSizeKB() << 10;
+      ostringstream where;
+      where << what << ": map at 0x" << hex << crtMap.getStart() << dec;
+      check(virtualBytes == crtMap.size(), where.str() + " virtual " + to_string(virtualBytes) + " != " + to_string(crtMap.size()));
+      unsigned long long expectedRss = usePageMap ? max(mapRss, rangesRss) : mapRss;
+      check(rssBytes == expectedRss, where.str() + " RSS " + to_string(rssBytes) + " != " + to_string(expectedRss));
+      }
+   }
+
+// The category totals and the folded records are two views of the same pieces
+template <typename MAPENTRY>
+static void checkTotals(const vector<MAPENTRY>& maps, bool usePageMap, const string& what)
+   {
+   unsigned long long virtualSize[AddrRange::NUM_CATEGORIES] = {0};
+   unsigned long long rssSize[AddrRange::NUM_CATEGORIES] = {0};
+   computeCategoryTotals(maps, usePageMap, virtualSize, rssSize);
+   unsigned long long categoriesVirtual = 0, categoriesRss = 0;
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      {
+      categoriesVirtual += virtualSize[i];
+      categoriesRss += rssSize[i];
+      }
+   FootprintSummary<MAPENTRY> summary;
+   computeFootprintSummary(maps, usePageMap, summary);
+   vector<AttributionRecord> records;
+   collectAttributionRecords(maps, usePageMap, records);
+   unsigned long long recordsVirtual = 0, recordsRss = 0;
+   for (const auto& record : records)
+      {
+      recordsVirtual += record._virtualBytes;
+      recordsRss += record._rssBytes;
+      }
+   check(categoriesVirtual == summary._totalVirtSize, what + ": virtual size of the categories differs from the maps");
+   check(recordsVirtual == categoriesVirtual, what + ": virtual size of the records differs from the categories");
+   check(recordsRss == categoriesRss, what + ": RSS of the records differs from the categories");
+   if (!usePageMap)
+      check(categoriesRss == summary._totalRssSize, what + ": RSS of the categories differs from the maps");
+   for (int i = 0; i < AddrRange::NUM_CATEGORIES; i++)
+      check(summary._virtualSize[i] == virtualSize[i] && summary._rssSize[i] == rssSize[i],
+            what + ": summary differs from the totals for category " + to_string(i));
+   }
+
+static void checkFixtureAttribution(const string& fixturesDir)
+   {
+   ostream noProgress(nullptr);
+   vector<SmapEntry> maps;
+   readSmapsFile((fixturesDir + "/smaps.20260101.100000.1234.0001").c_str(), maps, noProgress);
+   vector<J9Segment> segments;
+   vector<ThreadStack> threadStacks;
+   readJavacore((fixturesDir + "/javacore.20260101.100000.1234.0001.txt").c_str(), segments, threadStacks, nullptr, nullptr, noProgress);
+   vector<CallSite> callSites;
+   readCallSitesFile((fixturesDir + "/callsites.txt").c_str(), callSites, nullptr, noProgress);
+   check(!maps.empty() && !segments.empty() && !threadStacks.empty() && !callSites.empty(), "fixtures: inputs are not empty");
+
+   list<ThreadStack> stackGuards;
+   annotateMapWithSegments(maps, segments, noProgress);
+   annotateMapWithThreadStacks(maps, threadStacks, &stackGuards, noProgress);
+   annotateMapWithSegments(maps, callSites, noProgress);
+   checkMapPieces(maps, false, "fixtures");
+   checkTotals(maps, false, "fixtures");
+   }
+
+// With -p the ranges carry their own RSS; a call-site over part of a mapping of this
+// process, with some pages touched, exercises the split into range and uncovered RSS
+static void checkPageMapAttribution()
+   {
+   const long pageSize = sysconf(_SC_PAGE_SIZE);
+   const size_t numPages = 64, numTouched = 10;
+   char *area = (char*)mmap(nullptr, numPages * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (area == MAP_FAILED)
+      {
+      cerr << "Skipping the pagemap check: cannot map memory\n";
+      return;
+      }
+   for (size_t i = 0; i < numTouched; i++)
+      area[i * pageSize] = 1;
+   try
+      {
+      ostream noProgress(nullptr);
+      vector<SmapEntry> maps;
+      readSmapsFile("/proc/self/smaps", maps, noProgress);
+      PageMapReader pageMapReader(getpid());
+      vector<pair<unsigned long long, unsigned long long>> vmas;
+      for (const auto& crtMap : maps)
+         vmas.emplace_back(crtMap.getStart(), crtMap.getEnd());
+      pageMapReader.setVmas(vmas);
+      unsigned long long start = (unsigned long long)area;
+      vector<CallSite> callSites;
+      callSites.emplace_back(start, start + numPages / 2 * pageSize, "FootprintChecks.cpp", __LINE__, 0);
+      computeRangesRss(callSites, pageMapReader);
+      check(callSites[0].getRSS() == numTouched * pageSize,
+            "pagemap: RSS of the call-site is " + to_string(callSites[0].getRSS()) + " instead of " + to_string(numTouched * pageSize));
+      annotateMapWithSegments(maps, callSites, noProgress);
+      checkMapPieces(maps, true, "pagemap");
+      checkTotals(maps, true, "pagemap");
+      }
+   catch (const exception& e)
+      {
+      cerr << "Skipping the pagemap check: " << e.what() << endl;
+      }
+   munmap(area, numPages * pageSize);
+   }
+
+//------------------------------ sample store recovery -----------------------
+typedef map<string, pair<unsigned long long, unsigned long long>> Values; // stack -> (virtual, rss)
+
+static unsigned long long sampleTimestamp(unsigned i) { return 1767261600000ULL + i * 1000ULL; }
+
+// Sample 'i' of the series written by the checks; a series appears only after some samples
+static vector<AttributionRecord> sampleRecords(unsigned i)
+   {
+   vector<AttributionRecord> records(3);
+   records[0]._stack = "#total";
+   records[0]._virtualBytes = 1000000 + i;
+   records[0]._rssBytes = 500000 + 2 * i;
+   records[1]._stack = "JIT;Scratch";
+   records[1]._virtualBytes = 4096;
+   records[1]._rssBytes = 4096 * (i % 3);
+   records[2]._stack = "CallSites;segment.c;segment.c:99";
+   records[2]._virtualBytes = i >= 70 ? 8192 : 0;
+   records[2]._rssBytes = i >= 70 ? 4096 : 0;
+   return records;
+   }
+
+static void appendSamples(SampleStore& store, unsigned from, unsigned to)
+   {
+   for (unsigned i = from; i < to; i++)
+      store.append(sampleTimestamp(i), sampleRecords(i));
+   }
+
+// The store must read back exactly samples 0 .. numSamples-1, in order
+static void checkSamples(const string& dirName, unsigned numSamples, const string& what)
+   {
+   SampleStore store(dirName, false);
+   unsigned numRead = 0;
+   bool ordered = true;
+   store.readRange(0, ~0ULL, [&](const SampleStore::Sample& sample)
+      {
+      if (numRead >= numSamples || sample._timestampMs != sampleTimestamp(numRead))
+         {
+         ordered = false;
+         numRead++;
+         return;
+         }
+      Values expected, found;
+      for (const auto& record : sampleRecords(numRead))
+         if (record._virtualBytes != 0 || record._rssBytes != 0)
+            expected[record._stack] = make_pair(record._virtualBytes, record._rssBytes);
+      for (const auto& record : sample._records)
+         found[record._stack] = make_pair(record._virtualBytes, record._rssBytes);
+      check(found == expected, what + ": values of sample " + to_string(numRead));
+      numRead++;
+      });
+   check(ordered, what + ": samples out of order or duplicated");
+   check(numRead == numSamples, what + ": read " + to_string(numRead) + " samples instead of " + to_string(numSamples));
+   }
+
+static string makeStoreDir()
+   {
+   char dirName[] = "/tmp/footprintChecks.XXXXXX";
+   if (!mkdtemp(dirName))
+      throw runtime_error("cannot create a temporary directory");
+   return dirName;
+   }
+
+static void removeStoreDir(const string& dirName)
+   {
+   for (const char *file : {"series.dict", "blocks.dat", "blocks.idx", "journal.dat"})
+      unlink((dirName + "/" + file).c_str());
+   rmdir(dirName.c_str());
+   }
+
+static string readFile(const string& fileName)
+   {
+   ifstream in(fileName, ios::binary);
+   return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+   }
+
+static void writeFile(const string& fileName, const string& content, ios::openmode mode = ios::trunc)
+   {
+   ofstream out(fileName, ios::binary | mode);
+   out << content;
+   }
+
+static size_t fileSize(const string& fileName)
+   {
+   return readFile(fileName).size();
+   }
+
+// A store that is never destroyed stands for a process that died: what it wrote is on disk,
+// nothing is flushed at exit
+static SampleStore* crashedStore(const string& dirName, unsigned numSamples)
+   {
+   SampleStore *store = new SampleStore(dirName, true);
+   appendSamples(*store, 0, numSamples);
+   return store;
+   }
+
+static const unsigned NUM_SAMPLES = 2 * SampleStore::BLOCK_SAMPLES + 36; // two sealed blocks and an open one
+
+static void checkCleanClose(const string& dirName)
+   {
+      {
+      SampleStore store(dirName, true);
+      appendSamples(store, 0, NUM_SAMPLES);
+      }
+   checkSamples(dirName, NUM_SAMPLES, "clean close");
+   }
+
+static void checkCrashWithOpenBlock(const string& dirName)
+   {
+   crashedStore(dirName, NUM_SAMPLES);
+   checkSamples(dirName, NUM_SAMPLES, "crash with an open block");
+   }
+
+// The last journal row was cut short; the store recovers and keeps appending after it
+static void checkTornJournalRow(const string& dirName)
+   {
+   crashedStore(dirName, NUM_SAMPLES);
+   string journal = readFile(dirName + "/journal.dat");
+   writeFile(dirName + "/journal.dat", journal.substr(0, journal.size() - 3));
+      {
+      SampleStore store(dirName, true);
+      appendSamples(store, NUM_SAMPLES - 1, NUM_SAMPLES + 1);
+      }
+   checkSamples(dirName, NUM_SAMPLES + 1, "torn journal row");
+   }
+
+// A crash while a block was sealed leaves part of its frame at the end of blocks.dat
+static void checkPartialBlockFrame(const string& dirName)
+   {
+   crashedStore(dirName, NUM_SAMPLES);
+   string blocks = readFile(dirName + "/blocks.dat");
+   writeFile(dirName + "/blocks.dat", blocks.substr(0, 10), ios::app);
+      {
+      SampleStore store(dirName, true);
+      appendSamples(store, NUM_SAMPLES, NUM_SAMPLES + SampleStore::BLOCK_SAMPLES);
+      }
+   checkSamples(dirName, NUM_SAMPLES + SampleStore::BLOCK_SAMPLES, "partial block frame");
+   }
+
+// The block was sealed but its index entry did not make it to disk
+static void checkTornIndexEntry(const string& dirName)
+   {
+   checkCleanClose(dirName);
+   string indexName = dirName + "/blocks.idx";
+   check(truncate(indexName.c_str(), fileSize(indexName) - 3) == 0, "torn index entry: truncate");
+   checkSamples(dirName, NUM_SAMPLES, "torn index entry");
+   }
+
+static void checkCorruptIndexEntry(const string& dirName)
+   {
+   checkCleanClose(dirName);
+   string indexName = dirName + "/blocks.idx";
+   string index = readFile(indexName);
+   index[index.size() / 2] ^= 0x5a;
+   writeFile(indexName, index);
+   checkSamples(dirName, NUM_SAMPLES, "corrupt index entry");
+   }
+
+// The block was sealed but the journal it came from was not truncated: its rows are stale
+static void checkStaleJournalRows(const string& dirName)
+   {
+   SampleStore *store = crashedStore(dirName, SampleStore::BLOCK_SAMPLES - 1);
+   string journal = readFile(dirName + "/journal.dat");
+   appendSamples(*store, SampleStore::BLOCK_SAMPLES - 1, SampleStore::BLOCK_SAMPLES);
+   writeFile(dirName + "/journal.dat", journal);
+   checkSamples(dirName, SampleStore::BLOCK_SAMPLES, "stale journal rows");
+   }
+
+// Each case writes a store of its own
+static void checkSampleStoreRecovery()
+   {
+   for (auto checkCase : {checkCleanClose, checkCrashWithOpenBlock, checkTornJournalRow, checkPartialBlockFrame,
+                          checkTornIndexEntry, checkCorruptIndexEntry, checkStaleJournalRows})
+      {
+      string dirName = makeStoreDir();
+      checkCase(dirName);
+      removeStoreDir(dirName);
+      }
+   }
+
+int main(int argc, char* argv[])
+   {
+   if (argc != 2)
+      {
+      cerr << "Usage: " << argv[0] << " <fixturesDir>\n";
+      return 2;
+      }
+   try
+      {
+      checkClassificationRules(argv[1]);
+      checkFixtureAttribution(argv[1]);
+      checkPageMapAttribution();
+      checkSampleStoreRecovery();
+      }
+   catch (const exception& e)
+      {
+      cerr << "FAILED: " << e.what() << endl;
+      numFailures++;
+      }
+   if (numFailures != 0)
+      {
+      cerr << numFailures << " check(s) failed\n";
+      return 1;
+      }
+   cout << "All checks passed\n";
+   return 0;
+   }